@@ -7,6 +7,8 @@
 
 #include <boost/filesystem/fstream.hpp>
 
+#include <osg/GLExtensions>
+
 #include <osgViewer/ViewerEventHandlers>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
@@ -24,10 +26,14 @@
 #include <components/sdlutil/sdlgraphicswindow.hpp>
 #include <components/sdlutil/imagetosurface.hpp>
 
+#include <components/resource/imagemanager.hpp>
+#include <components/resource/texturestreamer.hpp>
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/scenemanager.hpp>
 #include <components/resource/stats.hpp>
 
+#include <components/shader/shadermanager.hpp>
+
 #include <components/compiler/extensions0.hpp>
 
 #include <components/sceneutil/workqueue.hpp>
@@ -71,6 +77,33 @@ namespace
             Log(Debug::Error) << "SDL error: " << SDL_GetError();
     }
 
+    /// Queries the limits of the graphics driver when the graphics context is realized, then runs the given realize operation
+    class QueryGLLimitsOperation : public osg::GraphicsOperation
+    {
+    public:
+        QueryGLLimitsOperation(osg::GraphicsOperation* next)
+            : osg::GraphicsOperation("QueryGLLimitsOperation", false)
+            , mNext(next)
+            , mMaxVertexUniformComponents(0)
+        {
+        }
+
+        void operator()(osg::GraphicsContext* graphicsContext) override
+        {
+            glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &mMaxVertexUniformComponents);
+            Log(Debug::Info) << "Max vertex uniform components: " << mMaxVertexUniformComponents;
+
+            if (mNext)
+                (*mNext)(graphicsContext);
+        }
+
+        int getMaxVertexUniformComponents() const { return mMaxVertexUniformComponents; }
+
+    private:
+        osg::ref_ptr<osg::GraphicsOperation> mNext;
+        GLint mMaxVertexUniformComponents;
+    };
+
     struct UserStats
     {
         const std::string mLabel;
@@ -362,6 +395,7 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
   , mEncoding(ToUTF8::WINDOWS_1252)
   , mEncoder(nullptr)
   , mScreenCaptureOperation(nullptr)
+  , mMaxVertexUniformComponents(0)
   , mSkipMenu (false)
   , mUseSound (true)
   , mCompileAll (false)
@@ -593,11 +627,14 @@ void OMW::Engine::createWindow(Settings::Manager& settings)
     camera->setGraphicsContext(graphicsWindow);
     camera->setViewport(0, 0, graphicsWindow->getTraits()->width, graphicsWindow->getTraits()->height);
 
-    if (Debug::shouldDebugOpenGL())
-        mViewer->setRealizeOperation(new Debug::EnableGLDebugOperation());
+    osg::ref_ptr<QueryGLLimitsOperation> queryLimits = new QueryGLLimitsOperation(
+        Debug::shouldDebugOpenGL() ? new Debug::EnableGLDebugOperation() : nullptr);
+    mViewer->setRealizeOperation(queryLimits);
 
     mViewer->realize();
 
+    mMaxVertexUniformComponents = queryLimits->getMaxVertexUniformComponents();
+
     mViewer->getEventQueue()->getCurrentEventState()->setWindowRectangle(0, 0, graphicsWindow->getTraits()->width, graphicsWindow->getTraits()->height);
 }
 
@@ -637,16 +674,36 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
 
     mVFS.reset(new VFS::Manager(mFSStrict));
 
-    VFS::registerArchives(mVFS.get(), mFileCollections, mArchives, true);
+    std::string indexCachePath;
+    if (Settings::Manager::getBool("cache file index", "General"))
+        indexCachePath = (mCfgMgr.getCachePath() / "vfs").string();
+    VFS::registerArchives(mVFS.get(), mFileCollections, mArchives, true, indexCachePath);
 
     mResourceSystem.reset(new Resource::ResourceSystem(mVFS.get()));
     mResourceSystem->getSceneManager()->setUnRefImageDataAfterApply(false); // keep to Off for now to allow better state sharing
+    mResourceSystem->getSceneManager()->setMaxVertexUniformComponents(mMaxVertexUniformComponents);
     mResourceSystem->getSceneManager()->setFilterSettings(
         Settings::Manager::getString("texture mag filter", "General"),
         Settings::Manager::getString("texture min filter", "General"),
         Settings::Manager::getString("texture mipmap", "General"),
         Settings::Manager::getInt("anisotropy", "General")
     );
+    if (Settings::Manager::getBool("compress textures", "General"))
+        mResourceSystem->getSceneManager()->getImageManager()->setCompressionCachePath((mCfgMgr.getCachePath() / "textures").string());
+    if (Settings::Manager::getBool("texture streaming", "General"))
+    {
+        osg::ref_ptr<Resource::TextureStreamer> textureStreamer = new Resource::TextureStreamer(
+            Settings::Manager::getInt("texture streaming base size", "General"),
+            Settings::Manager::getInt("texture streaming budget", "General"));
+        mResourceSystem->getSceneManager()->setTextureStreamer(textureStreamer);
+        mViewer->getCamera()->getGraphicsContext()->add(textureStreamer);
+    }
+    if (Settings::Manager::getBool("shader cache", "Shaders"))
+    {
+        osg::ref_ptr<Shader::ProgramCache> programCache = new Shader::ProgramCache((mCfgMgr.getCachePath() / "shaders").string());
+        mResourceSystem->getSceneManager()->getShaderManager().setProgramCache(programCache);
+        mViewer->getCamera()->getGraphicsContext()->add(programCache);
+    }
 
     int numThreads = Settings::Manager::getInt("preload num threads", "Cells");
     if (numThreads <= 0)
@@ -716,9 +773,13 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     // Create the world
     mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(), mWorkQueue.get(),
         mFileCollections, mContentFiles, mEncoder, mActivationDistanceOverride, mCellName,
-        mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string()));
+        mStartupScript, mResDir.string(), mCfgMgr.getUserDataPath().string(), mCfgMgr.getCachePath().string()));
     mEnvironment.getWorld()->setupPlayer();
 
+    // The global defines are set up by the rendering manager, so the programs can be created now
+    if (Settings::Manager::getBool("prewarm shader cache", "Shaders"))
+        mResourceSystem->getSceneManager()->getShaderManager().prewarmPrograms();
+
     window->setStore(mEnvironment.getWorld()->getStore());
     window->initUI();
 
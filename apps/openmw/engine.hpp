@@ -83,6 +83,7 @@ namespace OMW
             osg::ref_ptr<osgViewer::Viewer> mViewer;
             osg::ref_ptr<osgViewer::ScreenCaptureHandler> mScreenCaptureHandler;
             osgViewer::ScreenCaptureHandler::CaptureOperation *mScreenCaptureOperation;
+            int mMaxVertexUniformComponents;
             std::string mCellName;
             std::vector<std::string> mContentFiles;
             bool mSkipMenu;
@@ -203,4 +203,5 @@ void MWBase::Environment::reportStats(unsigned int frameNumber, osg::Stats& stat
 {
     mMechanicsManager->reportStats(frameNumber, stats);
     mWorld->reportStats(frameNumber, stats);
+    mSoundManager->reportStats(frameNumber, stats);
 }
@@ -4,10 +4,16 @@
 #include <memory>
 #include <string>
 #include <set>
+#include <vector>
 
 #include "../mwworld/ptr.hpp"
 #include "../mwsound/type.hpp"
 
+namespace osg
+{
+    class Stats;
+}
+
 namespace MWWorld
 {
     class CellStore;
@@ -167,6 +173,9 @@ namespace MWBase
             ///< Is the given sound currently playing on the given object?
             ///  If you want to check if sound played with playSound is playing, use empty Ptr
 
+            virtual void preloadSounds(const std::vector<std::string>& soundIds) = 0;
+            ///< Decode the given sounds in the background, so that they can be played without delay later on.
+
             virtual void pauseSounds(MWSound::BlockerType blocker, int types=int(Type::Mask)) = 0;
             ///< Pauses all currently playing sounds, including music.
 
@@ -183,6 +192,8 @@ namespace MWBase
             virtual void updatePtr(const MWWorld::ConstPtr& old, const MWWorld::ConstPtr& updated) = 0;
 
             virtual void clear() = 0;
+
+            virtual void reportStats(unsigned int frameNumber, osg::Stats& stats) const = 0;
     };
 }
 
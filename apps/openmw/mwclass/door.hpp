@@ -49,6 +49,8 @@ namespace MWClass
 
             virtual std::string getModel(const MWWorld::ConstPtr &ptr) const;
 
+            virtual void getSoundsToPreload(const MWWorld::Ptr& ptr, std::vector<std::string>& sounds) const;
+
             virtual MWWorld::DoorState getDoorState (const MWWorld::ConstPtr &ptr) const;
             /// This does not actually cause the door to move. Use World::activateDoor instead.
             virtual void setDoorState (const MWWorld::Ptr &ptr, MWWorld::DoorState state) const;
@@ -65,6 +65,13 @@ namespace MWClass
         return "";
     }
 
+    void Light::getSoundsToPreload(const MWWorld::Ptr &ptr, std::vector<std::string> &sounds) const
+    {
+        const MWWorld::LiveCellRef<ESM::Light> *ref = ptr.get<ESM::Light>();
+        if (!ref->mBase->mSound.empty())
+            sounds.push_back(ref->mBase->mSound);
+    }
+
     std::string Light::getName (const MWWorld::ConstPtr& ptr) const
     {
         const MWWorld::LiveCellRef<ESM::Light> *ref = ptr.get<ESM::Light>();
@@ -1566,6 +1566,12 @@ namespace MWRender
             mInsert->addChild(mObjectRoot);
         }
 
+        if (mSkeleton)
+        {
+            static const bool animationLod = Settings::Manager::getBool("animation lod", "Game");
+            mSkeleton->setUpdateLod(animationLod);
+        }
+
         if (previousStateset)
             mObjectRoot->setStateSet(previousStateset);
 
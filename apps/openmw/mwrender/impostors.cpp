@@ -0,0 +1,254 @@
+#include "impostors.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <osg/Fog>
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/LightModel>
+#include <osg/LightSource>
+#include <osg/Texture2D>
+
+#include <components/resource/scenemanager.hpp>
+#include <components/sceneutil/shadow.hpp>
+#include <components/shader/shadermanager.hpp>
+
+#include "vismask.hpp"
+
+namespace
+{
+    osg::ref_ptr<osg::StateSet> createBakeStateSet()
+    {
+        osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+
+        // assign large value to effectively turn off fog
+        // shaders don't respect glDisable(GL_FOG)
+        osg::ref_ptr<osg::Fog> fog (new osg::Fog);
+        fog->setStart(10000000);
+        fog->setEnd(10000000);
+        stateset->setAttributeAndModes(fog, osg::StateAttribute::OFF|osg::StateAttribute::OVERRIDE);
+
+        // Full ambient light and no other light bakes the unlit colors, impostor_fragment.glsl applies the scene's lighting
+        osg::ref_ptr<osg::LightModel> lightmodel = new osg::LightModel;
+        lightmodel->setAmbientIntensity(osg::Vec4(1.f, 1.f, 1.f, 1.f));
+        stateset->setAttributeAndModes(lightmodel, osg::StateAttribute::ON|osg::StateAttribute::OVERRIDE);
+
+        SceneUtil::ShadowManager::disableShadowsForStateSet(stateset);
+        return stateset;
+    }
+
+    osg::ref_ptr<osg::LightSource> createBakeLight(osg::StateSet& stateset)
+    {
+        // The shaders always apply light 0, so replace whatever the sun left there with a black light
+        osg::ref_ptr<osg::Light> light = new osg::Light;
+        light->setPosition(osg::Vec4(0.f, 0.f, 1.f, 0.f));
+        light->setDiffuse(osg::Vec4(0,0,0,1));
+        light->setAmbient(osg::Vec4(0,0,0,1));
+        light->setSpecular(osg::Vec4(0,0,0,0));
+        light->setLightNum(0);
+        light->setConstantAttenuation(1.f);
+        light->setLinearAttenuation(0.f);
+        light->setQuadraticAttenuation(0.f);
+
+        osg::ref_ptr<osg::LightSource> lightSource = new osg::LightSource;
+        lightSource->setLight(light);
+        lightSource->setStateSetModes(stateset, osg::StateAttribute::ON|osg::StateAttribute::OVERRIDE);
+        return lightSource;
+    }
+
+    class HideUntilBakedCallback : public osg::Drawable::CullCallback
+    {
+    public:
+        HideUntilBakedCallback(const MWRender::Impostor* impostor)
+            : mImpostor(impostor)
+        {
+        }
+
+        virtual bool cull(osg::NodeVisitor*, osg::Drawable*, osg::State*) const
+        {
+            return !mImpostor->mBaked;
+        }
+
+    private:
+        osg::ref_ptr<const MWRender::Impostor> mImpostor;
+    };
+}
+
+namespace MWRender
+{
+
+    ImpostorManager::ImpostorManager(Resource::SceneManager* sceneManager, osg::Group* rootNode, int resolution)
+        : mSceneManager(sceneManager)
+        , mRootNode(rootNode)
+        , mResolution(std::max(16, resolution))
+    {
+    }
+
+    ImpostorManager::~ImpostorManager()
+    {
+        for (const ActiveCamera& camera : mActiveCameras)
+            mRootNode->removeChild(camera.mCamera);
+    }
+
+    osg::ref_ptr<Impostor> ImpostorManager::getImpostor(const std::string& model, const osg::Node* templateNode)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        osg::ref_ptr<Impostor>& impostor = mImpostors[model];
+        if (impostor)
+            return impostor;
+
+        impostor = new Impostor;
+        impostor->mBound = templateNode->getBound();
+
+        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
+        texture->setTextureSize(mResolution * sNumViews, mResolution);
+        texture->setInternalFormat(GL_RGBA);
+        texture->setFilter(osg::Texture::MIN_FILTER, osg::Texture::LINEAR_MIPMAP_LINEAR);
+        texture->setFilter(osg::Texture::MAG_FILTER, osg::Texture::LINEAR);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+
+        Shader::ShaderManager& shaderManager = mSceneManager->getShaderManager();
+        osg::ref_ptr<osg::Shader> vertexShader = shaderManager.getShader("impostor_vertex.glsl", {}, osg::Shader::VERTEX);
+        osg::ref_ptr<osg::Shader> fragmentShader = shaderManager.getShader("impostor_fragment.glsl", {}, osg::Shader::FRAGMENT);
+
+        impostor->mStateSet = new osg::StateSet;
+        impostor->mStateSet->setTextureAttributeAndModes(0, texture, osg::StateAttribute::ON);
+        impostor->mStateSet->addUniform(new osg::Uniform("diffuseMap", 0));
+        impostor->mStateSet->addUniform(new osg::Uniform("numViews", static_cast<float>(sNumViews)));
+        impostor->mStateSet->addUniform(new osg::Uniform("gutter", static_cast<float>(getGutter()) / mResolution));
+        if (vertexShader && fragmentShader)
+            impostor->mStateSet->setAttributeAndModes(shaderManager.getProgram(vertexShader, fragmentShader), osg::StateAttribute::ON);
+
+        mPendingBakes.emplace_back(impostor, templateNode);
+        return impostor;
+    }
+
+    void ImpostorManager::update(unsigned int frameNumber)
+    {
+        // The draw of a frame can overlap with the update of the next one, so wait a frame longer before removing the cameras
+        auto it = mActiveCameras.begin();
+        for (; it != mActiveCameras.end() && it->mFrameNumber + 2 <= frameNumber; ++it)
+        {
+            mRootNode->removeChild(it->mCamera);
+            if (it->mImpostor)
+                it->mImpostor->mBaked = true;
+        }
+        mActiveCameras.erase(mActiveCameras.begin(), it);
+
+        std::vector<std::pair<osg::ref_ptr<Impostor>, osg::ref_ptr<const osg::Node> > > pendingBakes;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            pendingBakes.swap(mPendingBakes);
+
+            for (auto impostor = mImpostors.begin(); impostor != mImpostors.end();)
+            {
+                // No chunk uses the impostor anymore
+                if (impostor->second->mStateSet->referenceCount() == 1 && impostor->second->referenceCount() == 1)
+                    impostor = mImpostors.erase(impostor);
+                else
+                    ++impostor;
+            }
+        }
+
+        const std::size_t firstCamera = mActiveCameras.size();
+        for (const auto& pending : pendingBakes)
+            bake(*pending.first, pending.second);
+        for (std::size_t i = firstCamera; i < mActiveCameras.size(); ++i)
+            mActiveCameras[i].mFrameNumber = frameNumber;
+    }
+
+    void ImpostorManager::bake(Impostor& impostor, const osg::Node* templateNode)
+    {
+        osg::Texture2D* texture = static_cast<osg::Texture2D*>(impostor.mStateSet->getTextureAttribute(0, osg::StateAttribute::TEXTURE));
+        const osg::BoundingSphere& bound = impostor.mBound;
+        if (!bound.valid() || bound.radius() <= 0.f)
+            return;
+
+        osg::ref_ptr<osg::StateSet> stateset = createBakeStateSet();
+        osg::ref_ptr<osg::LightSource> lightSource = createBakeLight(*stateset);
+        osg::ref_ptr<osg::Node> instance = mSceneManager->createInstance(templateNode);
+
+        const float radius = bound.radius();
+        // The object fills the view except for the gutter, which is cleared and stays transparent
+        const float extent = radius * mResolution / (mResolution - 2 * getGutter());
+        for (int view = 0; view < sNumViews; ++view)
+        {
+            // Must match the view selection in impostor_vertex.glsl
+            const float angle = view * 2 * osg::PI / sNumViews;
+            const osg::Vec3f direction (std::sin(angle), std::cos(angle), 0.f);
+
+            osg::ref_ptr<osg::Camera> camera (new osg::Camera);
+            camera->setProjectionMatrixAsOrtho(-extent, extent, -extent, extent, radius * 0.5f, radius * 3.5f);
+            camera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+            camera->setViewMatrixAsLookAt(bound.center() + direction * radius * 2.f, bound.center(), osg::Vec3f(0, 0, 1));
+            camera->setReferenceFrame(osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT);
+            camera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT, osg::Camera::PIXEL_BUFFER_RTT);
+            camera->setRenderOrder(osg::Camera::PRE_RENDER, view);
+            camera->setViewport(view * mResolution, 0, mResolution, mResolution);
+            // The clear is limited to the viewport, so each view only clears its own part of the texture
+            camera->setClearColor(osg::Vec4(0.f, 0.f, 0.f, 0.f));
+            camera->setClearMask(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // Generate the mipmaps once the last view has been rendered
+            camera->attach(osg::Camera::COLOR_BUFFER, texture, 0, 0, view == sNumViews - 1);
+            camera->setNodeMask(Mask_RenderToTexture);
+
+            // Disable small feature culling, it's not going to be reliable for this camera
+            camera->setCullingMode((osg::Camera::DEFAULT_CULLING|osg::Camera::FAR_PLANE_CULLING) & ~(osg::CullStack::SMALL_FEATURE_CULLING));
+
+            camera->setStateSet(stateset);
+            camera->addChild(lightSource);
+            camera->addChild(instance);
+
+            mRootNode->addChild(camera);
+            ActiveCamera activeCamera;
+            activeCamera.mFrameNumber = 0;
+            activeCamera.mCamera = camera;
+            if (view == sNumViews - 1)
+                activeCamera.mImpostor = &impostor;
+            mActiveCameras.push_back(activeCamera);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> ImpostorManager::createBillboardGeometry(const Impostor& impostor)
+    {
+        osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+        geometry->setVertexArray(new osg::Vec3Array);
+        geometry->setTexCoordArray(0, new osg::Vec2Array, osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(1, new osg::Vec2Array, osg::Array::BIND_PER_VERTEX);
+        geometry->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES));
+        geometry->setUseDisplayList(false);
+        geometry->setUseVertexBufferObjects(true);
+        geometry->setStateSet(impostor.mStateSet);
+        geometry->setCullCallback(new HideUntilBakedCallback(&impostor));
+        return geometry;
+    }
+
+    void ImpostorManager::addBillboard(osg::Geometry& geometry, const osg::Vec3f& center, float radius, float rotation)
+    {
+        osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(geometry.getVertexArray());
+        osg::Vec2Array* corners = static_cast<osg::Vec2Array*>(geometry.getTexCoordArray(0));
+        osg::Vec2Array* parameters = static_cast<osg::Vec2Array*>(geometry.getTexCoordArray(1));
+        osg::DrawElementsUInt* indices = static_cast<osg::DrawElementsUInt*>(geometry.getPrimitiveSet(0));
+
+        // The quad is expanded towards the camera in the vertex shader
+        const unsigned int first = vertices->size();
+        const osg::Vec2f quad[4] = { osg::Vec2f(-1, -1), osg::Vec2f(1, -1), osg::Vec2f(1, 1), osg::Vec2f(-1, 1) };
+        for (const osg::Vec2f& corner : quad)
+        {
+            vertices->push_back(center);
+            corners->push_back(corner);
+            parameters->push_back(osg::Vec2f(radius, rotation));
+        }
+        const unsigned int triangles[6] = { 0, 1, 2, 0, 2, 3 };
+        for (unsigned int index : triangles)
+            indices->push_back(first + index);
+
+        osg::BoundingBox bound = geometry.getInitialBound();
+        bound.expandBy(osg::BoundingSphere(center, radius));
+        geometry.setInitialBound(bound);
+        geometry.dirtyBound();
+    }
+
+}
@@ -0,0 +1,102 @@
+#ifndef OPENMW_MWRENDER_IMPOSTORS_H
+#define OPENMW_MWRENDER_IMPOSTORS_H
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <osg/BoundingSphere>
+#include <osg/Camera>
+#include <osg/ref_ptr>
+#include <osg/StateSet>
+
+namespace osg
+{
+    class Geometry;
+    class Group;
+    class Node;
+}
+
+namespace Resource
+{
+    class SceneManager;
+}
+
+namespace MWRender
+{
+
+    /// Unlit views of an object, rendered from several directions around its vertical axis into one texture.
+    class Impostor : public osg::Referenced
+    {
+    public:
+        Impostor() : mBaked(false) {}
+
+        /// Texture, shader program and uniforms, to be used for the billboards of this object.
+        osg::ref_ptr<osg::StateSet> mStateSet;
+
+        /// The bounds of the object in its own coordinate system, the billboards cover this sphere.
+        osg::BoundingSphere mBound;
+
+        /// Set once the views are rendered, the texture has undefined contents before.
+        std::atomic<bool> mBaked;
+    };
+
+    /// @brief Bakes impostors of static objects on demand, see ObjectPaging.
+    /// @par A requested impostor can be used right away, its texture is rendered by pre-render cameras
+    /// that are added to the scene in the next update and removed again once they have rendered.
+    /// The billboards are hidden until then. The views are lit in the shader, so they follow the sun and ambient light.
+    class ImpostorManager
+    {
+    public:
+        /// @param rootNode Node to attach the baking cameras to.
+        /// @param resolution Size in pixels of a single view.
+        ImpostorManager(Resource::SceneManager* sceneManager, osg::Group* rootNode, int resolution);
+        ~ImpostorManager();
+
+        /// @note Thread safe.
+        osg::ref_ptr<Impostor> getImpostor(const std::string& model, const osg::Node* templateNode);
+
+        /// Start rendering the requested impostors and clean up finished cameras and unused impostors.
+        void update(unsigned int frameNumber);
+
+        /// Add the billboards of one object to a geometry that is rendered with the impostor's StateSet.
+        /// @param center The center of the object's bounding sphere, in the coordinate system of the geometry.
+        /// @param rotation Rotation of the object around the z axis in radians.
+        static void addBillboard(osg::Geometry& geometry, const osg::Vec3f& center, float radius, float rotation);
+
+        /// Create an empty geometry for addBillboard(), hidden until the impostor is baked.
+        static osg::ref_ptr<osg::Geometry> createBillboardGeometry(const Impostor& impostor);
+
+        /// The number of directions each object is rendered from.
+        static const int sNumViews = 8;
+
+    private:
+        void bake(Impostor& impostor, const osg::Node* templateNode);
+
+        /// Transparent border in pixels around each view, keeps linear filtering and mipmaps from bleeding into the neighbouring views.
+        int getGutter() const { return std::max(1, mResolution / 16); }
+
+        Resource::SceneManager* mSceneManager;
+        osg::ref_ptr<osg::Group> mRootNode;
+        int mResolution;
+
+        std::map<std::string, osg::ref_ptr<Impostor> > mImpostors;
+        std::vector<std::pair<osg::ref_ptr<Impostor>, osg::ref_ptr<const osg::Node> > > mPendingBakes;
+        std::mutex mMutex;
+
+        struct ActiveCamera
+        {
+            unsigned int mFrameNumber;
+            osg::ref_ptr<osg::Camera> mCamera;
+            // Only set for the camera that renders the last view
+            osg::ref_ptr<Impostor> mImpostor;
+        };
+        std::vector<ActiveCamera> mActiveCameras;
+    };
+
+}
+
+#endif
@@ -715,14 +715,18 @@ void NpcAnimation::updateParts()
 
 PartHolderPtr NpcAnimation::insertBoundedPart(const std::string& model, const std::string& bonename, const std::string& bonefilter, bool enchantedGlow, osg::Vec4f* glowColor)
 {
-    osg::ref_ptr<osg::Node> instance = mResourceSystem->getSceneManager()->getInstance(model);
-
     const NodeMap& nodeMap = getNodeMap();
     NodeMap::const_iterator found = nodeMap.find(Misc::StringUtils::lowerCase(bonename));
     if (found == nodeMap.end())
         throw std::runtime_error("Can't find attachment node " + bonename);
 
-    osg::ref_ptr<osg::Node> attached = SceneUtil::attach(instance, mObjectRoot, bonefilter, found->second);
+    // Skinned parts only need their geometry, there is no need to clone their bones
+    osg::ref_ptr<osg::Node> attached = mResourceSystem->getSceneManager()->getSkinnedInstance(model, mObjectRoot, bonefilter);
+    if (!attached)
+    {
+        osg::ref_ptr<osg::Node> instance = mResourceSystem->getSceneManager()->getInstance(model);
+        attached = SceneUtil::attach(instance, mObjectRoot, bonefilter, found->second);
+    }
     if (enchantedGlow)
         mGlowUpdater = SceneUtil::addEnchantedGlow(attached, mResourceSystem, *glowColor);
 
@@ -1,5 +1,6 @@
 #include "objectpaging.hpp"
 
+#include <thread>
 #include <unordered_map>
 
 #include <osg/Version>
@@ -31,6 +32,7 @@
 #include "apps/openmw/mwbase/world.hpp"
 
 #include "vismask.hpp"
+#include "impostors.hpp"
 
 namespace MWRender
 {
@@ -267,6 +269,29 @@ namespace MWRender
         std::set<ESM::RefNum> mRefnums;
     };
 
+    /// The instances a chunk was built from, with whether they were merged, and the refnums of an active grid chunk.
+    class ChunkInputs : public osg::Object
+    {
+    public:
+        ChunkInputs(){}
+        ChunkInputs(const ChunkInputs& copy, const osg::CopyOp&) : mInstances(copy.mInstances), mRefnums(copy.mRefnums) {}
+        META_Object(MWRender, ChunkInputs)
+        std::vector<std::pair<ESM::RefNum, bool>> mInstances;
+        std::set<ESM::RefNum> mRefnums;
+        bool operator==(const ChunkInputs& other) const { return mInstances == other.mInstances && mRefnums == other.mRefnums; }
+    };
+
+    const ChunkInputs* getChunkInputs(const osg::Object& chunk)
+    {
+        const osg::UserDataContainer* udc = chunk.getUserDataContainer();
+        if (!udc)
+            return nullptr;
+        for (unsigned int i=0; i<udc->getNumUserObjects(); ++i)
+            if (const ChunkInputs* inputs = dynamic_cast<const ChunkInputs*>(udc->getUserObject(i)))
+                return inputs;
+        return nullptr;
+    }
+
     class AnalyzeVisitor : public osg::NodeVisitor
     {
     public:
@@ -362,7 +387,10 @@ namespace MWRender
     ObjectPaging::ObjectPaging(Resource::SceneManager* sceneManager)
             : GenericResourceManager<ChunkId>(nullptr)
          , mSceneManager(sceneManager)
+         , mWorkQueue(nullptr)
+         , mImpostorManager(nullptr)
          , mRefTrackerLocked(false)
+         , mInvalidatedCache(new CacheType)
     {
         mActiveGrid = Settings::Manager::getBool("object paging active grid", "Terrain");
         mDebugBatches = Settings::Manager::getBool("object paging debug batches", "Terrain");
@@ -370,6 +398,9 @@ namespace MWRender
         mMinSize = Settings::Manager::getFloat("object paging min size", "Terrain");
         mMinSizeMergeFactor = Settings::Manager::getFloat("object paging min size merge factor", "Terrain");
         mMinSizeCostMultiplier = Settings::Manager::getFloat("object paging min size cost multiplier", "Terrain");
+        int optimizerThreads = Settings::Manager::getInt("object paging optimizer threads", "Terrain");
+        mOptimizerThreads = optimizerThreads > 0 ? optimizerThreads : std::thread::hardware_concurrency();
+        mImpostorChunkSize = Settings::Manager::getFloat("object paging impostor chunk size", "Terrain");
     }
 
     osg::ref_ptr<osg::Node> ObjectPaging::createChunk(float size, const osg::Vec2f& center, bool activeGrid, const osg::Vec3f& viewPoint, bool compile)
@@ -396,7 +427,7 @@ namespace MWRender
                         unsigned int index = cell->mContextList.at(i).index;
                         if (esm.size()<=index)
                             esm.resize(index+1);
-                        cell->restore(esm[index], i);
+                        cell->restoreRefs(esm[index], i);
                         ESM::CellRef ref;
                         ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
                         bool deleted = false;
@@ -440,8 +471,10 @@ namespace MWRender
         struct InstanceList
         {
             std::vector<const ESM::CellRef*> mInstances;
+            std::string mModel;
             AnalyzeVisitor::Result mAnalyzeResult;
             bool mNeedCompile = false;
+            bool mMerge = false;
         };
         typedef std::map<osg::ref_ptr<const osg::Node>, InstanceList> NodeMap;
         NodeMap nodes;
@@ -521,6 +554,7 @@ namespace MWRender
             {
                 const_cast<osg::Node*>(cnode.get())->accept(analyzeVisitor); // const-trickery required because there is no const version of NodeVisitor
                 emplaced.first->second.mAnalyzeResult = analyzeVisitor.retrieveResult();
+                emplaced.first->second.mModel = model;
                 emplaced.first->second.mNeedCompile = compile && cnode->referenceCount() <= 3;
             }
             else
@@ -528,20 +562,20 @@ namespace MWRender
             emplaced.first->second.mInstances.push_back(&ref);
         }
 
-        osg::ref_ptr<osg::Group> group = new osg::Group;
-        osg::ref_ptr<osg::Group> mergeGroup = new osg::Group;
-        osg::ref_ptr<TemplateRef> templateRefs = new TemplateRef;
-        osgUtil::StateToCompile stateToCompile(0, nullptr);
-        CopyOp copyop;
-        for (const auto& pair : nodes)
+        // Decide which instances end up in the chunk before building it
+        osg::ref_ptr<ChunkInputs> inputs = new ChunkInputs;
+        if (refnumSet)
+            inputs->mRefnums = refnumSet->mRefnums;
+        for (auto& pair : nodes)
         {
             const osg::Node* cnode = pair.first;
+            InstanceList& instanceList = pair.second;
 
-            const AnalyzeVisitor::Result& analyzeResult = pair.second.mAnalyzeResult;
+            const AnalyzeVisitor::Result& analyzeResult = instanceList.mAnalyzeResult;
 
             float mergeCost = analyzeResult.mNumVerts * size;
             float mergeBenefit = analyzeVisitor.getMergeBenefit(analyzeResult) * mMergeFactor;
-            bool merge = mergeBenefit > mergeCost;
+            instanceList.mMerge = mergeBenefit > mergeCost;
 
             float minSizeMerged = mMinSize;
             float factor2 = mergeBenefit > 0 ? std::min(1.f, mergeCost * mMinSizeCostMultiplier / mergeBenefit) : 1;
@@ -549,14 +583,63 @@ namespace MWRender
             if (minSizeMergeFactor2 > 0)
                 minSizeMerged *= minSizeMergeFactor2;
 
+            if (!activeGrid && minSizeMerged != minSize)
+            {
+                auto tooSmall = [&] (const ESM::CellRef* cref) { return cnode->getBound().radius2() * cref->mScale*cref->mScale < (viewPoint-cref->mPos.asVec3()).length2()*minSizeMerged*minSizeMerged; };
+                instanceList.mInstances.erase(std::remove_if(instanceList.mInstances.begin(), instanceList.mInstances.end(), tooSmall), instanceList.mInstances.end());
+            }
+
+            for (auto cref : instanceList.mInstances)
+                inputs->mInstances.emplace_back(cref->mRefNum, instanceList.mMerge);
+        }
+        std::sort(inputs->mInstances.begin(), inputs->mInstances.end());
+
+        // Rebuilding a chunk after an enabled, disabled or blacklisted object usually leaves its instances unchanged.
+        // Reuse the invalidated chunk then, it was built from an older view point just like any other cached chunk.
+        ChunkId id = std::make_tuple(center, size, activeGrid);
+        osg::ref_ptr<osg::Object> invalidated = mInvalidatedCache->getRefFromObjectCache(id);
+        if (invalidated)
+        {
+            mInvalidatedCache->removeFromObjectCache(id);
+            const ChunkInputs* invalidatedInputs = getChunkInputs(*invalidated);
+            if (invalidatedInputs && *invalidatedInputs == *inputs)
+                return invalidated->asNode();
+        }
+
+        osg::ref_ptr<osg::Group> group = new osg::Group;
+        osg::ref_ptr<osg::Group> mergeGroup = new osg::Group;
+        osg::ref_ptr<TemplateRef> templateRefs = new TemplateRef;
+        osgUtil::StateToCompile stateToCompile(0, nullptr);
+        CopyOp copyop;
+        for (const auto& pair : nodes)
+        {
+            const osg::Node* cnode = pair.first;
+            bool merge = pair.second.mMerge;
+
+            // Distant chunks render static objects as billboards
+            osg::ref_ptr<osg::Geometry> impostorGeometry;
+            osg::BoundingSphere impostorBound;
+            if (mImpostorManager && !activeGrid && size >= mImpostorChunkSize && cnode->getNumChildrenRequiringUpdateTraversal() == 0)
+            {
+                osg::ref_ptr<Impostor> impostor = mImpostorManager->getImpostor(pair.second.mModel, cnode);
+                impostorBound = impostor->mBound;
+                if (impostorBound.valid())
+                    impostorGeometry = ImpostorManager::createBillboardGeometry(*impostor);
+            }
+
             unsigned int numinstances = 0;
             for (auto cref : pair.second.mInstances)
             {
                 const ESM::CellRef& ref = *cref;
                 osg::Vec3f pos = ref.mPos.asVec3();
 
-                if (!activeGrid && minSizeMerged != minSize && cnode->getBound().radius2() * cref->mScale*cref->mScale < (viewPoint-pos).length2()*minSizeMerged*minSizeMerged)
+                // The views are only baked around the vertical axis
+                if (impostorGeometry && std::abs(ref.mPos.rot[0]) < 0.01f && std::abs(ref.mPos.rot[1]) < 0.01f)
+                {
+                    osg::Vec3f center = osg::Quat(ref.mPos.rot[2], osg::Vec3f(0,0,-1)) * (impostorBound.center() * ref.mScale) + pos - worldCenter;
+                    ImpostorManager::addBillboard(*impostorGeometry, center, impostorBound.radius() * ref.mScale, -ref.mPos.rot[2]);
                     continue;
+                }
 
                 osg::Matrixf matrix;
                 matrix.preMultTranslate(pos - worldCenter);
@@ -593,6 +676,8 @@ namespace MWRender
                 attachTo->addChild(trans);
                 ++numinstances;
             }
+            if (impostorGeometry && impostorGeometry->getVertexArray()->getNumElements() > 0)
+                group->addChild(impostorGeometry);
             if (numinstances > 0)
             {
                 // add a ref to the original template, to hint to the cache that it's still being used and should be kept in cache
@@ -618,6 +703,8 @@ namespace MWRender
                 optimizer.setMergeAlphaBlending(true);
             }
             optimizer.setIsOperationPermissibleForObjectCallback(new CanOptimizeCallback);
+            optimizer.setNumThreads(mOptimizerThreads);
+            optimizer.setWorkQueue(mWorkQueue);
             unsigned int options = SceneUtil::Optimizer::FLATTEN_STATIC_TRANSFORMS|SceneUtil::Optimizer::REMOVE_REDUNDANT_NODES|SceneUtil::Optimizer::MERGE_GEOMETRY;
             optimizer.optimize(mergeGroup, options);
 
@@ -652,6 +739,7 @@ namespace MWRender
             group->addCullCallback(new SceneUtil::LightListCallback);
         }
         udc->addUserObject(templateRefs);
+        udc->addUserObject(inputs);
 
         return group;
     }
@@ -710,7 +798,7 @@ namespace MWRender
         mCache->call(ccf);
         if (ccf.mToClear.empty()) return false;
         for (auto chunk : ccf.mToClear)
-            mCache->removeFromObjectCache(chunk);
+            invalidateChunk(chunk);
         return true;
     }
 
@@ -732,10 +820,28 @@ namespace MWRender
         mCache->call(ccf);
         if (ccf.mToClear.empty()) return false;
         for (auto chunk : ccf.mToClear)
-            mCache->removeFromObjectCache(chunk);
+            invalidateChunk(chunk);
         return true;
     }
 
+    void ObjectPaging::invalidateChunk(const ChunkId& id)
+    {
+        osg::ref_ptr<osg::Object> chunk = mCache->getRefFromObjectCache(id);
+        if (!chunk)
+            return;
+        mInvalidatedCache->addEntryToObjectCache(id, chunk);
+        mCache->removeFromObjectCache(id);
+    }
+
+    struct CollectChunksFunctor
+    {
+        void operator()(MWRender::ChunkId id, osg::Object* obj)
+        {
+            mChunks.push_back(id);
+        }
+        std::vector<MWRender::ChunkId> mChunks;
+    };
+
 
     void ObjectPaging::clear()
     {
@@ -756,7 +862,10 @@ namespace MWRender
             else
                 mRefTracker = mRefTrackerNew;
         }
-        mCache->clear();
+        CollectChunksFunctor ccf;
+        mCache->call(ccf);
+        for (const auto& chunk : ccf.mChunks)
+            invalidateChunk(chunk);
         return true;
     }
 
@@ -789,6 +898,25 @@ namespace MWRender
         mCache->call(grf);
     }
 
+    void ObjectPaging::updateCache(double referenceTime)
+    {
+        GenericResourceManager<ChunkId>::updateCache(referenceTime);
+        mInvalidatedCache->updateTimeStampOfObjectsInCacheWithExternalReferences(referenceTime);
+        mInvalidatedCache->removeExpiredObjectsInCache(referenceTime - mExpiryDelay);
+    }
+
+    void ObjectPaging::clearCache()
+    {
+        GenericResourceManager<ChunkId>::clearCache();
+        mInvalidatedCache->clear();
+    }
+
+    void ObjectPaging::releaseGLObjects(osg::State* state)
+    {
+        GenericResourceManager<ChunkId>::releaseGLObjects(state);
+        mInvalidatedCache->releaseGLObjects(state);
+    }
+
     void ObjectPaging::reportStats(unsigned int frameNumber, osg::Stats *stats) const
     {
         stats->setAttribute(frameNumber, "Object Chunk", mCache->getCacheSize());
@@ -15,9 +15,14 @@ namespace MWWorld
 {
     class ESMStore;
 }
+namespace SceneUtil
+{
+    class WorkQueue;
+}
 
 namespace MWRender
 {
+    class ImpostorManager;
 
     typedef std::tuple<osg::Vec2f, float, bool> ChunkId; // Center, Size, ActiveGrid
 
@@ -45,10 +50,22 @@ namespace MWRender
         /// @return true if view needs rebuild
         bool unlockCache();
 
+        void updateCache(double referenceTime) override;
+
+        void clearCache() override;
+
+        void releaseGLObjects(osg::State* state) override;
+
         void reportStats(unsigned int frameNumber, osg::Stats* stats) const override;
 
         void getPagedRefnums(const osg::Vec4i &activeGrid, std::set<ESM::RefNum> &out);
 
+        /// Render static objects in chunks of at least the 'object paging impostor chunk size' as billboards, may be nullptr.
+        void setImpostorManager(ImpostorManager* impostorManager) { mImpostorManager = impostorManager; }
+
+        /// Let the threads of the work queue help the optimizer of merged chunks, may be nullptr.
+        void setWorkQueue(SceneUtil::WorkQueue* workQueue) { mWorkQueue = workQueue; }
+
     private:
         Resource::SceneManager* mSceneManager;
         bool mActiveGrid;
@@ -57,6 +74,10 @@ namespace MWRender
         float mMinSize;
         float mMinSizeMergeFactor;
         float mMinSizeCostMultiplier;
+        unsigned int mOptimizerThreads;
+        SceneUtil::WorkQueue* mWorkQueue;
+        ImpostorManager* mImpostorManager;
+        float mImpostorChunkSize;
 
         std::mutex mRefTrackerMutex;
         struct RefTracker
@@ -72,6 +93,11 @@ namespace MWRender
         const RefTracker& getRefTracker() const { return mRefTracker; }
         RefTracker& getWritableRefTracker() { return mRefTrackerLocked ? mRefTrackerNew : mRefTracker; }
 
+        /// Chunks removed from the cache by enabled, disabled or blacklisted objects, reused when rebuilding them gives the same instances.
+        osg::ref_ptr<CacheType> mInvalidatedCache;
+
+        void invalidateChunk(const ChunkId& id);
+
         std::mutex mSizeCacheMutex;
         typedef std::map<ESM::RefNum, float> SizeCache;
         SizeCache mSizeCache;
@@ -44,6 +44,7 @@
 #include <components/sceneutil/unrefqueue.hpp>
 #include <components/sceneutil/writescene.hpp>
 #include <components/sceneutil/shadow.hpp>
+#include <components/sceneutil/skeleton.hpp>
 
 #include <components/terrain/terraingrid.hpp>
 #include <components/terrain/quadtreeworld.hpp>
@@ -74,6 +75,7 @@
 #include "recastmesh.hpp"
 #include "fogmanager.hpp"
 #include "objectpaging.hpp"
+#include "impostors.hpp"
 
 
 namespace MWRender
@@ -193,7 +195,7 @@ namespace MWRender
 
     RenderingManager::RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode,
                                        Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                                       const std::string& resourcePath, DetourNavigator::Navigator& navigator)
+                                       const std::string& resourcePath, const std::string& contentCachePath, DetourNavigator::Navigator& navigator)
         : mViewer(viewer)
         , mRootNode(rootNode)
         , mResourceSystem(resourceSystem)
@@ -216,6 +218,7 @@ namespace MWRender
         resourceSystem->getSceneManager()->setNormalHeightMapPattern(Settings::Manager::getString("normal height map pattern", "Shaders"));
         resourceSystem->getSceneManager()->setAutoUseSpecularMaps(Settings::Manager::getBool("auto use object specular maps", "Shaders"));
         resourceSystem->getSceneManager()->setSpecularMapPattern(Settings::Manager::getString("specular map pattern", "Shaders"));
+        resourceSystem->getSceneManager()->setGpuSkinning(Settings::Manager::getBool("gpu skinning", "Shaders"));
 
         osg::ref_ptr<SceneUtil::LightManager> sceneRoot = new SceneUtil::LightManager;
         sceneRoot->setLightingMask(Mask_Lighting);
@@ -237,6 +240,8 @@ namespace MWRender
             shadowCastingTraversalMask |= (Mask_Object|Mask_Static);
 
         mShadowManager.reset(new SceneUtil::ShadowManager(sceneRoot, mRootNode, shadowCastingTraversalMask, indoorShadowCastingTraversalMask, mResourceSystem->getSceneManager()->getShaderManager()));
+        if (Settings::Manager::getBool("cache static shadows", "Shadows"))
+            mShadowManager->enableStaticCasterCaching(Mask_Terrain|Mask_Static, Mask_Actor|Mask_Player|Mask_Object);
 
         Shader::ShaderManager::DefineMap shadowDefines = mShadowManager->getShadowDefines();
         Shader::ShaderManager::DefineMap globalDefines = mResourceSystem->getSceneManager()->getShaderManager().getGlobalDefines();
@@ -276,6 +281,8 @@ namespace MWRender
         const bool useTerrainSpecularMaps = Settings::Manager::getBool("auto use terrain specular maps", "Shaders");
 
         mTerrainStorage = new TerrainStorage(mResourceSystem, normalMapPattern, heightMapPattern, useTerrainNormalMaps, specularMapPattern, useTerrainSpecularMaps);
+        if (!contentCachePath.empty())
+            mTerrainStorage->setCachePath(contentCachePath + "/terrain");
 
         if (Settings::Manager::getBool("distant terrain", "Terrain"))
         {
@@ -293,8 +300,16 @@ namespace MWRender
             if (Settings::Manager::getBool("object paging", "Terrain"))
             {
                 mObjectPaging.reset(new ObjectPaging(mResourceSystem->getSceneManager()));
+                mObjectPaging->setWorkQueue(mWorkQueue.get());
                 static_cast<Terrain::QuadTreeWorld*>(mTerrain.get())->addChunkManager(mObjectPaging.get());
                 mResourceSystem->addResourceManager(mObjectPaging.get());
+
+                if (Settings::Manager::getBool("object paging impostors", "Terrain"))
+                {
+                    mImpostorManager.reset(new ImpostorManager(mResourceSystem->getSceneManager(), mRootNode,
+                        Settings::Manager::getInt("object paging impostor resolution", "Terrain")));
+                    mObjectPaging->setImpostorManager(mImpostorManager.get());
+                }
             }
         }
         else
@@ -512,6 +527,8 @@ namespace MWRender
 
         if (store->getCell()->isExterior())
             mTerrain->loadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
+
+        mShadowManager->invalidateStaticCasterCache();
     }
     void RenderingManager::removeCell(const MWWorld::CellStore *store)
     {
@@ -523,6 +540,8 @@ namespace MWRender
             mTerrain->unloadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
 
         mWater->removeCell(store);
+
+        mShadowManager->invalidateStaticCasterCache();
     }
 
     void RenderingManager::enableTerrain(bool enable)
@@ -620,6 +639,9 @@ namespace MWRender
         updateNavMesh();
         updateRecastMesh();
 
+        if (mImpostorManager)
+            mImpostorManager->update(mViewer->getFrameStamp()->getFrameNumber());
+
         if (mViewOverShoulderController)
             mViewOverShoulderController->update();
         mCamera->update(dt, paused);
@@ -658,16 +680,19 @@ namespace MWRender
         }
 
         ptr.getRefData().getBaseNode()->setAttitude(rot);
+        invalidateStaticShadows(ptr);
     }
 
     void RenderingManager::moveObject(const MWWorld::Ptr &ptr, const osg::Vec3f &pos)
     {
         ptr.getRefData().getBaseNode()->setPosition(pos);
+        invalidateStaticShadows(ptr);
     }
 
     void RenderingManager::scaleObject(const MWWorld::Ptr &ptr, const osg::Vec3f &scale)
     {
         ptr.getRefData().getBaseNode()->setScale(scale);
+        invalidateStaticShadows(ptr);
 
         if (ptr == mCamera->getTrackingPtr()) // update height of camera
             mCamera->processViewChange();
@@ -675,11 +700,19 @@ namespace MWRender
 
     void RenderingManager::removeObject(const MWWorld::Ptr &ptr)
     {
+        invalidateStaticShadows(ptr);
         mActorsPaths->remove(ptr);
         mObjects->removeObject(ptr);
         mWater->removeEmitter(ptr);
     }
 
+    void RenderingManager::invalidateStaticShadows(const MWWorld::Ptr &ptr)
+    {
+        const osg::Node* baseNode = ptr.getRefData().getBaseNode();
+        if (baseNode && baseNode->getNodeMask() == Mask_Static)
+            mShadowManager->invalidateStaticCasterCache();
+    }
+
     void RenderingManager::setWaterEnabled(bool enabled)
     {
         mWater->setEnabled(enabled);
@@ -1278,6 +1311,12 @@ namespace MWRender
             stats->setAttribute(frameNumber, "UnrefQueue", mUnrefQueue->getNumItems());
 
             mTerrain->reportStats(frameNumber, stats);
+
+            unsigned int numUpdated = 0;
+            unsigned int numSkipped = 0;
+            SceneUtil::Skeleton::takeUpdateStats(numUpdated, numSkipped);
+            stats->setAttribute(frameNumber, "Animation Updated", numUpdated);
+            stats->setAttribute(frameNumber, "Animation Skipped", numSkipped);
         }
     }
 
@@ -1436,6 +1475,7 @@ namespace MWRender
         if (mObjectPaging->enableObject(type, ptr.getCellRef().getRefNum(), ptr.getCellRef().getPosition().asVec3(), osg::Vec2i(ptr.getCell()->getCell()->getGridX(), ptr.getCell()->getCell()->getGridY()), enabled))
         {
             mTerrain->rebuildViews();
+            mShadowManager->invalidateStaticCasterCache();
             return true;
         }
         return false;
@@ -1447,13 +1487,17 @@ namespace MWRender
         const ESM::RefNum & refnum = ptr.getCellRef().getRefNum();
         if (!refnum.hasContentFile()) return;
         if (mObjectPaging->blacklistObject(type, refnum, ptr.getCellRef().getPosition().asVec3(), osg::Vec2i(ptr.getCell()->getCell()->getGridX(), ptr.getCell()->getCell()->getGridY())))
+        {
             mTerrain->rebuildViews();
+            mShadowManager->invalidateStaticCasterCache();
+        }
     }
     bool RenderingManager::pagingUnlockCache()
     {
         if (mObjectPaging && mObjectPaging->unlockCache())
         {
             mTerrain->rebuildViews();
+            mShadowManager->invalidateStaticCasterCache();
             return true;
         }
         return false;
@@ -87,13 +87,15 @@ namespace MWRender
     class ActorsPaths;
     class RecastMesh;
     class ObjectPaging;
+    class ImpostorManager;
 
     class RenderingManager : public MWRender::RenderingInterface
     {
     public:
+        /// @param contentCachePath Directory for data baked from the loaded content files, empty if no such data is cached.
         RenderingManager(osgViewer::Viewer* viewer, osg::ref_ptr<osg::Group> rootNode,
                          Resource::ResourceSystem* resourceSystem, SceneUtil::WorkQueue* workQueue,
-                         const std::string& resourcePath, DetourNavigator::Navigator& navigator);
+                         const std::string& resourcePath, const std::string& contentCachePath, DetourNavigator::Navigator& navigator);
         ~RenderingManager();
 
         osgUtil::IncrementalCompileOperation* getIncrementalCompileOperation();
@@ -246,6 +248,9 @@ namespace MWRender
         void setFogColor(const osg::Vec4f& color);
         void updateThirdPersonViewMode();
 
+        /// Refresh the cached shadow maps if \a ptr casts static shadows.
+        void invalidateStaticShadows(const MWWorld::Ptr& ptr);
+
         void reportStats() const;
 
         void renderCameraToImage(osg::Camera *camera, osg::Image *image, int w, int h);
@@ -278,6 +283,7 @@ namespace MWRender
         std::unique_ptr<Water> mWater;
         std::unique_ptr<Terrain::World> mTerrain;
         TerrainStorage* mTerrainStorage;
+        std::unique_ptr<ImpostorManager> mImpostorManager;
         std::unique_ptr<ObjectPaging> mObjectPaging;
         std::unique_ptr<SkyManager> mSky;
         std::unique_ptr<FogManager> mFog;
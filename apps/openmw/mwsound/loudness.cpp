@@ -1,61 +1,66 @@
 #include "loudness.hpp"
 
 #include <stdint.h>
+#include <cmath>
+#include <cstring>
 #include <limits>
 #include <algorithm>
 
-#include "soundmanagerimp.hpp"
-
 namespace MWSound
 {
 
-void Sound_Loudness::analyzeLoudness(const std::vector< char >& data)
+void Sound_Loudness::analyzeLoudness(const char* data, size_t size)
 {
-    mQueue.insert( mQueue.end(), data.begin(), data.end() );
-    if (!mQueue.size())
+    const int samplesPerSegment = static_cast<int>(mSampleRate / mSamplesPerSec);
+    const size_t advance = framesToBytes(1, mChannelConfig, mSampleType);
+    if (samplesPerSegment <= 0 || advance == 0)
         return;
 
-    int samplesPerSegment = static_cast<int>(mSampleRate / mSamplesPerSec);
-    int numSamples = bytesToFrames(mQueue.size(), mChannelConfig, mSampleType);
-    int advance = framesToBytes(1, mChannelConfig, mSampleType);
-
-
-    int segment=0;
-    int sample=0;
-    while (segment < numSamples/samplesPerSegment)
+    if (!mPartialFrame.empty())
     {
-        float sum=0;
-        int samplesAdded = 0;
-        while (sample < numSamples && sample < (segment+1)*samplesPerSegment)
-        {
-            // get sample on a scale from -1 to 1
-            float value = 0;
-            if (mSampleType == SampleType_UInt8)
-                value = ((char)(mQueue[sample*advance]^0x80))/128.f;
-            else if (mSampleType == SampleType_Int16)
-            {
-                value = *reinterpret_cast<const int16_t*>(&mQueue[sample*advance]);
-                value /= float(std::numeric_limits<int16_t>::max());
-            }
-            else if (mSampleType == SampleType_Float32)
-            {
-                value = *reinterpret_cast<const float*>(&mQueue[sample*advance]);
-                value = std::max(-1.f, std::min(1.f, value)); // Float samples *should* be scaled to [-1,1] already.
-            }
+        const size_t missing = std::min(advance - mPartialFrame.size(), size);
+        mPartialFrame.insert(mPartialFrame.end(), data, data + missing);
+        data += missing;
+        size -= missing;
+        if (mPartialFrame.size() < advance)
+            return;
+        addFrame(mPartialFrame.data(), samplesPerSegment);
+        mPartialFrame.clear();
+    }
+
+    const size_t numFrames = size / advance;
+    for (size_t frame = 0; frame < numFrames; ++frame)
+        addFrame(data + frame*advance, samplesPerSegment);
 
-            sum += value*value;
-            ++samplesAdded;
-            ++sample;
-        }
+    mPartialFrame.assign(data + numFrames*advance, data + size);
+}
 
-        float rms = 0; // root mean square
-        if (samplesAdded > 0)
-            rms = std::sqrt(sum / samplesAdded);
-        mSamples.push_back(rms);
-        ++segment;
+void Sound_Loudness::addFrame(const char* frame, int samplesPerSegment)
+{
+    // get sample on a scale from -1 to 1
+    float value = 0;
+    if (mSampleType == SampleType_UInt8)
+        value = ((char)(*frame^0x80))/128.f;
+    else if (mSampleType == SampleType_Int16)
+    {
+        int16_t sample;
+        std::memcpy(&sample, frame, sizeof(sample));
+        value = sample / float(std::numeric_limits<int16_t>::max());
+    }
+    else if (mSampleType == SampleType_Float32)
+    {
+        std::memcpy(&value, frame, sizeof(value));
+        value = std::max(-1.f, std::min(1.f, value)); // Float samples *should* be scaled to [-1,1] already.
     }
 
-    mQueue.erase(mQueue.begin(), mQueue.begin() + sample*advance);
+    mSegmentSum += value*value;
+    if (++mSegmentSamples < samplesPerSegment)
+        return;
+
+    // root mean square
+    mSamples.push_back(std::sqrt(mSegmentSum / mSegmentSamples));
+    mSegmentSum = 0;
+    mSegmentSamples = 0;
 }
 
 
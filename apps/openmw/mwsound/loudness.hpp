@@ -2,7 +2,6 @@
 #define GAME_SOUND_LOUDNESS_H
 
 #include <vector>
-#include <deque>
 
 #include "sound_decoder.hpp"
 
@@ -18,7 +17,14 @@ class Sound_Loudness {
     // Loudness sample info
     std::vector<float> mSamples;
 
-    std::deque<char> mQueue;
+    // The segment that is currently being analyzed
+    float mSegmentSum;
+    int mSegmentSamples;
+
+    // The beginning of a frame that was split between two chunks of audio
+    std::vector<char> mPartialFrame;
+
+    void addFrame(const char* frame, int samplesPerSegment);
 
 public:
     /**
@@ -32,6 +38,8 @@ public:
         , mSampleRate(sampleRate)
         , mChannelConfig(chans)
         , mSampleType(type)
+        , mSegmentSum(0.f)
+        , mSegmentSamples(0)
     { }
 
     /**
@@ -40,11 +48,15 @@ public:
      * and for each segment a loudness value in the range of [0,1] will be computed.
      * The computed values are then added to the mSamples vector. This method should be called continuously
      * with chunks of audio until the whole audio file is processed.
-     * If the size of \a data does not exactly fit a number of loudness samples, the remainder
-     * will be kept in the mQueue and used in the next call to analyzeLoudness.
+     * If the size of \a data does not exactly fit a number of loudness samples, the energy of the remainder
+     * is kept and completed in the next call to analyzeLoudness, so each chunk is only looked at once.
      * @param data the sound buffer to analyze, containing raw samples
+     * @param size the size of \a data in bytes
      */
-    void analyzeLoudness(const std::vector<char>& data);
+    void analyzeLoudness(const char* data, size_t size);
+
+    void analyzeLoudness(const std::vector<char>& data)
+    { analyzeLoudness(data.data(), data.size()); }
 
     /**
      * Get loudness at a particular time. Before calling this, the stream has to be analyzed up to that point in time (see analyzeLoudness()).
@@ -0,0 +1,640 @@
+#include "null_output.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include <stdint.h>
+
+#include <osg/Math>
+
+#include <components/debug/debuglog.hpp>
+
+#include "sound_decoder.hpp"
+#include "sound.hpp"
+#include "soundmanagerimp.hpp"
+#include "loudness.hpp"
+
+namespace
+{
+
+const int sLoudnessFPS = 20; // loudness values per second of audio
+const int sSampleRate = 44100;
+const size_t sBlockFrames = 1024; // frames mixed at once
+const size_t sMaxUpdateFrames = sBlockFrames * 4; // frames mixed per update at most, the rest is dropped
+const size_t sStreamReadSize = 16384; // bytes decoded from a stream at once
+const float sSqrt2 = 1.41421356f;
+
+int getChannelCount(MWSound::ChannelConfig chans)
+{
+    switch(chans)
+    {
+        case MWSound::ChannelConfig_Mono: return 1;
+        case MWSound::ChannelConfig_Stereo: return 2;
+        case MWSound::ChannelConfig_Quad: return 4;
+        case MWSound::ChannelConfig_5point1: return 6;
+        case MWSound::ChannelConfig_7point1: return 8;
+    }
+    return 1;
+}
+
+float readSample(const char *data, MWSound::SampleType type)
+{
+    switch(type)
+    {
+        case MWSound::SampleType_UInt8:
+            return (static_cast<unsigned char>(*data) - 128) / 128.0f;
+        case MWSound::SampleType_Int16:
+        {
+            int16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value / 32768.0f;
+        }
+        case MWSound::SampleType_Float32:
+        {
+            float value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+    return 0.0f;
+}
+
+// Converts samples to floats, keeping mono sounds mono and mixing everything else down to stereo
+void appendSamples(const char *data, size_t frames, MWSound::ChannelConfig chans, MWSound::SampleType type, std::vector<float> &out)
+{
+    const int channels = getChannelCount(chans);
+    const size_t frameSize = MWSound::framesToBytes(1, chans, type);
+    const size_t sampleSize = frameSize / channels;
+    const bool hasCenter = chans == MWSound::ChannelConfig_5point1 || chans == MWSound::ChannelConfig_7point1;
+
+    out.reserve(out.size() + frames * std::min(channels, 2));
+    for(size_t i = 0;i < frames;++i, data += frameSize)
+    {
+        if(channels == 1)
+        {
+            out.push_back(readSample(data, type));
+            continue;
+        }
+
+        float left = readSample(data, type);
+        float right = readSample(data + sampleSize, type);
+        if(hasCenter)
+        {
+            const float center = readSample(data + 2*sampleSize, type) * 0.7071f;
+            left += center;
+            right += center;
+        }
+        out.push_back(left);
+        out.push_back(right);
+    }
+}
+
+void writeLE(std::ostream &stream, uint32_t value, int bytes)
+{
+    for(int i = 0;i < bytes;++i)
+        stream.put(static_cast<char>((value >> (8*i)) & 0xff));
+}
+
+}
+
+namespace MWSound
+{
+
+struct Null_Output::Buffer
+{
+    std::vector<float> mSamples;
+    int mChannels = 1;
+    int mSampleRate = sSampleRate;
+
+    size_t getFrames() const { return mSamples.size() / mChannels; }
+};
+
+struct Null_Output::Voice
+{
+    // The samples to play, mStreamBuffer for streams
+    const Buffer *mBuffer = nullptr;
+    // Position in frames of mBuffer
+    double mPosition = 0.0;
+    double mStep = 1.0;
+    float mGains[2] = { 0.0f, 0.0f };
+    bool mDownmix = false;
+    bool mLooping = false;
+    bool mPaused = false;
+    bool mFinished = false;
+
+    // Stream data: samples that were decoded but not played yet, and the number of frames before them
+    DecoderPtr mDecoder;
+    ChannelConfig mStreamChannels = ChannelConfig_Mono;
+    SampleType mStreamType = SampleType_Int16;
+    Buffer mStreamBuffer;
+    size_t mStreamOffset = 0;
+    bool mDecoderDone = false;
+    std::unique_ptr<Sound_Loudness> mLoudness;
+};
+
+
+std::vector<std::string> Null_Output::enumerate()
+{
+    std::vector<std::string> devlist;
+    devlist.emplace_back("Null Output");
+    return devlist;
+}
+
+bool Null_Output::init(const std::string &devname, const std::string &hrtfname, HrtfMode hrtfmode)
+{
+    deinit();
+
+    if(!mFileName.empty())
+    {
+        mFile.open(mFileName, std::ios::binary);
+        if(mFile.is_open())
+        {
+            Log(Debug::Info) << "Writing sound output to " << mFileName;
+            writeHeader();
+        }
+        else
+            Log(Debug::Warning) << "Warning: Failed to open sound output file " << mFileName << ", mixing into memory only";
+    }
+    else
+        Log(Debug::Info) << "Mixing sound output into memory";
+
+    mFramesWritten = 0;
+    mPendingFrames = 0.0;
+    mLastMixTime = std::chrono::steady_clock::now();
+    mInitialized = true;
+    return true;
+}
+
+void Null_Output::deinit()
+{
+    for(Sound *sound : mActiveSounds)
+    {
+        delete static_cast<Voice*>(sound->mHandle);
+        sound->mHandle = nullptr;
+    }
+    mActiveSounds.clear();
+    for(Stream *sound : mActiveStreams)
+    {
+        Voice *voice = static_cast<Voice*>(sound->mHandle);
+        voice->mDecoder->close();
+        delete voice;
+        sound->mHandle = nullptr;
+    }
+    mActiveStreams.clear();
+
+    if(mFile.is_open())
+    {
+        writeHeader();
+        mFile.close();
+    }
+
+    mInitialized = false;
+}
+
+
+std::vector<std::string> Null_Output::enumerateHrtf()
+{
+    return std::vector<std::string>();
+}
+
+void Null_Output::setHrtf(const std::string &hrtfname, HrtfMode hrtfmode)
+{
+}
+
+
+std::pair<Sound_Handle,size_t> Null_Output::loadSound(const DecodedSound &sound)
+{
+    Buffer *buffer = new Buffer;
+    if(!sound.mData.empty() && sound.mSampleRate > 0)
+    {
+        buffer->mChannels = std::min(getChannelCount(sound.mChannels), 2);
+        buffer->mSampleRate = sound.mSampleRate;
+        appendSamples(sound.mData.data(), bytesToFrames(sound.mData.size(), sound.mChannels, sound.mType),
+                      sound.mChannels, sound.mType, buffer->mSamples);
+    }
+    else
+    {
+        // If we failed to get any usable audio, substitute with silence.
+        buffer->mSampleRate = 8000;
+        buffer->mSamples.assign(8000, 0.0f);
+    }
+
+    return std::make_pair(buffer, buffer->mSamples.size() * sizeof(float));
+}
+
+size_t Null_Output::unloadSound(Sound_Handle data)
+{
+    if(!data) return 0;
+    Buffer *buffer = static_cast<Buffer*>(data);
+    const size_t size = buffer->mSamples.size() * sizeof(float);
+    delete buffer;
+    return size;
+}
+
+
+void Null_Output::initVoice(Voice &voice, const SoundBase &sound)
+{
+    voice.mLooping = sound.getIsLooping() && !voice.mDecoder;
+    voice.mDownmix = sound.getIs3D() && voice.mBuffer->mChannels == 2;
+    updateVoice(voice, sound);
+}
+
+void Null_Output::updateVoice(Voice &voice, const SoundBase &sound)
+{
+    float gain = sound.getRealVolume();
+    float pitch = sound.getPitch();
+
+    if(sound.getIs3D())
+    {
+        const osg::Vec3f offset = sound.getPosition() - mListenerPos;
+        const float distance = offset.length();
+        if(distance > sound.getMaxDistance())
+            gain = 0.0f;
+        else
+        {
+            // Inverse distance clamped model with a rolloff factor of 1, as set up for OpenAL.
+            // Like OpenAL, don't attenuate when the reference distance is not positive or above the max distance.
+            const float minDistance = sound.getMinDistance();
+            if(minDistance > 0.0f && minDistance <= sound.getMaxDistance())
+                gain *= minDistance / std::max(distance, minDistance);
+        }
+
+        // Constant power panning, normalized to the full gain in front of the listener
+        float pan = 0.0f;
+        osg::Vec3f right = mListenerDir ^ mListenerUp;
+        if(distance > 0.0f && right.normalize() > 0.0f)
+            pan = std::max(-1.0f, std::min((offset * right) / distance, 1.0f));
+        const float angle = (pan + 1.0f) * osg::PI_4;
+        voice.mGains[0] = gain * std::cos(angle) * sSqrt2;
+        voice.mGains[1] = gain * std::sin(angle) * sSqrt2;
+    }
+    else
+    {
+        voice.mGains[0] = gain;
+        voice.mGains[1] = gain;
+    }
+
+    if(sound.getUseEnv() && mListenerEnv == Env_Underwater)
+    {
+        // Same as the OpenAL output when the EFX water filter is not available
+        voice.mGains[0] *= 0.9f;
+        voice.mGains[1] *= 0.9f;
+        pitch *= 0.7f;
+    }
+
+    voice.mStep = static_cast<double>(pitch) * voice.mBuffer->mSampleRate / sSampleRate;
+}
+
+bool Null_Output::fillStream(Voice &voice, size_t frames)
+{
+    Buffer &buffer = voice.mStreamBuffer;
+
+    // Drop the samples that were played already, keeping the current frame for interpolation
+    const size_t played = std::min(static_cast<size_t>(voice.mPosition), buffer.getFrames());
+    buffer.mSamples.erase(buffer.mSamples.begin(), buffer.mSamples.begin() + played * buffer.mChannels);
+    voice.mPosition -= played;
+    voice.mStreamOffset += played;
+
+    while(!voice.mDecoderDone && buffer.getFrames() < frames)
+    {
+        try
+        {
+            mReadBuffer.resize(sStreamReadSize);
+            size_t got = voice.mDecoder->read(mReadBuffer.data(), mReadBuffer.size());
+            const size_t numFrames = bytesToFrames(got, voice.mStreamChannels, voice.mStreamType);
+            if(numFrames == 0)
+            {
+                voice.mDecoderDone = true;
+                break;
+            }
+
+            if(voice.mLoudness)
+                voice.mLoudness->analyzeLoudness(mReadBuffer.data(), framesToBytes(numFrames, voice.mStreamChannels, voice.mStreamType));
+            appendSamples(mReadBuffer.data(), numFrames, voice.mStreamChannels, voice.mStreamType, buffer.mSamples);
+        }
+        catch(std::exception &e)
+        {
+            Log(Debug::Error) << "Error updating stream \"" << voice.mDecoder->getName() << "\": " << e.what();
+            voice.mDecoderDone = true;
+        }
+    }
+
+    return buffer.getFrames() > 0;
+}
+
+void Null_Output::mixVoice(Voice &voice, size_t frames)
+{
+    if(voice.mPaused || voice.mFinished)
+        return;
+
+    const Buffer &buffer = *voice.mBuffer;
+    const size_t numFrames = buffer.getFrames();
+    const int channels = buffer.mChannels;
+    float *out = mMixBuffer.data();
+    for(size_t i = 0;i < frames;++i, out += 2)
+    {
+        size_t index = static_cast<size_t>(voice.mPosition);
+        if(index >= numFrames)
+        {
+            if(voice.mDecoder && !voice.mDecoderDone)
+                break;
+            if(!voice.mLooping || numFrames == 0)
+            {
+                voice.mFinished = true;
+                break;
+            }
+            voice.mPosition = std::fmod(voice.mPosition, static_cast<double>(numFrames));
+            index = std::min(static_cast<size_t>(voice.mPosition), numFrames - 1);
+        }
+
+        size_t next = index + 1;
+        if(next >= numFrames)
+            next = voice.mLooping ? 0 : index;
+        const float fraction = static_cast<float>(voice.mPosition - index);
+        const float *current = &buffer.mSamples[index * channels];
+        const float *following = &buffer.mSamples[next * channels];
+
+        float left = current[0] + (following[0] - current[0]) * fraction;
+        float right = left;
+        if(channels == 2)
+        {
+            right = current[1] + (following[1] - current[1]) * fraction;
+            if(voice.mDownmix)
+                left = right = (left + right) * 0.5f;
+        }
+        out[0] += left * voice.mGains[0];
+        out[1] += right * voice.mGains[1];
+
+        voice.mPosition += voice.mStep;
+    }
+}
+
+void Null_Output::mix(size_t frames)
+{
+    mMixBuffer.assign(frames * 2, 0.0f);
+
+    for(Sound *sound : mActiveSounds)
+        mixVoice(*static_cast<Voice*>(sound->mHandle), frames);
+    for(Stream *sound : mActiveStreams)
+    {
+        Voice &voice = *static_cast<Voice*>(sound->mHandle);
+        if(voice.mPaused || voice.mFinished)
+            continue;
+        const size_t needed = static_cast<size_t>(std::ceil(voice.mPosition + frames * voice.mStep)) + 2;
+        fillStream(voice, needed);
+        mixVoice(voice, frames);
+    }
+
+    if(!mFile.is_open())
+        return;
+
+    mReadBuffer.resize(mMixBuffer.size() * sizeof(int16_t));
+    char *data = mReadBuffer.data();
+    for(float sample : mMixBuffer)
+    {
+        const int16_t value = static_cast<int16_t>(std::max(-32768.0f, std::min(sample * 32768.0f, 32767.0f)));
+        *data++ = static_cast<char>(value & 0xff);
+        *data++ = static_cast<char>((value >> 8) & 0xff);
+    }
+    mFile.write(mReadBuffer.data(), mReadBuffer.size());
+    mFramesWritten += frames;
+}
+
+void Null_Output::writeHeader()
+{
+    const uint32_t dataSize = static_cast<uint32_t>(mFramesWritten * 2 * sizeof(int16_t));
+    mFile.seekp(0);
+    mFile.write("RIFF", 4);
+    writeLE(mFile, 36 + dataSize, 4);
+    mFile.write("WAVEfmt ", 8);
+    writeLE(mFile, 16, 4);
+    writeLE(mFile, 1, 2); // PCM
+    writeLE(mFile, 2, 2);
+    writeLE(mFile, sSampleRate, 4);
+    writeLE(mFile, sSampleRate * 2 * sizeof(int16_t), 4);
+    writeLE(mFile, 2 * sizeof(int16_t), 2);
+    writeLE(mFile, 16, 2);
+    mFile.write("data", 4);
+    writeLE(mFile, dataSize, 4);
+    mFile.seekp(0, std::ios::end);
+}
+
+
+bool Null_Output::playSound(Sound *sound, Sound_Handle data, float offset)
+{
+    const Buffer *buffer = static_cast<const Buffer*>(data);
+    const double position = static_cast<double>(offset) * buffer->mSampleRate;
+    if(offset > 0.0f && position >= buffer->getFrames())
+        return false;
+
+    Voice *voice = new Voice;
+    voice->mBuffer = buffer;
+    voice->mPosition = position;
+    initVoice(*voice, *sound);
+
+    sound->mHandle = voice;
+    mActiveSounds.push_back(sound);
+    return true;
+}
+
+bool Null_Output::playSound3D(Sound *sound, Sound_Handle data, float offset)
+{
+    return playSound(sound, data, offset);
+}
+
+void Null_Output::finishSound(Sound *sound)
+{
+    if(!sound->mHandle) return;
+    delete static_cast<Voice*>(sound->mHandle);
+    sound->mHandle = nullptr;
+    mActiveSounds.erase(std::find(mActiveSounds.begin(), mActiveSounds.end(), sound));
+}
+
+bool Null_Output::isSoundPlaying(Sound *sound)
+{
+    if(!sound->mHandle) return false;
+    return !static_cast<Voice*>(sound->mHandle)->mFinished;
+}
+
+void Null_Output::updateSound(Sound *sound)
+{
+    if(!sound->mHandle) return;
+    updateVoice(*static_cast<Voice*>(sound->mHandle), *sound);
+}
+
+
+bool Null_Output::streamSound(DecoderPtr decoder, Stream *sound, bool getLoudnessData)
+{
+    if(sound->getIsLooping())
+        Log(Debug::Warning) << "Warning: cannot loop stream \"" << decoder->getName() << "\"";
+
+    std::unique_ptr<Voice> voice (new Voice);
+    int sampleRate = 0;
+    try
+    {
+        decoder->getInfo(&sampleRate, &voice->mStreamChannels, &voice->mStreamType);
+    }
+    catch(std::exception &e)
+    {
+        Log(Debug::Error) << "Failed to get stream info: " << e.what();
+        return false;
+    }
+    if(sampleRate <= 0)
+        return false;
+
+    voice->mStreamBuffer.mChannels = std::min(getChannelCount(voice->mStreamChannels), 2);
+    voice->mStreamBuffer.mSampleRate = sampleRate;
+    voice->mBuffer = &voice->mStreamBuffer;
+    if(getLoudnessData)
+        voice->mLoudness.reset(new Sound_Loudness(sLoudnessFPS, sampleRate, voice->mStreamChannels, voice->mStreamType));
+    voice->mDecoder = std::move(decoder);
+    initVoice(*voice, *sound);
+
+    sound->mHandle = voice.release();
+    mActiveStreams.push_back(sound);
+    return true;
+}
+
+bool Null_Output::streamSound3D(DecoderPtr decoder, Stream *sound, bool getLoudnessData)
+{
+    return streamSound(std::move(decoder), sound, getLoudnessData);
+}
+
+void Null_Output::finishStream(Stream *sound)
+{
+    if(!sound->mHandle) return;
+    Voice *voice = static_cast<Voice*>(sound->mHandle);
+    sound->mHandle = nullptr;
+    mActiveStreams.erase(std::find(mActiveStreams.begin(), mActiveStreams.end(), sound));
+
+    voice->mDecoder->close();
+    delete voice;
+}
+
+double Null_Output::getStreamDelay(Stream *sound)
+{
+    // Nothing is queued ahead of the mixer
+    return 0.0;
+}
+
+double Null_Output::getStreamOffset(Stream *sound)
+{
+    if(!sound->mHandle) return 0.0;
+    const Voice *voice = static_cast<const Voice*>(sound->mHandle);
+    return (voice->mStreamOffset + voice->mPosition) / voice->mStreamBuffer.mSampleRate;
+}
+
+float Null_Output::getStreamLoudness(Stream *sound)
+{
+    if(!sound->mHandle) return 0.0f;
+    const Voice *voice = static_cast<const Voice*>(sound->mHandle);
+    if(!voice->mLoudness)
+        return 0.0f;
+    return voice->mLoudness->getLoudnessAtTime(static_cast<float>(getStreamOffset(sound)));
+}
+
+bool Null_Output::isStreamPlaying(Stream *sound)
+{
+    if(!sound->mHandle) return false;
+    return !static_cast<Voice*>(sound->mHandle)->mFinished;
+}
+
+void Null_Output::updateStream(Stream *sound)
+{
+    if(!sound->mHandle) return;
+    updateVoice(*static_cast<Voice*>(sound->mHandle), *sound);
+}
+
+
+void Null_Output::startUpdate()
+{
+}
+
+void Null_Output::finishUpdate()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const double elapsed = std::chrono::duration<double>(now - mLastMixTime).count();
+    mLastMixTime = now;
+    if(mDevicePaused)
+        return;
+
+    // Mix everything that would have been played since the last update, like a device running in real time.
+    // After a long stall (e.g. loading), only mix a few blocks and drop the rest, as an underrunning device would.
+    mPendingFrames += elapsed * sSampleRate;
+    size_t frames = static_cast<size_t>(mPendingFrames);
+    mPendingFrames -= frames;
+    frames = std::min(frames, sMaxUpdateFrames);
+    while(frames > 0)
+    {
+        const size_t block = std::min(frames, sBlockFrames);
+        mix(block);
+        frames -= block;
+    }
+}
+
+
+void Null_Output::updateListener(const osg::Vec3f &pos, const osg::Vec3f &atdir, const osg::Vec3f &updir, Environment env)
+{
+    mListenerPos = pos;
+    mListenerDir = atdir;
+    mListenerUp = updir;
+    mListenerEnv = env;
+}
+
+
+void Null_Output::pauseSounds(int types)
+{
+    for(Sound *sound : mActiveSounds)
+    {
+        if((types&sound->getPlayType()))
+            static_cast<Voice*>(sound->mHandle)->mPaused = true;
+    }
+    for(Stream *sound : mActiveStreams)
+    {
+        if((types&sound->getPlayType()))
+            static_cast<Voice*>(sound->mHandle)->mPaused = true;
+    }
+}
+
+void Null_Output::resumeSounds(int types)
+{
+    for(Sound *sound : mActiveSounds)
+    {
+        if((types&sound->getPlayType()))
+            static_cast<Voice*>(sound->mHandle)->mPaused = false;
+    }
+    for(Stream *sound : mActiveStreams)
+    {
+        if((types&sound->getPlayType()))
+            static_cast<Voice*>(sound->mHandle)->mPaused = false;
+    }
+}
+
+void Null_Output::pauseActiveDevice()
+{
+    mDevicePaused = true;
+}
+
+void Null_Output::resumeActiveDevice()
+{
+    mDevicePaused = false;
+}
+
+
+Null_Output::Null_Output(SoundManager &mgr, const std::string &fileName)
+  : Sound_Output(mgr)
+  , mFileName(fileName), mFramesWritten(0)
+  , mListenerPos(0.0f, 0.0f, 0.0f), mListenerDir(0.0f, 1.0f, 0.0f), mListenerUp(0.0f, 0.0f, 1.0f)
+  , mListenerEnv(Env_Normal)
+  , mDevicePaused(false), mPendingFrames(0.0)
+{
+}
+
+Null_Output::~Null_Output()
+{
+    deinit();
+}
+
+}
@@ -0,0 +1,103 @@
+#ifndef GAME_SOUND_NULL_OUTPUT_H
+#define GAME_SOUND_NULL_OUTPUT_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/fstream.hpp>
+
+#include "sound_output.hpp"
+
+namespace MWSound
+{
+    class SoundManager;
+    class SoundBase;
+    class Sound;
+    class Stream;
+
+    /// @brief Software mixer that renders into memory, and optionally into a WAV file, instead of an audio device.
+    /// @par Sounds are attenuated, panned and resampled the way the OpenAL output does without EFX, so that the
+    /// sound manager behaves the same on machines without an audio device, e.g. for automated performance testing.
+    /// Mixing happens in finishUpdate(), for the wall clock time that passed since the previous update.
+    /// @note Streams are decoded on the main thread while mixing, there is no separate streaming thread.
+    class Null_Output : public Sound_Output
+    {
+        struct Buffer;
+        struct Voice;
+
+        std::string mFileName;
+        boost::filesystem::ofstream mFile;
+        size_t mFramesWritten;
+
+        typedef std::vector<Sound*> SoundVec;
+        SoundVec mActiveSounds;
+        typedef std::vector<Stream*> StreamVec;
+        StreamVec mActiveStreams;
+
+        osg::Vec3f mListenerPos;
+        osg::Vec3f mListenerDir;
+        osg::Vec3f mListenerUp;
+        Environment mListenerEnv;
+
+        bool mDevicePaused;
+        std::chrono::steady_clock::time_point mLastMixTime;
+        double mPendingFrames;
+        std::vector<float> mMixBuffer;
+        std::vector<char> mReadBuffer;
+
+        void initVoice(Voice &voice, const SoundBase &sound);
+        void updateVoice(Voice &voice, const SoundBase &sound);
+        bool fillStream(Voice &voice, size_t frames);
+        void mixVoice(Voice &voice, size_t frames);
+        void mix(size_t frames);
+
+        void writeHeader();
+
+        Null_Output& operator=(const Null_Output &rhs);
+        Null_Output(const Null_Output &rhs);
+
+    public:
+        virtual std::vector<std::string> enumerate();
+        virtual bool init(const std::string &devname, const std::string &hrtfname, HrtfMode hrtfmode);
+        virtual void deinit();
+
+        virtual std::vector<std::string> enumerateHrtf();
+        virtual void setHrtf(const std::string &hrtfname, HrtfMode hrtfmode);
+
+        virtual std::pair<Sound_Handle,size_t> loadSound(const DecodedSound &sound);
+        virtual size_t unloadSound(Sound_Handle data);
+
+        virtual bool playSound(Sound *sound, Sound_Handle data, float offset);
+        virtual bool playSound3D(Sound *sound, Sound_Handle data, float offset);
+        virtual void finishSound(Sound *sound);
+        virtual bool isSoundPlaying(Sound *sound);
+        virtual void updateSound(Sound *sound);
+
+        virtual bool streamSound(DecoderPtr decoder, Stream *sound, bool getLoudnessData=false);
+        virtual bool streamSound3D(DecoderPtr decoder, Stream *sound, bool getLoudnessData);
+        virtual void finishStream(Stream *sound);
+        virtual double getStreamDelay(Stream *sound);
+        virtual double getStreamOffset(Stream *sound);
+        virtual float getStreamLoudness(Stream *sound);
+        virtual bool isStreamPlaying(Stream *sound);
+        virtual void updateStream(Stream *sound);
+
+        virtual void startUpdate();
+        virtual void finishUpdate();
+
+        virtual void updateListener(const osg::Vec3f &pos, const osg::Vec3f &atdir, const osg::Vec3f &updir, Environment env);
+
+        virtual void pauseSounds(int types);
+        virtual void resumeSounds(int types);
+
+        virtual void pauseActiveDevice();
+        virtual void resumeActiveDevice();
+
+        /// @param fileName WAV file to write the mixed output to, or empty to only mix into memory.
+        Null_Output(SoundManager &mgr, const std::string &fileName);
+        virtual ~Null_Output();
+    };
+}
+
+#endif
@@ -34,6 +34,7 @@ namespace MWSound
         Sound_Instance mHandle = nullptr;
 
         friend class OpenAL_Output;
+        friend class Null_Output;
 
     public:
         void setPosition(const osg::Vec3f &pos) { mParams.mPos = pos; }
@@ -30,6 +30,15 @@ namespace MWSound
     size_t framesToBytes(size_t frames, ChannelConfig config, SampleType type);
     size_t bytesToFrames(size_t bytes, ChannelConfig config, SampleType type);
 
+    /// The samples of a whole sound file
+    struct DecodedSound
+    {
+        std::vector<char> mData;
+        int mSampleRate = 0;
+        ChannelConfig mChannels = ChannelConfig_Mono;
+        SampleType mType = SampleType_Int16;
+    };
+
     struct Sound_Decoder
     {
         const VFS::Manager* mResourceMgr;
@@ -5,9 +5,11 @@
 #include <numeric>
 
 #include <osg/Matrixf>
+#include <osg/Stats>
 
 #include <components/misc/rng.hpp>
 #include <components/debug/debuglog.hpp>
+#include <components/sceneutil/workqueue.hpp>
 #include <components/vfs/manager.hpp>
 
 #include "../mwbase/environment.hpp"
@@ -25,6 +27,7 @@
 #include "sound.hpp"
 
 #include "openal_output.hpp"
+#include "null_output.hpp"
 #include "ffmpeg_decoder.hpp"
 
 
@@ -34,6 +37,13 @@ namespace MWSound
     {
         constexpr float sMinUpdateInterval = 1.0f / 30.0f;
 
+        Sound_Output* createOutput(SoundManager &manager)
+        {
+            if(Settings::Manager::getBool("null output", "Sound"))
+                return new Null_Output(manager, Settings::Manager::getString("null output file", "Sound"));
+            return new DEFAULT_OUTPUT(manager);
+        }
+
         WaterSoundUpdaterSettings makeWaterSoundUpdaterSettings()
         {
             WaterSoundUpdaterSettings settings;
@@ -47,17 +57,67 @@ namespace MWSound
 
             return settings;
         }
+
+        std::shared_ptr<const DecodedSound> decodeSound(const DecoderPtr &decoder, const std::string &fname)
+        {
+            std::shared_ptr<DecodedSound> decoded = std::make_shared<DecodedSound>();
+            try
+            {
+                // Workaround: Bethesda at some point converted some of the files to mp3, but the references were kept as .wav.
+                if(decoder->mResourceMgr->exists(fname))
+                    decoder->open(fname);
+                else
+                {
+                    std::string file = fname;
+                    std::string::size_type pos = file.rfind('.');
+                    if(pos != std::string::npos)
+                        file = file.substr(0, pos)+".mp3";
+                    decoder->open(file);
+                }
+
+                decoder->getInfo(&decoded->mSampleRate, &decoded->mChannels, &decoded->mType);
+                decoder->readAll(decoded->mData);
+            }
+            catch(std::exception &e)
+            {
+                Log(Debug::Error) << "Failed to load audio from " << fname << ": " << e.what();
+                decoded->mData.clear();
+            }
+            return decoded;
+        }
     }
 
+    /// Worker thread item: decode a whole sound file.
+    class DecodeSoundItem : public SceneUtil::WorkItem
+    {
+    public:
+        DecodeSoundItem(DecoderPtr decoder, const std::string &resname)
+            : mDecoder(std::move(decoder))
+            , mResourceName(resname)
+        {
+        }
+
+        void doWork() override
+        {
+            mResult = decodeSound(mDecoder, mResourceName);
+            mDecoder = nullptr;
+        }
+
+        DecoderPtr mDecoder;
+        std::string mResourceName;
+        std::shared_ptr<const DecodedSound> mResult;
+    };
+
     // For combining PlayMode and Type flags
     inline int operator|(PlayMode a, Type b) { return static_cast<int>(a) | static_cast<int>(b); }
 
     SoundManager::SoundManager(const VFS::Manager* vfs, bool useSound)
         : mVFS(vfs)
-        , mOutput(new DEFAULT_OUTPUT(*this))
+        , mOutput(createOutput(*this))
         , mWaterSoundUpdater(makeWaterSoundUpdaterSettings())
         , mSoundBuffers(new SoundBufferList::element_type())
         , mBufferCacheSize(0)
+        , mDecodedCacheSize(0)
         , mListenerUnderwater(false)
         , mListenerPos(0,0,0)
         , mListenerDir(1,0,0)
@@ -70,6 +130,9 @@ namespace MWSound
         mBufferCacheMax = std::max(Settings::Manager::getInt("buffer cache max", "Sound"), 1);
         mBufferCacheMax *= 1024*1024;
         mBufferCacheMin = std::min(mBufferCacheMin*1024*1024, mBufferCacheMax);
+        mDecodedCacheMax = std::max(Settings::Manager::getInt("decoded cache size", "Sound"), 0);
+        mDecodedCacheMax *= 1024*1024;
+        mBackgroundDecoding = Settings::Manager::getBool("background decoding", "Sound");
 
         if(!useSound)
         {
@@ -89,6 +152,8 @@ namespace MWSound
             return;
         }
 
+        mDecodeQueue = new SceneUtil::WorkQueue(1);
+
         std::vector<std::string> names = mOutput->enumerate();
         std::stringstream stream;
 
@@ -113,6 +178,8 @@ namespace MWSound
     SoundManager::~SoundManager()
     {
         clear();
+        mDecodeQueue = nullptr;
+        mPendingLoads.clear();
         for(Sound_Buffer &sfx : *mSoundBuffers)
         {
             if(sfx.mHandle)
@@ -170,14 +237,15 @@ namespace MWSound
         if(snd != mBufferNameMap.end())
         {
             Sound_Buffer *sfx = snd->second;
-            if(sfx->mHandle) return sfx;
+            // Sounds can also be waiting for their buffer to be decoded
+            if(sfx->mHandle || sfx->mUses > 0) return sfx;
         }
         return nullptr;
     }
 
     // Lookup a soundId for its sound data (resource name, local volume,
-    // minRange, and maxRange), and ensure it's ready for use.
-    Sound_Buffer *SoundManager::loadSound(const std::string &soundId)
+    // minRange, and maxRange), without loading it.
+    Sound_Buffer *SoundManager::getSoundBuffer(const std::string &soundId)
     {
 #ifdef __GNUC__
 #define LIKELY(x) __builtin_expect((bool)(x), true)
@@ -207,34 +275,179 @@ namespace MWSound
 #undef LIKELY
 #undef UNLIKELY
 
+        return sfx;
+    }
+
+    // Lookup a soundId for its sound data (resource name, local volume,
+    // minRange, and maxRange), and ensure it's ready for use. With
+    // background set, the buffer may still be decoding, see startSound().
+    Sound_Buffer *SoundManager::loadSound(const std::string &soundId, bool background)
+    {
+        Sound_Buffer *sfx = getSoundBuffer(soundId);
+        if(!sfx) return nullptr;
+
+        // Sounds queued by an earlier call may be ready, even if update() was not called in between (e.g. on loading screens)
+        updatePendingLoads();
+
         if(!sfx->mHandle)
         {
-            size_t size;
-            std::tie(sfx->mHandle, size) = mOutput->loadSound(sfx->mResourceName);
-            if(!sfx->mHandle) return nullptr;
-
-            mBufferCacheSize += size;
-            if(mBufferCacheSize > mBufferCacheMax)
+            PendingLoadMap::iterator pending = mPendingLoads.find(sfx);
+            if(pending != mPendingLoads.end())
             {
-                do {
-                    if(mUnusedBuffers.empty())
-                    {
-                        Log(Debug::Warning) << "No unused sound buffers to free, using " << mBufferCacheSize << " bytes!";
-                        break;
-                    }
-                    Sound_Buffer *unused = mUnusedBuffers.back();
+                if(!background)
+                    finishLoad(pending, true);
+            }
+            else
+            {
+                std::shared_ptr<const DecodedSound> decoded = findDecoded(sfx->mResourceName);
+                if(decoded)
+                    uploadSound(sfx, *decoded);
+                else if(background && mDecodeQueue)
+                    requestDecode(sfx);
+                else
+                {
+                    decoded = decodeSound(getDecoder(), sfx->mResourceName);
+                    addDecoded(sfx->mResourceName, decoded);
+                    uploadSound(sfx, *decoded);
+                }
+            }
+            if(!sfx->mHandle && mPendingLoads.find(sfx) == mPendingLoads.end())
+                return nullptr;
+        }
 
-                    size = mOutput->unloadSound(unused->mHandle);
-                    mBufferCacheSize -= size;
-                    unused->mHandle = 0;
+        return sfx;
+    }
 
-                    mUnusedBuffers.pop_back();
-                } while(mBufferCacheSize > mBufferCacheMin);
-            }
+    void SoundManager::requestDecode(Sound_Buffer *sfx)
+    {
+        osg::ref_ptr<DecodeSoundItem> item (new DecodeSoundItem(getDecoder(), sfx->mResourceName));
+        mDecodeQueue->addWorkItem(item);
+        mPendingLoads.emplace(sfx, item);
+    }
+
+    void SoundManager::uploadSound(Sound_Buffer *sfx, const DecodedSound &decoded)
+    {
+        size_t size;
+        std::tie(sfx->mHandle, size) = mOutput->loadSound(decoded);
+        if(!sfx->mHandle) return;
+
+        mBufferCacheSize += size;
+        if(mBufferCacheSize > mBufferCacheMax)
+        {
+            do {
+                if(mUnusedBuffers.empty())
+                {
+                    Log(Debug::Warning) << "No unused sound buffers to free, using " << mBufferCacheSize << " bytes!";
+                    break;
+                }
+                Sound_Buffer *unused = mUnusedBuffers.back();
+
+                size = mOutput->unloadSound(unused->mHandle);
+                mBufferCacheSize -= size;
+                unused->mHandle = 0;
+
+                mUnusedBuffers.pop_back();
+            } while(mBufferCacheSize > mBufferCacheMin);
+        }
+        if(sfx->mUses == 0)
             mUnusedBuffers.push_front(sfx);
+    }
+
+    SoundManager::PendingLoadMap::iterator SoundManager::finishLoad(PendingLoadMap::iterator pending, bool upload)
+    {
+        pending->second->waitTillDone();
+
+        Sound_Buffer *sfx = pending->first;
+        std::shared_ptr<const DecodedSound> decoded = pending->second->mResult;
+        PendingLoadMap::iterator next = mPendingLoads.erase(pending);
+
+        addDecoded(sfx->mResourceName, decoded);
+        // Preloaded sounds stay in the decoded cache until they are played
+        if((upload || sfx->mUses > 0) && !sfx->mHandle)
+            uploadSound(sfx, *decoded);
+        return next;
+    }
+
+    void SoundManager::updatePendingLoads()
+    {
+        for(auto iter = mPendingLoads.begin(); iter != mPendingLoads.end();)
+        {
+            if(iter->second->isDone())
+                iter = finishLoad(iter, false);
+            else
+                ++iter;
         }
 
-        return sfx;
+        for(auto iter = mPendingSounds.begin(); iter != mPendingSounds.end();)
+        {
+            if(mPendingLoads.find(iter->mBuffer) != mPendingLoads.end())
+            {
+                ++iter;
+                continue;
+            }
+
+            PendingSound pending = *iter;
+            iter = mPendingSounds.erase(iter);
+
+            // If the buffer failed to load, the sound is not playing and gets removed in updateSounds()
+            if(pending.mBuffer->mHandle)
+                startSound(pending.mSound, pending.mBuffer, pending.mOffset);
+        }
+    }
+
+    std::shared_ptr<const DecodedSound> SoundManager::findDecoded(const std::string &resname)
+    {
+        auto found = mDecodedSoundMap.find(resname);
+        if(found == mDecodedSoundMap.end())
+            return nullptr;
+        mDecodedSounds.splice(mDecodedSounds.begin(), mDecodedSounds, found->second);
+        return found->second->second;
+    }
+
+    void SoundManager::addDecoded(const std::string &resname, const std::shared_ptr<const DecodedSound> &decoded)
+    {
+        if(decoded->mData.size() > mDecodedCacheMax || mDecodedSoundMap.find(resname) != mDecodedSoundMap.end())
+            return;
+
+        mDecodedSounds.emplace_front(resname, decoded);
+        mDecodedSoundMap[resname] = mDecodedSounds.begin();
+        mDecodedCacheSize += decoded->mData.size();
+
+        while(mDecodedCacheSize > mDecodedCacheMax)
+        {
+            mDecodedCacheSize -= mDecodedSounds.back().second->mData.size();
+            mDecodedSoundMap.erase(mDecodedSounds.back().first);
+            mDecodedSounds.pop_back();
+        }
+    }
+
+    bool SoundManager::startSound(Sound *sound, Sound_Buffer *sfx, float offset)
+    {
+        if(!sfx->mHandle)
+        {
+            if(mPendingLoads.find(sfx) == mPendingLoads.end())
+                return false;
+            mPendingSounds.push_back({sound, sfx, offset});
+            return true;
+        }
+        if(sound->getIs3D())
+            return mOutput->playSound3D(sound, sfx->mHandle, offset);
+        return mOutput->playSound(sound, sfx->mHandle, offset);
+    }
+
+    void SoundManager::finishSound(Sound *sound)
+    {
+        mOutput->finishSound(sound);
+        mPendingSounds.erase(std::remove_if(mPendingSounds.begin(), mPendingSounds.end(),
+            [sound] (const PendingSound& pending) { return pending.mSound == sound; }), mPendingSounds.end());
+    }
+
+    bool SoundManager::isSoundPlaying(Sound *sound) const
+    {
+        if(mOutput->isSoundPlaying(sound))
+            return true;
+        return std::find_if(mPendingSounds.begin(), mPendingSounds.end(),
+            [sound] (const PendingSound& pending) { return pending.mSound == sound; }) != mPendingSounds.end();
     }
 
     DecoderPtr SoundManager::loadVoice(const std::string &voicefile)
@@ -612,7 +825,8 @@ namespace MWSound
         if(!mOutput->isInitialized())
             return nullptr;
 
-        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId));
+        // Interface sounds are expected to play right away, and tend to be short
+        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId), false);
         if(!sfx) return nullptr;
 
         // Only one copy of given sound can be played at time, so stop previous copy
@@ -627,7 +841,7 @@ namespace MWSound
             params.mFlags = mode | type | Play_2D;
             return params;
         } ());
-        if(!mOutput->playSound(sound.get(), sfx->mHandle, offset))
+        if(!startSound(sound.get(), sfx, offset))
             return nullptr;
 
         if(sfx->mUses++ == 0)
@@ -652,8 +866,11 @@ namespace MWSound
         if ((mode & PlayMode::RemoveAtDistance) && (mListenerPos - objpos).length2() > 2000 * 2000)
             return nullptr;
 
+        // Sounds of the player are played without delay, like interface sounds
+        const bool playerLocal = !(mode&PlayMode::NoPlayerLocal) && ptr == MWMechanics::getPlayer();
+
         // Look up the sound in the ESM data
-        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId));
+        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId), mBackgroundDecoding && !playerLocal);
         if(!sfx) return nullptr;
 
         // Only one copy of given sound can be played at time on ptr, so stop previous copy
@@ -661,7 +878,7 @@ namespace MWSound
 
         bool played;
         SoundPtr sound = getSoundRef();
-        if(!(mode&PlayMode::NoPlayerLocal) && ptr == MWMechanics::getPlayer())
+        if(playerLocal)
         {
             sound->init([&] {
                 SoundParams params;
@@ -671,7 +888,7 @@ namespace MWSound
                 params.mFlags = mode | type | Play_2D;
                 return params;
             } ());
-            played = mOutput->playSound(sound.get(), sfx->mHandle, offset);
+            played = startSound(sound.get(), sfx, offset);
         }
         else
         {
@@ -686,7 +903,7 @@ namespace MWSound
                 params.mFlags = mode | type | Play_3D;
                 return params;
             } ());
-            played = mOutput->playSound3D(sound.get(), sfx->mHandle, offset);
+            played = startSound(sound.get(), sfx, offset);
         }
         if(!played)
             return nullptr;
@@ -710,7 +927,7 @@ namespace MWSound
             return nullptr;
 
         // Look up the sound in the ESM data
-        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId));
+        Sound_Buffer *sfx = loadSound(Misc::StringUtils::lowerCase(soundId), mBackgroundDecoding);
         if(!sfx) return nullptr;
 
         SoundPtr sound = getSoundRef();
@@ -725,7 +942,7 @@ namespace MWSound
             params.mFlags = mode | type | Play_3D;
             return params;
         } ());
-        if(!mOutput->playSound3D(sound.get(), sfx->mHandle, offset))
+        if(!startSound(sound.get(), sfx, offset))
             return nullptr;
 
         if(sfx->mUses++ == 0)
@@ -742,7 +959,7 @@ namespace MWSound
     void SoundManager::stopSound(Sound *sound)
     {
         if(sound)
-            mOutput->finishSound(sound);
+            finishSound(sound);
     }
 
     void SoundManager::stopSound(Sound_Buffer *sfx, const MWWorld::ConstPtr &ptr)
@@ -753,7 +970,7 @@ namespace MWSound
             for(SoundBufferRefPair &snd : snditer->second)
             {
                 if(snd.second == sfx)
-                    mOutput->finishSound(snd.first.get());
+                    finishSound(snd.first.get());
             }
         }
     }
@@ -775,7 +992,7 @@ namespace MWSound
         if(snditer != mActiveSounds.end())
         {
             for(SoundBufferRefPair &snd : snditer->second)
-                mOutput->finishSound(snd.first.get());
+                finishSound(snd.first.get());
         }
         SaySoundMap::iterator sayiter = mSaySoundsQueue.find(ptr);
         if(sayiter != mSaySoundsQueue.end())
@@ -792,7 +1009,7 @@ namespace MWSound
             if(!snd.first.isEmpty() && snd.first != MWMechanics::getPlayer() && snd.first.getCell() == cell)
             {
                 for(SoundBufferRefPair &sndbuf : snd.second)
-                    mOutput->finishSound(sndbuf.first.get());
+                    finishSound(sndbuf.first.get());
             }
         }
 
@@ -834,7 +1051,7 @@ namespace MWSound
             Sound_Buffer *sfx = lookupSound(Misc::StringUtils::lowerCase(soundId));
             return std::find_if(snditer->second.cbegin(), snditer->second.cend(),
                 [this,sfx](const SoundBufferRefPair &snd) -> bool
-                { return snd.second == sfx && mOutput->isSoundPlaying(snd.first.get()); }
+                { return snd.second == sfx && isSoundPlaying(snd.first.get()); }
             ) != snditer->second.cend();
         }
         return false;
@@ -919,12 +1136,12 @@ namespace MWSound
                 mNearWaterSound->setVolume(update.mVolume * sfx->mVolume);
                 break;
             case WaterSoundAction::FinishSound:
-                mOutput->finishSound(mNearWaterSound);
+                finishSound(mNearWaterSound);
                 mNearWaterSound = nullptr;
                 break;
             case WaterSoundAction::PlaySound:
                 if (mNearWaterSound)
-                    mOutput->finishSound(mNearWaterSound);
+                    finishSound(mNearWaterSound);
                 mNearWaterSound = playSound(update.mId, update.mVolume, 1.0f, Type::Sfx, PlayMode::Loop);
                 break;
         }
@@ -1000,7 +1217,7 @@ namespace MWSound
             env = Env_Underwater;
         else if(mUnderwaterSound)
         {
-            mOutput->finishSound(mUnderwaterSound);
+            finishSound(mUnderwaterSound);
             mUnderwaterSound = nullptr;
         }
 
@@ -1034,18 +1251,18 @@ namespace MWSound
                     if(sound->getDistanceCull())
                     {
                         if((mListenerPos - objpos).length2() > 2000*2000)
-                            mOutput->finishSound(sound);
+                            finishSound(sound);
                     }
                 }
 
-                if(!mOutput->isSoundPlaying(sound))
+                if(!isSoundPlaying(sound))
                 {
-                    mOutput->finishSound(sound);
+                    finishSound(sound);
                     if (sound == mUnderwaterSound)
                         mUnderwaterSound = nullptr;
                     if (sound == mNearWaterSound)
                         mNearWaterSound = nullptr;
-                    if(sfx->mUses-- == 1)
+                    if(sfx->mUses-- == 1 && sfx->mHandle)
                         mUnusedBuffers.push_front(sfx);
                     sndidx = snditer->second.erase(sndidx);
                 }
@@ -1145,6 +1362,7 @@ namespace MWSound
         if(!mOutput->isInitialized() || mPlaybackPaused)
             return;
 
+        updatePendingLoads();
         updateSounds(duration);
         if (MWBase::Environment::get().getStateManager()->getState()!=
             MWBase::StateManager::State_NoGame)
@@ -1234,69 +1452,27 @@ namespace MWSound
         }
     }
 
-    // Default readAll implementation, for decoders that can't do anything
-    // better
-    void Sound_Decoder::readAll(std::vector<char> &output)
-    {
-        size_t total = output.size();
-        size_t got;
-
-        output.resize(total+32768);
-        while((got=read(&output[total], output.size()-total)) > 0)
-        {
-            total += got;
-            output.resize(total*2);
-        }
-        output.resize(total);
-    }
-
-
-    const char *getSampleTypeName(SampleType type)
-    {
-        switch(type)
-        {
-            case SampleType_UInt8: return "U8";
-            case SampleType_Int16: return "S16";
-            case SampleType_Float32: return "Float32";
-        }
-        return "(unknown sample type)";
-    }
-
-    const char *getChannelConfigName(ChannelConfig config)
+    void SoundManager::preloadSounds(const std::vector<std::string> &soundIds)
     {
-        switch(config)
-        {
-            case ChannelConfig_Mono:    return "Mono";
-            case ChannelConfig_Stereo:  return "Stereo";
-            case ChannelConfig_Quad:    return "Quad";
-            case ChannelConfig_5point1: return "5.1 Surround";
-            case ChannelConfig_7point1: return "7.1 Surround";
-        }
-        return "(unknown channel config)";
-    }
+        if(!mOutput->isInitialized() || !mDecodeQueue)
+            return;
 
-    size_t framesToBytes(size_t frames, ChannelConfig config, SampleType type)
-    {
-        switch(config)
-        {
-            case ChannelConfig_Mono:    frames *= 1; break;
-            case ChannelConfig_Stereo:  frames *= 2; break;
-            case ChannelConfig_Quad:    frames *= 4; break;
-            case ChannelConfig_5point1: frames *= 6; break;
-            case ChannelConfig_7point1: frames *= 8; break;
-        }
-        switch(type)
+        for(const std::string &soundId : soundIds)
         {
-            case SampleType_UInt8: frames *= 1; break;
-            case SampleType_Int16: frames *= 2; break;
-            case SampleType_Float32: frames *= 4; break;
+            Sound_Buffer *sfx = getSoundBuffer(Misc::StringUtils::lowerCase(soundId));
+            if(!sfx || sfx->mHandle || mPendingLoads.find(sfx) != mPendingLoads.end())
+                continue;
+            if(mDecodedSoundMap.find(sfx->mResourceName) != mDecodedSoundMap.end())
+                continue;
+            requestDecode(sfx);
         }
-        return frames;
     }
 
-    size_t bytesToFrames(size_t bytes, ChannelConfig config, SampleType type)
+    void SoundManager::reportStats(unsigned int frameNumber, osg::Stats &stats) const
     {
-        return bytes / framesToBytes(1, config, type);
+        stats.setAttribute(frameNumber, "Sound Buffer MB", mBufferCacheSize / (1024 * 1024));
+        stats.setAttribute(frameNumber, "Sound Decoded MB", mDecodedCacheSize / (1024 * 1024));
+        stats.setAttribute(frameNumber, "Sound Decoding", mPendingLoads.size());
     }
 
     void SoundManager::clear()
@@ -1307,13 +1483,14 @@ namespace MWSound
         {
             for(SoundBufferRefPair &sndbuf : snd.second)
             {
-                mOutput->finishSound(sndbuf.first.get());
+                finishSound(sndbuf.first.get());
                 Sound_Buffer *sfx = sndbuf.second;
-                if(sfx->mUses-- == 1)
+                if(sfx->mUses-- == 1 && sfx->mHandle)
                     mUnusedBuffers.push_front(sfx);
             }
         }
         mActiveSounds.clear();
+        mPendingSounds.clear();
         mUnderwaterSound = nullptr;
         mNearWaterSound = nullptr;
 
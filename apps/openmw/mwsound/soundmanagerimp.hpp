@@ -5,9 +5,12 @@
 #include <string>
 #include <utility>
 #include <deque>
+#include <list>
 #include <map>
 #include <unordered_map>
 
+#include <osg/ref_ptr>
+
 #include <components/settings/settings.hpp>
 #include <components/misc/objectpool.hpp>
 #include <components/fallback/fallback.hpp>
@@ -24,6 +27,11 @@ namespace VFS
     class Manager;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace ESM
 {
     struct Sound;
@@ -37,6 +45,8 @@ namespace MWSound
     class Sound;
     class Stream;
     class Sound_Buffer;
+    struct DecodedSound;
+    class DecodeSoundItem;
 
     enum Environment {
         Env_Normal,
@@ -82,6 +92,30 @@ namespace MWSound
         typedef std::deque<Sound_Buffer*> SoundList;
         SoundList mUnusedBuffers;
 
+        // Sound files are decoded in the background, so that playing a sound for the first time doesn't stall the frame.
+        // Preloaded sounds always are, other sounds only with the 'background decoding' setting.
+        osg::ref_ptr<SceneUtil::WorkQueue> mDecodeQueue;
+        typedef std::unordered_map<Sound_Buffer*, osg::ref_ptr<DecodeSoundItem>> PendingLoadMap;
+        PendingLoadMap mPendingLoads;
+        bool mBackgroundDecoding;
+
+        // Sounds that were played before their buffer was decoded, they are started once it is ready.
+        struct PendingSound
+        {
+            Sound *mSound;
+            Sound_Buffer *mBuffer;
+            float mOffset;
+        };
+        std::vector<PendingSound> mPendingSounds;
+
+        // Recently decoded samples by resource name, so that unloaded buffers can be recreated without decoding again.
+        // NOTE: stored in front-newest order.
+        typedef std::list<std::pair<std::string, std::shared_ptr<const DecodedSound>>> DecodedList;
+        DecodedList mDecodedSounds;
+        std::unordered_map<std::string, DecodedList::iterator> mDecodedSoundMap;
+        size_t mDecodedCacheMax;
+        size_t mDecodedCacheSize;
+
         Misc::ObjectPool<Sound> mSounds;
 
         Misc::ObjectPool<Stream> mStreams;
@@ -123,7 +157,22 @@ namespace MWSound
         Sound_Buffer *insertSound(const std::string &soundId, const ESM::Sound *sound);
 
         Sound_Buffer *lookupSound(const std::string &soundId) const;
-        Sound_Buffer *loadSound(const std::string &soundId);
+        Sound_Buffer *getSoundBuffer(const std::string &soundId);
+        Sound_Buffer *loadSound(const std::string &soundId, bool background);
+
+        void requestDecode(Sound_Buffer *sfx);
+        void uploadSound(Sound_Buffer *sfx, const DecodedSound &decoded);
+        // Waits for the decode to finish, uploads the buffer if it is in use or upload is set
+        PendingLoadMap::iterator finishLoad(PendingLoadMap::iterator pending, bool upload);
+        void updatePendingLoads();
+
+        std::shared_ptr<const DecodedSound> findDecoded(const std::string &resname);
+        void addDecoded(const std::string &resname, const std::shared_ptr<const DecodedSound> &decoded);
+
+        // Plays the sound, or queues it if its buffer is still being decoded
+        bool startSound(Sound *sound, Sound_Buffer *sfx, float offset);
+        void finishSound(Sound *sound);
+        bool isSoundPlaying(Sound *sound) const;
 
         // returns a decoder to start streaming, or nullptr if the sound was not found
         DecoderPtr loadVoice(const std::string &voicefile);
@@ -258,6 +307,9 @@ namespace MWSound
         virtual bool getSoundPlaying(const MWWorld::ConstPtr &reference, const std::string& soundId) const;
         ///< Is the given sound currently playing on the given object?
 
+        virtual void preloadSounds(const std::vector<std::string>& soundIds);
+        ///< Decode the given sounds in the background, so that they can be played without delay later on.
+
         virtual void pauseSounds(MWSound::BlockerType blocker, int types=int(Type::Mask));
         ///< Pauses all currently playing sounds, including music.
 
@@ -274,6 +326,8 @@ namespace MWSound
         virtual void updatePtr (const MWWorld::ConstPtr& old, const MWWorld::ConstPtr& updated);
 
         virtual void clear();
+
+        virtual void reportStats(unsigned int frameNumber, osg::Stats& stats) const;
     };
 }
 
@@ -17,6 +17,7 @@
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
+#include "../mwbase/soundmanager.hpp"
 
 #include "../mwrender/landmanager.hpp"
 
@@ -29,14 +30,16 @@ namespace MWWorld
 
     struct ListModelsVisitor
     {
-        ListModelsVisitor(std::vector<std::string>& out)
+        ListModelsVisitor(std::vector<std::string>& out, std::vector<std::string>& sounds)
             : mOut(out)
+            , mSounds(sounds)
         {
         }
 
         virtual bool operator()(const MWWorld::Ptr& ptr)
         {
             ptr.getClass().getModelsToPreload(ptr, mOut);
+            ptr.getClass().getSoundsToPreload(ptr, mSounds);
 
             return true;
         }
@@ -44,6 +47,7 @@ namespace MWWorld
         virtual ~ListModelsVisitor() = default;
 
         std::vector<std::string>& mOut;
+        std::vector<std::string>& mSounds;
     };
 
     /// Worker thread item: preload models in a cell.
@@ -65,10 +69,16 @@ namespace MWWorld
         {
             mTerrainView = mTerrain->createView();
 
-            ListModelsVisitor visitor (mMeshes);
+            ListModelsVisitor visitor (mMeshes, mSounds);
             cell->forEach(visitor);
         }
 
+        /// Sounds that objects in the cell are likely to play, to be decoded by the sound manager.
+        const std::vector<std::string>& getSounds() const
+        {
+            return mSounds;
+        }
+
         virtual void abort()
         {
             mAbort = true;
@@ -89,6 +99,21 @@ namespace MWWorld
                 }
             }
 
+            std::vector<std::string> unloadedMeshes;
+            for (std::string& mesh: mMeshes)
+            {
+                if (mAbort)
+                    break;
+
+                mesh = Misc::ResourceHelpers::correctActorModelPath(mesh, mSceneManager->getVFS());
+                if (!mSceneManager->isLoaded(mesh))
+                    unloadedMeshes.push_back(mesh);
+            }
+
+            // Decompress the meshes that still have to be parsed in one batch, in the order they are stored in the archives
+            if (!mAbort && !unloadedMeshes.empty())
+                mSceneManager->getVFS()->prefetch(unloadedMeshes);
+
             for (std::string& mesh: mMeshes)
             {
                 if (mAbort)
@@ -96,8 +121,6 @@ namespace MWWorld
 
                 try
                 {
-                    mesh = Misc::ResourceHelpers::correctActorModelPath(mesh, mSceneManager->getVFS());
-
                     bool animated = false;
                     size_t slashpos = mesh.find_last_of("/\\");
                     if (slashpos != std::string::npos && slashpos != mesh.size()-1)
@@ -141,6 +164,7 @@ namespace MWWorld
         int mX;
         int mY;
         MeshList mMeshes;
+        std::vector<std::string> mSounds;
         Resource::SceneManager* mSceneManager;
         Resource::BulletShapeManager* mBulletShapeManager;
         Resource::KeyframeManager* mKeyframeManager;
@@ -309,6 +333,8 @@ namespace MWWorld
         osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain, mLandManager, mPreloadInstances));
         mWorkQueue->addWorkItem(item);
 
+        MWBase::Environment::get().getSoundManager()->preloadSounds(item->getSounds());
+
         mPreloadCells[cell] = PreloadEntry(timestamp, item);
     }
 
@@ -1,78 +1,208 @@
 #include "cellref.hpp"
 
+#include <cmath>
+#include <mutex>
+#include <unordered_set>
+
 #include <components/esm/objectstate.hpp>
 
+namespace
+{
+    const std::string* internRefId(const std::string& id)
+    {
+        // Never released, there are only as many distinct IDs as there are records
+        static std::mutex mutex;
+        static std::unordered_set<std::string> ids;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return &*ids.insert(id).first;
+    }
+
+    ESM::Position blankPosition()
+    {
+        ESM::Position position;
+        for (int i=0; i<3; ++i)
+        {
+            position.pos[i] = 0;
+            position.rot[i] = 0;
+        }
+        return position;
+    }
+}
+
 namespace MWWorld
 {
 
+    struct CellRef::Extra
+    {
+        std::string mOwner;
+        std::string mGlobalVariable;
+        std::string mSoul;
+        std::string mFaction;
+        std::string mKey;
+        std::string mTrap;
+        std::string mDestCell;
+        ESM::Position mDoorDest;
+    };
+
+    CellRef::CellRef(const ESM::CellRef& ref)
+        : mRefNum(ref.mRefNum)
+        , mRefId(internRefId(ref.mRefID))
+        , mPos(ref.mPos)
+        , mScale(ref.mScale)
+        , mChargeIntRemainder(ref.mChargeIntRemainder)
+        , mEnchantmentCharge(ref.mEnchantmentCharge)
+        , mFactionRank(ref.mFactionRank)
+        , mGoldValue(ref.mGoldValue)
+        , mLockLevel(ref.mLockLevel)
+        , mReferenceBlocked(ref.mReferenceBlocked)
+        , mTeleport(ref.mTeleport)
+        , mChanged(false)
+    {
+        mChargeInt = ref.mChargeInt;
+
+        if (ref.mTeleport || !ref.mOwner.empty() || !ref.mGlobalVariable.empty() || !ref.mSoul.empty()
+                || !ref.mFaction.empty() || !ref.mKey.empty() || !ref.mTrap.empty() || !ref.mDestCell.empty())
+        {
+            Extra& extra = getExtra();
+            extra.mOwner = ref.mOwner;
+            extra.mGlobalVariable = ref.mGlobalVariable;
+            extra.mSoul = ref.mSoul;
+            extra.mFaction = ref.mFaction;
+            extra.mKey = ref.mKey;
+            extra.mTrap = ref.mTrap;
+            extra.mDestCell = ref.mDestCell;
+            if (ref.mTeleport)
+                extra.mDoorDest = ref.mDoorDest;
+        }
+    }
+
+    CellRef::CellRef(const CellRef& other)
+        : mRefNum(other.mRefNum)
+        , mRefId(other.mRefId)
+        , mExtra(other.mExtra ? std::make_unique<Extra>(*other.mExtra) : nullptr)
+        , mPos(other.mPos)
+        , mScale(other.mScale)
+        , mChargeIntRemainder(other.mChargeIntRemainder)
+        , mEnchantmentCharge(other.mEnchantmentCharge)
+        , mFactionRank(other.mFactionRank)
+        , mGoldValue(other.mGoldValue)
+        , mLockLevel(other.mLockLevel)
+        , mReferenceBlocked(other.mReferenceBlocked)
+        , mTeleport(other.mTeleport)
+        , mChanged(other.mChanged)
+    {
+        mChargeInt = other.mChargeInt;
+    }
+
+    CellRef& CellRef::operator=(const CellRef& other)
+    {
+        if (this != &other)
+        {
+            mRefNum = other.mRefNum;
+            mRefId = other.mRefId;
+            mExtra = other.mExtra ? std::make_unique<Extra>(*other.mExtra) : nullptr;
+            mPos = other.mPos;
+            mScale = other.mScale;
+            mChargeInt = other.mChargeInt;
+            mChargeIntRemainder = other.mChargeIntRemainder;
+            mEnchantmentCharge = other.mEnchantmentCharge;
+            mFactionRank = other.mFactionRank;
+            mGoldValue = other.mGoldValue;
+            mLockLevel = other.mLockLevel;
+            mReferenceBlocked = other.mReferenceBlocked;
+            mTeleport = other.mTeleport;
+            mChanged = other.mChanged;
+        }
+        return *this;
+    }
+
+    CellRef::CellRef(CellRef&& other) noexcept = default;
+
+    CellRef& CellRef::operator=(CellRef&& other) noexcept = default;
+
+    CellRef::~CellRef()
+    {
+    }
+
+    CellRef::Extra& CellRef::getExtra()
+    {
+        if (!mExtra)
+        {
+            mExtra = std::make_unique<Extra>();
+            mExtra->mDoorDest = blankPosition();
+        }
+        return *mExtra;
+    }
+
     const ESM::RefNum& CellRef::getRefNum() const
     {
-        return mCellRef.mRefNum;
+        return mRefNum;
     }
 
     bool CellRef::hasContentFile() const
     {
-        return mCellRef.mRefNum.hasContentFile();
+        return mRefNum.hasContentFile();
     }
 
     void CellRef::unsetRefNum()
     {
-        mCellRef.mRefNum.unset();
+        mRefNum.unset();
     }
 
     std::string CellRef::getRefId() const
     {
-        return mCellRef.mRefID;
+        return *mRefId;
     }
 
     const std::string* CellRef::getRefIdPtr() const
     {
-        return &mCellRef.mRefID;
+        return mRefId;
     }
 
     bool CellRef::getTeleport() const
     {
-        return mCellRef.mTeleport;
+        return mTeleport;
     }
 
     ESM::Position CellRef::getDoorDest() const
     {
-        return mCellRef.mDoorDest;
+        return mExtra ? mExtra->mDoorDest : blankPosition();
     }
 
     std::string CellRef::getDestCell() const
     {
-        return mCellRef.mDestCell;
+        return mExtra ? mExtra->mDestCell : std::string();
     }
 
     float CellRef::getScale() const
     {
-        return mCellRef.mScale;
+        return mScale;
     }
 
     void CellRef::setScale(float scale)
     {
-        if (scale != mCellRef.mScale)
+        if (scale != mScale)
         {
             mChanged = true;
-            mCellRef.mScale = scale;
+            mScale = scale;
         }
     }
 
     ESM::Position CellRef::getPosition() const
     {
-        return mCellRef.mPos;
+        return mPos;
     }
 
     void CellRef::setPosition(const ESM::Position &position)
     {
         mChanged = true;
-        mCellRef.mPos = position;
+        mPos = position;
     }
 
     float CellRef::getEnchantmentCharge() const
     {
-        return mCellRef.mEnchantmentCharge;
+        return mEnchantmentCharge;
     }
 
     float CellRef::getNormalizedEnchantmentCharge(int maxCharge) const
@@ -81,152 +211,152 @@ namespace MWWorld
         {
             return 0;
         }
-        else if (mCellRef.mEnchantmentCharge == -1)
+        else if (mEnchantmentCharge == -1)
         {
             return 1;
         }
         else
         {
-            return mCellRef.mEnchantmentCharge / static_cast<float>(maxCharge);
+            return mEnchantmentCharge / static_cast<float>(maxCharge);
         }
     }
 
     void CellRef::setEnchantmentCharge(float charge)
     {
-        if (charge != mCellRef.mEnchantmentCharge)
+        if (charge != mEnchantmentCharge)
         {
             mChanged = true;
-            mCellRef.mEnchantmentCharge = charge;
+            mEnchantmentCharge = charge;
         }
     }
 
     int CellRef::getCharge() const
     {
-        return mCellRef.mChargeInt;
+        return mChargeInt;
     }
 
     void CellRef::setCharge(int charge)
     {
-        if (charge != mCellRef.mChargeInt)
+        if (charge != mChargeInt)
         {
             mChanged = true;
-            mCellRef.mChargeInt = charge;
+            mChargeInt = charge;
         }
     }
 
     void CellRef::applyChargeRemainderToBeSubtracted(float chargeRemainder)
     {
-        mCellRef.mChargeIntRemainder += std::abs(chargeRemainder);
-        if (mCellRef.mChargeIntRemainder > 1.0f)
+        mChargeIntRemainder += std::abs(chargeRemainder);
+        if (mChargeIntRemainder > 1.0f)
         {
-            float newChargeRemainder = (mCellRef.mChargeIntRemainder - std::floor(mCellRef.mChargeIntRemainder));
-            if (mCellRef.mChargeInt <= static_cast<int>(mCellRef.mChargeIntRemainder))
+            float newChargeRemainder = (mChargeIntRemainder - std::floor(mChargeIntRemainder));
+            if (mChargeInt <= static_cast<int>(mChargeIntRemainder))
             {
-                mCellRef.mChargeInt = 0;
+                mChargeInt = 0;
             }
             else
             {
-                mCellRef.mChargeInt -= static_cast<int>(mCellRef.mChargeIntRemainder);
+                mChargeInt -= static_cast<int>(mChargeIntRemainder);
             }
-            mCellRef.mChargeIntRemainder = newChargeRemainder;
+            mChargeIntRemainder = newChargeRemainder;
         }
     }
 
     float CellRef::getChargeFloat() const
     {
-        return mCellRef.mChargeFloat;
+        return mChargeFloat;
     }
 
     void CellRef::setChargeFloat(float charge)
     {
-        if (charge != mCellRef.mChargeFloat)
+        if (charge != mChargeFloat)
         {
             mChanged = true;
-            mCellRef.mChargeFloat = charge;
+            mChargeFloat = charge;
         }
     }
 
     std::string CellRef::getOwner() const
     {
-        return mCellRef.mOwner;
+        return mExtra ? mExtra->mOwner : std::string();
     }
 
     std::string CellRef::getGlobalVariable() const
     {
-        return mCellRef.mGlobalVariable;
+        return mExtra ? mExtra->mGlobalVariable : std::string();
     }
 
     void CellRef::resetGlobalVariable()
     {
-        if (!mCellRef.mGlobalVariable.empty())
+        if (mExtra && !mExtra->mGlobalVariable.empty())
         {
             mChanged = true;
-            mCellRef.mGlobalVariable.erase();
+            mExtra->mGlobalVariable.erase();
         }
     }
 
     void CellRef::setFactionRank(int factionRank)
     {
-        if (factionRank != mCellRef.mFactionRank)
+        if (factionRank != mFactionRank)
         {
             mChanged = true;
-            mCellRef.mFactionRank = factionRank;
+            mFactionRank = factionRank;
         }
     }
 
     int CellRef::getFactionRank() const
     {
-        return mCellRef.mFactionRank;
+        return mFactionRank;
     }
 
     void CellRef::setOwner(const std::string &owner)
     {
-        if (owner != mCellRef.mOwner)
+        if (owner != (mExtra ? mExtra->mOwner : std::string()))
         {
             mChanged = true;
-            mCellRef.mOwner = owner;
+            getExtra().mOwner = owner;
         }
     }
 
     std::string CellRef::getSoul() const
     {
-        return mCellRef.mSoul;
+        return mExtra ? mExtra->mSoul : std::string();
     }
 
     void CellRef::setSoul(const std::string &soul)
     {
-        if (soul != mCellRef.mSoul)
+        if (soul != (mExtra ? mExtra->mSoul : std::string()))
         {
             mChanged = true;
-            mCellRef.mSoul = soul;
+            getExtra().mSoul = soul;
         }
     }
 
     std::string CellRef::getFaction() const
     {
-        return mCellRef.mFaction;
+        return mExtra ? mExtra->mFaction : std::string();
     }
 
     void CellRef::setFaction(const std::string &faction)
     {
-        if (faction != mCellRef.mFaction)
+        if (faction != (mExtra ? mExtra->mFaction : std::string()))
         {
             mChanged = true;
-            mCellRef.mFaction = faction;
+            getExtra().mFaction = faction;
         }
     }
 
     int CellRef::getLockLevel() const
     {
-        return mCellRef.mLockLevel;
+        return mLockLevel;
     }
 
     void CellRef::setLockLevel(int lockLevel)
     {
-        if (lockLevel != mCellRef.mLockLevel)
+        if (lockLevel != mLockLevel)
         {
             mChanged = true;
-            mCellRef.mLockLevel = lockLevel;
+            mLockLevel = lockLevel;
         }
     }
 
@@ -240,45 +370,69 @@ namespace MWWorld
 
     void CellRef::unlock()
     {
-        setLockLevel(-abs(mCellRef.mLockLevel)); //Makes lockLevel negative
+        setLockLevel(-abs(mLockLevel)); //Makes lockLevel negative
     }
 
     std::string CellRef::getKey() const
     {
-        return mCellRef.mKey;
+        return mExtra ? mExtra->mKey : std::string();
     }
 
     std::string CellRef::getTrap() const
     {
-        return mCellRef.mTrap;
+        return mExtra ? mExtra->mTrap : std::string();
     }
 
     void CellRef::setTrap(const std::string& trap)
     {
-        if (trap != mCellRef.mTrap)
+        if (trap != (mExtra ? mExtra->mTrap : std::string()))
         {
             mChanged = true;
-            mCellRef.mTrap = trap;
+            getExtra().mTrap = trap;
         }
     }
 
     int CellRef::getGoldValue() const
     {
-        return mCellRef.mGoldValue;
+        return mGoldValue;
     }
 
     void CellRef::setGoldValue(int value)
     {
-        if (value != mCellRef.mGoldValue)
+        if (value != mGoldValue)
         {
             mChanged = true;
-            mCellRef.mGoldValue = value;
+            mGoldValue = value;
         }
     }
 
     void CellRef::writeState(ESM::ObjectState &state) const
     {
-        state.mRef = mCellRef;
+        ESM::CellRef& ref = state.mRef;
+        ref.blank();
+        ref.mRefNum = mRefNum;
+        ref.mRefID = *mRefId;
+        ref.mScale = mScale;
+        ref.mFactionRank = mFactionRank;
+        ref.mChargeInt = mChargeInt;
+        ref.mChargeIntRemainder = mChargeIntRemainder;
+        ref.mEnchantmentCharge = mEnchantmentCharge;
+        ref.mGoldValue = mGoldValue;
+        ref.mTeleport = mTeleport;
+        ref.mLockLevel = mLockLevel;
+        ref.mReferenceBlocked = mReferenceBlocked;
+        ref.mPos = mPos;
+        if (mExtra)
+        {
+            ref.mOwner = mExtra->mOwner;
+            ref.mGlobalVariable = mExtra->mGlobalVariable;
+            ref.mSoul = mExtra->mSoul;
+            ref.mFaction = mExtra->mFaction;
+            ref.mDoorDest = mExtra->mDoorDest;
+            ref.mDestCell = mExtra->mDestCell;
+            ref.mKey = mExtra->mKey;
+            ref.mTrap = mExtra->mTrap;
+        }
     }
 
     bool CellRef::hasChanged() const
@@ -286,4 +440,9 @@ namespace MWWorld
         return mChanged;
     }
 
+    bool CellRef::hasExtra() const
+    {
+        return mExtra != nullptr;
+    }
+
 }
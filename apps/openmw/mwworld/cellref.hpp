@@ -1,6 +1,8 @@
 #ifndef OPENMW_MWWORLD_CELLREF_H
 #define OPENMW_MWWORLD_CELLREF_H
 
+#include <memory>
+
 #include <components/esm/cellref.hpp>
 
 namespace ESM
@@ -12,15 +14,20 @@ namespace MWWorld
 {
 
     /// \brief Encapsulated variant of ESM::CellRef with change tracking
+    /// @par Stored compactly, since there is one for every object of every loaded cell: the ID is interned,
+    /// and the fields most references leave empty are only allocated if any of them is used.
     class CellRef
     {
     public:
 
-        CellRef (const ESM::CellRef& ref)
-            : mCellRef(ref)
-        {
-            mChanged = false;
-        }
+        CellRef (const ESM::CellRef& ref);
+
+        CellRef (const CellRef& other);
+        CellRef& operator= (const CellRef& other);
+        // Moving hands over the rarely used fields without copying them, the moved-from ref is left without them
+        CellRef (CellRef&& other) noexcept;
+        CellRef& operator= (CellRef&& other) noexcept;
+        ~CellRef();
 
         // Note: Currently unused for items in containers
         const ESM::RefNum& getRefNum() const;
@@ -119,9 +126,36 @@ namespace MWWorld
         // Has this CellRef changed since it was originally loaded?
         bool hasChanged() const;
 
+        // Are the rarely used fields allocated?
+        bool hasExtra() const;
+
     private:
+        struct Extra;
+
+        Extra& getExtra();
+
+        ESM::RefNum mRefNum;
+        const std::string* mRefId;
+        std::unique_ptr<Extra> mExtra;
+
+        ESM::Position mPos;
+        float mScale;
+
+        union
+        {
+            int mChargeInt;
+            float mChargeFloat;
+        };
+        float mChargeIntRemainder;
+        float mEnchantmentCharge;
+
+        int mFactionRank;
+        int mGoldValue;
+        int mLockLevel;
+
+        signed char mReferenceBlocked;
+        bool mTeleport;
         bool mChanged;
-        ESM::CellRef mCellRef;
     };
 
 }
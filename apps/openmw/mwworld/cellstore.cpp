@@ -506,7 +506,7 @@ namespace MWWorld
             {
                 // Reopen the ESM reader and seek to the right position.
                 int index = mCell->mContextList.at(i).index;
-                mCell->restore (esm[index], i);
+                mCell->restoreRefs (esm[index], i);
 
                 ESM::CellRef ref;
 
@@ -564,7 +564,7 @@ namespace MWWorld
             {
                 // Reopen the ESM reader and seek to the right position.
                 int index = mCell->mContextList.at(i).index;
-                mCell->restore (esm[index], i);
+                mCell->restoreRefs (esm[index], i);
 
                 ESM::CellRef ref;
                 ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
@@ -317,6 +317,10 @@ namespace MWWorld
             models.push_back(model);
     }
 
+    void Class::getSoundsToPreload(const Ptr &ptr, std::vector<std::string> &sounds) const
+    {
+    }
+
     std::string Class::applyEnchantment(const MWWorld::ConstPtr &ptr, const std::string& enchId, int enchCharge, const std::string& newName) const
     {
         throw std::runtime_error ("class can't be enchanted");
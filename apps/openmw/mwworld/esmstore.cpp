@@ -20,7 +20,7 @@ namespace
             size_t index = cell.mContextList[i].index;
             if (readers.size() <= index)
                 readers.resize(index + 1);
-            cell.restore(readers[index], i);
+            cell.restoreRefs(readers[index], i);
             ESM::CellRef ref;
             ref.mRefNum.mContentFile = ESM::RefNum::RefNum_NoContentFile;
             bool deleted = false;
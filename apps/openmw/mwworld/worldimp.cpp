@@ -1,5 +1,12 @@
 #include "worldimp.hpp"
 
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
 #include <osg/Group>
 #include <osg/ComputeBoundsVisitor>
 
@@ -86,6 +93,55 @@ void wrap(float& rad)
         rad = std::fmod(rad-pi, 2.0f*pi)+pi;
 }
 
+// Returns a cache directory unique to the loaded content files, so that data baked from them is rebuilt when they change
+std::string getContentCachePath(const std::string& cachePath, const Files::Collections& fileCollections,
+                                const std::vector<std::string>& contentFiles)
+{
+    std::ostringstream key;
+    for (const std::string& file : contentFiles)
+    {
+        const Files::MultiDirCollection& col = fileCollections.getCollection(boost::filesystem::path(file).extension().string());
+        const boost::filesystem::path path = col.getPath(file);
+        key << Misc::StringUtils::lowerCase(file) << ':' << boost::filesystem::file_size(path)
+            << ':' << boost::filesystem::last_write_time(path) << ';';
+    }
+    std::ostringstream name;
+    name << std::hex << std::hash<std::string>()(key.str());
+    return (boost::filesystem::path(cachePath) / "content" / name.str()).string();
+}
+
+// Removes the cache directories of other sets of content files, except for the most recently used ones
+void removeOldContentCaches(const std::string& contentCachePath)
+{
+    const std::size_t maxContentCaches = 4;
+    try
+    {
+        const boost::filesystem::path current (contentCachePath);
+        boost::filesystem::create_directories(current);
+        boost::filesystem::last_write_time(current, std::time(nullptr));
+
+        std::vector<std::pair<std::time_t, boost::filesystem::path> > others;
+        for (boost::filesystem::directory_iterator it (current.parent_path()), end; it != end; ++it)
+        {
+            if (it->path() != current && boost::filesystem::is_directory(it->path()))
+                others.emplace_back(boost::filesystem::last_write_time(it->path()), it->path());
+        }
+        if (others.size() < maxContentCaches)
+            return;
+
+        std::sort(others.begin(), others.end(), std::greater<std::pair<std::time_t, boost::filesystem::path> >());
+        for (std::size_t i = maxContentCaches - 1; i < others.size(); ++i)
+        {
+            Log(Debug::Info) << "Removing unused content cache " << others[i].second;
+            boost::filesystem::remove_all(others[i].second);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        Log(Debug::Warning) << "Warning: Failed to clean up content cache directory " << contentCachePath << ": " << e.what();
+    }
+}
+
 }
 
 namespace MWWorld
@@ -141,7 +197,7 @@ namespace MWWorld
         const std::vector<std::string>& contentFiles,
         ToUTF8::Utf8Encoder* encoder, int activationDistanceOverride,
         const std::string& startCell, const std::string& startupScript,
-        const std::string& resourcePath, const std::string& userDataPath)
+        const std::string& resourcePath, const std::string& userDataPath, const std::string& cachePath)
     : mResourceSystem(resourceSystem), mLocalScripts (mStore),
       mCells (mStore, mEsm), mSky (true),
       mGodMode(false), mScriptsEnabled(true), mContentFiles (contentFiles),
@@ -196,7 +252,16 @@ namespace MWWorld
             mNavigator.reset(new DetourNavigator::NavigatorStub());
         }
 
-        mRendering.reset(new MWRender::RenderingManager(viewer, rootNode, resourceSystem, workQueue, resourcePath, *mNavigator));
+        // The terrain is the only user of the content cache so far, don't look at the content files if it's disabled
+        std::string contentCachePath;
+        if (Settings::Manager::getBool("terrain cache", "Terrain"))
+        {
+            contentCachePath = getContentCachePath(cachePath, fileCollections, contentFiles);
+            removeOldContentCaches(contentCachePath);
+        }
+
+        mRendering.reset(new MWRender::RenderingManager(viewer, rootNode, resourceSystem, workQueue, resourcePath,
+            contentCachePath, *mNavigator));
         mProjectileManager.reset(new ProjectileManager(mRendering->getLightRoot(), resourceSystem, mRendering.get(), mPhysics.get()));
         mRendering->preloadCommonAssets();
 
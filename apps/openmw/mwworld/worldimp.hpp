@@ -197,7 +197,7 @@ namespace MWWorld
                 const std::vector<std::string>& contentFiles,
                 ToUTF8::Utf8Encoder* encoder, int activationDistanceOverride,
                 const std::string& startCell, const std::string& startupScript,
-                const std::string& resourcePath, const std::string& userDataPath);
+                const std::string& resourcePath, const std::string& userDataPath, const std::string& cachePath);
 
             virtual ~World();
 
@@ -0,0 +1,145 @@
+#include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/loadcell.hpp>
+#include <components/esm/cellref.hpp>
+#include <components/esm/defs.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+namespace
+{
+    using namespace testing;
+
+    struct RefInfo
+    {
+        std::string mRefId;
+        size_t mOffset;
+
+        bool operator==(const RefInfo& other) const
+        {
+            return mRefId == other.mRefId && mOffset == other.mOffset;
+        }
+    };
+
+    std::ostream& operator<<(std::ostream& stream, const RefInfo& info)
+    {
+        return stream << info.mRefId << "@" << info.mOffset;
+    }
+
+    struct ESMReaderRestoreContextTest : Test
+    {
+        ESM::ESMReader mReader;
+        std::vector<ESM::Cell> mCells;
+
+        ESMReaderRestoreContextTest()
+        {
+            std::shared_ptr<std::stringstream> stream = std::make_shared<std::stringstream>();
+
+            ESM::ESMWriter writer;
+            writer.setFormat(0);
+            writer.setVersion(ESM::VER_13);
+            writer.save(*stream);
+            for (int c = 0; c < 3; ++c)
+            {
+                ESM::Cell cell;
+                cell.blank();
+                cell.mName = "cell" + std::to_string(c);
+                cell.mData.mFlags = ESM::Cell::Interior;
+                writer.startRecord(ESM::REC_CELL);
+                cell.save(writer);
+                for (int i = 0; i < 5 + c; ++i)
+                {
+                    ESM::CellRef ref;
+                    ref.blank();
+                    ref.mRefNum.mIndex = i + 1;
+                    ref.mRefID = "object_" + std::to_string(c) + "_" + std::to_string(i);
+                    ref.mPos.pos[0] = i * 10.f;
+                    ref.save(writer);
+                }
+                writer.endRecord(ESM::REC_CELL);
+            }
+            writer.close();
+
+            mReader.open(stream, "test.esm");
+            while (mReader.hasMoreRecs())
+            {
+                mReader.getRecName();
+                mReader.getRecHeader();
+                ESM::Cell cell;
+                bool deleted = false;
+                cell.load(mReader, deleted);
+                mCells.push_back(cell);
+            }
+        }
+
+        std::vector<RefInfo> readRefs(const ESM::Cell& cell)
+        {
+            std::vector<RefInfo> refs;
+            ESM::CellRef ref;
+            bool deleted = false;
+            while (cell.getNextRef(mReader, ref, deleted))
+                refs.push_back({ref.mRefID, mReader.getFileOffset()});
+            return refs;
+        }
+    };
+
+    TEST_F(ESMReaderRestoreContextTest, restore_refs_should_read_same_refs_at_same_offsets_as_restore)
+    {
+        ASSERT_EQ(mCells.size(), 3u);
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (int c = 2; c >= 0; --c)
+            {
+                mCells[c].restore(mReader, 0);
+                const std::vector<RefInfo> expected = readRefs(mCells[c]);
+                ASSERT_EQ(expected.size(), static_cast<size_t>(5 + c));
+
+                mCells[c].restoreRefs(mReader, 0);
+                EXPECT_EQ(readRefs(mCells[c]), expected) << "cell " << c;
+            }
+        }
+    }
+
+    TEST_F(ESMReaderRestoreContextTest, context_saved_while_reading_from_memory_should_resume_at_same_offset)
+    {
+        mCells[1].restoreRefs(mReader, 0);
+        ESM::CellRef ref;
+        bool deleted = false;
+        ASSERT_TRUE(mCells[1].getNextRef(mReader, ref, deleted));
+        ASSERT_TRUE(mCells[1].getNextRef(mReader, ref, deleted));
+
+        const ESM::ESM_Context context = mReader.getContext();
+        const size_t offset = mReader.getFileOffset();
+        const std::vector<RefInfo> expected = readRefs(mCells[1]);
+        ASSERT_EQ(expected.size(), 4u);
+
+        mCells[0].restoreRefs(mReader, 0);
+        readRefs(mCells[0]);
+
+        mReader.restoreContext(context);
+        EXPECT_EQ(mReader.getFileOffset(), offset);
+        EXPECT_EQ(readRefs(mCells[1]), expected);
+
+        mReader.restoreRecordContext(context);
+        EXPECT_EQ(mReader.getFileOffset(), offset);
+        EXPECT_EQ(readRefs(mCells[1]), expected);
+    }
+
+    TEST_F(ESMReaderRestoreContextTest, restore_should_read_from_file_after_restore_refs)
+    {
+        mCells[2].restoreRefs(mReader, 0);
+        readRefs(mCells[2]);
+
+        mCells[0].restore(mReader, 0);
+        EXPECT_EQ(readRefs(mCells[0]).size(), 5u);
+        ESM::Cell cell;
+        bool deleted = false;
+        ASSERT_TRUE(mReader.hasMoreRecs());
+        mReader.getRecName();
+        mReader.getRecHeader();
+        cell.load(mReader, deleted);
+        EXPECT_EQ(cell.mName, "cell1");
+    }
+}
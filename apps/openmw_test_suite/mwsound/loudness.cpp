@@ -0,0 +1,117 @@
+#include "apps/openmw/mwsound/loudness.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <tuple>
+
+namespace
+{
+    using namespace testing;
+    using namespace MWSound;
+
+    const float sValuesPerSecond = 20.f;
+    const int sSampleRate = 22050;
+
+    /// The envelope as the analysis used to compute it, from the whole buffer at once
+    std::vector<float> getReferenceEnvelope(const std::vector<char>& data, ChannelConfig channels, SampleType type)
+    {
+        const int samplesPerSegment = static_cast<int>(sSampleRate / sValuesPerSecond);
+        const int advance = framesToBytes(1, channels, type);
+        const int numSamples = bytesToFrames(data.size(), channels, type);
+
+        std::vector<float> envelope;
+        for (int segment = 0; segment < numSamples / samplesPerSegment; ++segment)
+        {
+            float sum = 0;
+            for (int sample = segment * samplesPerSegment; sample < (segment + 1) * samplesPerSegment; ++sample)
+            {
+                const char* frame = &data[sample * advance];
+                float value = 0;
+                if (type == SampleType_UInt8)
+                    value = ((char)(*frame^0x80))/128.f;
+                else if (type == SampleType_Int16)
+                {
+                    int16_t raw;
+                    std::memcpy(&raw, frame, sizeof(raw));
+                    value = raw / float(std::numeric_limits<int16_t>::max());
+                }
+                else if (type == SampleType_Float32)
+                {
+                    std::memcpy(&value, frame, sizeof(value));
+                    value = std::max(-1.f, std::min(1.f, value));
+                }
+                sum += value*value;
+            }
+            envelope.push_back(std::sqrt(sum / samplesPerSegment));
+        }
+        return envelope;
+    }
+
+    std::vector<char> makeSound(std::size_t frames, ChannelConfig channels, SampleType type, std::mt19937& random)
+    {
+        std::vector<char> data(framesToBytes(frames, channels, type));
+        if (type == SampleType_Float32)
+        {
+            std::uniform_real_distribution<float> distribution(-1.2f, 1.2f);
+            for (std::size_t i = 0; i + sizeof(float) <= data.size(); i += sizeof(float))
+            {
+                const float value = distribution(random);
+                std::memcpy(&data[i], &value, sizeof(value));
+            }
+        }
+        else
+        {
+            std::uniform_int_distribution<int> distribution(0, 255);
+            for (char& byte : data)
+                byte = static_cast<char>(distribution(random));
+        }
+        return data;
+    }
+
+    struct MWSoundLoudnessTest : TestWithParam<std::tuple<ChannelConfig, SampleType>> {};
+
+    TEST_P(MWSoundLoudnessTest, envelope_of_random_chunks_should_match_whole_buffer_analysis)
+    {
+        const ChannelConfig channels = std::get<0>(GetParam());
+        const SampleType type = std::get<1>(GetParam());
+
+        std::mt19937 random(42);
+        // Not a whole number of segments, so the last one is incomplete
+        const std::vector<char> data = makeSound(sSampleRate * 3 + 123, channels, type, random);
+        const std::vector<float> expected = getReferenceEnvelope(data, channels, type);
+        ASSERT_FALSE(expected.empty());
+
+        for (int run = 0; run < 10; ++run)
+        {
+            Sound_Loudness loudness(sValuesPerSecond, sSampleRate, channels, type);
+            // Includes chunks that are smaller than a frame, so frames are split between chunks
+            std::uniform_int_distribution<std::size_t> chunkSize(0, 3000);
+            std::size_t offset = 0;
+            while (offset < data.size())
+            {
+                const std::size_t size = std::min(chunkSize(random), data.size() - offset);
+                loudness.analyzeLoudness(data.data() + offset, size);
+                offset += size;
+            }
+
+            for (std::size_t i = 0; i < expected.size(); ++i)
+                EXPECT_EQ(loudness.getLoudnessAtTime((i + 0.5f) / sValuesPerSecond), expected[i]) << "run " << run << " value " << i;
+            EXPECT_EQ(loudness.getLoudnessAtTime((expected.size() + 0.5f) / sValuesPerSecond), expected.back());
+        }
+    }
+
+    INSTANTIATE_TEST_SUITE_P(AllFormats, MWSoundLoudnessTest, Combine(
+        Values(ChannelConfig_Mono, ChannelConfig_Stereo, ChannelConfig_5point1),
+        Values(SampleType_UInt8, SampleType_Int16, SampleType_Float32)
+    ));
+
+    TEST(MWSoundLoudnessSilenceTest, should_return_zero_before_analysis)
+    {
+        Sound_Loudness loudness(sValuesPerSecond, sSampleRate, ChannelConfig_Mono, SampleType_Int16);
+        EXPECT_EQ(loudness.getLoudnessAtTime(0.f), 0.f);
+    }
+}
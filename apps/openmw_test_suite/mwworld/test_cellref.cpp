@@ -0,0 +1,230 @@
+#include "apps/openmw/mwworld/cellref.hpp"
+
+#include <components/esm/objectstate.hpp>
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+#include <utility>
+
+namespace
+{
+    using namespace testing;
+
+    ESM::Position makePosition(float value)
+    {
+        ESM::Position position;
+        for (int i = 0; i < 3; ++i)
+        {
+            position.pos[i] = value + i;
+            position.rot[i] = value / 10.f + i;
+        }
+        return position;
+    }
+
+    ESM::CellRef makeFullRef()
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefNum.mIndex = 42;
+        ref.mRefNum.mContentFile = 3;
+        ref.mRefID = "misc_dwrv_coin00";
+        ref.mScale = 1.5f;
+        ref.mOwner = "fargoth";
+        ref.mGlobalVariable = "rent_bed";
+        ref.mSoul = "dremora";
+        ref.mFaction = "thieves guild";
+        ref.mFactionRank = 4;
+        ref.mChargeInt = 17;
+        ref.mChargeIntRemainder = 0.25f;
+        ref.mEnchantmentCharge = 12.5f;
+        ref.mGoldValue = 25;
+        ref.mTeleport = true;
+        ref.mDoorDest = makePosition(100.f);
+        ref.mDestCell = "Balmora, Guild of Mages";
+        ref.mLockLevel = 50;
+        ref.mKey = "key_arrile";
+        ref.mTrap = "trap_fire00";
+        ref.mReferenceBlocked = 1;
+        ref.mPos = makePosition(-20.f);
+        return ref;
+    }
+
+    void expectPositionEq(const ESM::Position& left, const ESM::Position& right)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT_EQ(left.pos[i], right.pos[i]);
+            EXPECT_EQ(left.rot[i], right.rot[i]);
+        }
+    }
+
+    void expectRefEq(const ESM::CellRef& left, const ESM::CellRef& right)
+    {
+        EXPECT_EQ(left.mRefNum, right.mRefNum);
+        EXPECT_EQ(left.mRefID, right.mRefID);
+        EXPECT_EQ(left.mScale, right.mScale);
+        EXPECT_EQ(left.mOwner, right.mOwner);
+        EXPECT_EQ(left.mGlobalVariable, right.mGlobalVariable);
+        EXPECT_EQ(left.mSoul, right.mSoul);
+        EXPECT_EQ(left.mFaction, right.mFaction);
+        EXPECT_EQ(left.mFactionRank, right.mFactionRank);
+        EXPECT_EQ(left.mChargeInt, right.mChargeInt);
+        EXPECT_EQ(left.mChargeIntRemainder, right.mChargeIntRemainder);
+        EXPECT_EQ(left.mEnchantmentCharge, right.mEnchantmentCharge);
+        EXPECT_EQ(left.mGoldValue, right.mGoldValue);
+        EXPECT_EQ(left.mTeleport, right.mTeleport);
+        expectPositionEq(left.mDoorDest, right.mDoorDest);
+        EXPECT_EQ(left.mDestCell, right.mDestCell);
+        EXPECT_EQ(left.mLockLevel, right.mLockLevel);
+        EXPECT_EQ(left.mKey, right.mKey);
+        EXPECT_EQ(left.mTrap, right.mTrap);
+        EXPECT_EQ(left.mReferenceBlocked, right.mReferenceBlocked);
+        expectPositionEq(left.mPos, right.mPos);
+    }
+
+    ESM::CellRef writeState(const MWWorld::CellRef& cellRef)
+    {
+        ESM::ObjectState state;
+        cellRef.writeState(state);
+        return state.mRef;
+    }
+
+    TEST(MWWorldCellRefTest, write_state_should_return_all_fields_of_full_ref)
+    {
+        const ESM::CellRef ref = makeFullRef();
+        const MWWorld::CellRef cellRef(ref);
+        expectRefEq(writeState(cellRef), ref);
+        EXPECT_FALSE(cellRef.hasChanged());
+    }
+
+    TEST(MWWorldCellRefTest, write_state_should_return_all_fields_of_blank_ref)
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefID = "flora_kreshweed_01";
+        ref.mPos = makePosition(5.f);
+        const MWWorld::CellRef cellRef(ref);
+        expectRefEq(writeState(cellRef), ref);
+    }
+
+    TEST(MWWorldCellRefTest, write_state_should_return_rarely_used_field_set_alone)
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefID = "chest_small_01";
+        ref.mTrap = "trap_fire00";
+        const MWWorld::CellRef cellRef(ref);
+        expectRefEq(writeState(cellRef), ref);
+    }
+
+    TEST(MWWorldCellRefTest, write_state_should_return_values_set_after_construction)
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefID = "chest_small_01";
+        MWWorld::CellRef cellRef(ref);
+
+        cellRef.setOwner("fargoth");
+        cellRef.setFaction("thieves guild");
+        cellRef.setFactionRank(2);
+        cellRef.setSoul("dremora");
+        cellRef.setTrap("trap_fire00");
+        cellRef.setLockLevel(30);
+        cellRef.setScale(0.5f);
+        cellRef.setCharge(9);
+        cellRef.setGoldValue(7);
+        cellRef.setPosition(makePosition(1.f));
+        EXPECT_TRUE(cellRef.hasChanged());
+
+        ref.mOwner = "fargoth";
+        ref.mFaction = "thieves guild";
+        ref.mFactionRank = 2;
+        ref.mSoul = "dremora";
+        ref.mTrap = "trap_fire00";
+        ref.mLockLevel = 30;
+        ref.mScale = 0.5f;
+        ref.mChargeInt = 9;
+        ref.mGoldValue = 7;
+        ref.mPos = makePosition(1.f);
+        expectRefEq(writeState(cellRef), ref);
+
+        cellRef.setOwner("");
+        cellRef.setFaction("");
+        cellRef.setSoul("");
+        cellRef.setTrap("");
+        ref.mOwner.clear();
+        ref.mFaction.clear();
+        ref.mSoul.clear();
+        ref.mTrap.clear();
+        expectRefEq(writeState(cellRef), ref);
+    }
+
+    TEST(MWWorldCellRefTest, setting_empty_field_to_empty_value_should_not_change_ref)
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefID = "chest_small_01";
+        MWWorld::CellRef cellRef(ref);
+        cellRef.setOwner("");
+        EXPECT_FALSE(cellRef.hasChanged());
+    }
+
+    TEST(MWWorldCellRefTest, copies_should_not_share_changes)
+    {
+        const ESM::CellRef ref = makeFullRef();
+        const MWWorld::CellRef original(ref);
+        MWWorld::CellRef copy(original);
+        copy.setOwner("vivec");
+        copy.setTrap("");
+
+        expectRefEq(writeState(original), ref);
+        EXPECT_EQ(copy.getOwner(), "vivec");
+        EXPECT_EQ(copy.getTrap(), "");
+
+        MWWorld::CellRef assigned(original);
+        assigned = copy;
+        EXPECT_EQ(assigned.getOwner(), "vivec");
+        copy.setOwner("almalexia");
+        EXPECT_EQ(assigned.getOwner(), "vivec");
+        expectRefEq(writeState(original), ref);
+    }
+
+    static_assert(std::is_nothrow_move_constructible<MWWorld::CellRef>::value, "CellRef should be nothrow move constructible");
+    static_assert(std::is_nothrow_move_assignable<MWWorld::CellRef>::value, "CellRef should be nothrow move assignable");
+
+    TEST(MWWorldCellRefTest, move_should_hand_over_rarely_used_fields_without_allocating)
+    {
+        const ESM::CellRef ref = makeFullRef();
+        MWWorld::CellRef original(ref);
+        ASSERT_TRUE(original.hasExtra());
+
+        MWWorld::CellRef moved(std::move(original));
+        EXPECT_TRUE(moved.hasExtra());
+        EXPECT_FALSE(original.hasExtra());
+        expectRefEq(writeState(moved), ref);
+
+        // Reading the moved-from ref must not allocate new fields for it
+        EXPECT_EQ(original.getOwner(), "");
+        writeState(original);
+        EXPECT_FALSE(original.hasExtra());
+
+        MWWorld::CellRef assigned(original);
+        EXPECT_FALSE(assigned.hasExtra());
+        assigned = std::move(moved);
+        EXPECT_TRUE(assigned.hasExtra());
+        EXPECT_FALSE(moved.hasExtra());
+        expectRefEq(writeState(assigned), ref);
+    }
+
+    TEST(MWWorldCellRefTest, refs_with_same_id_should_share_it)
+    {
+        ESM::CellRef ref;
+        ref.blank();
+        ref.mRefID = "misc_com_bottle_01";
+        const MWWorld::CellRef first(ref);
+        const MWWorld::CellRef second(ref);
+        EXPECT_EQ(first.getRefIdPtr(), second.getRefIdPtr());
+        EXPECT_EQ(first.getRefId(), ref.mRefID);
+    }
+}
@@ -0,0 +1,145 @@
+#include <components/nif/nifkey.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+    using namespace testing;
+    using namespace Nif;
+
+    struct NifKeyMapTest : Test
+    {
+        std::string mData;
+
+        template <class T>
+        void write(T value)
+        {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            mData.append(bytes, sizeof(T));
+        }
+
+        void writeHeader(unsigned int count, unsigned int interpolationType)
+        {
+            write(count);
+            write(interpolationType);
+        }
+
+        void writeKey(float time, float value)
+        {
+            write(time);
+            write(value);
+        }
+
+        void writeQuadraticKey(float time, float value, float inTan, float outTan)
+        {
+            write(time);
+            write(value);
+            write(inTan);
+            write(outTan);
+        }
+
+        FloatKeyMap read()
+        {
+            NIFStream nif(nullptr, std::make_shared<std::istringstream>(mData));
+            FloatKeyMap keyMap;
+            keyMap.read(&nif);
+            return keyMap;
+        }
+    };
+
+    TEST_F(NifKeyMapTest, should_keep_sorted_keys_in_order)
+    {
+        writeHeader(3, InterpolationType_Linear);
+        writeKey(0.f, 1.f);
+        writeKey(1.f, 2.f);
+        writeKey(2.f, 3.f);
+
+        const FloatKeyMap keyMap = read();
+
+        EXPECT_EQ(keyMap.mInterpolationType, static_cast<unsigned int>(InterpolationType_Linear));
+        ASSERT_EQ(keyMap.mKeys.size(), 3u);
+        EXPECT_EQ(keyMap.mKeys[0].first, 0.f);
+        EXPECT_EQ(keyMap.mKeys[0].second.mValue, 1.f);
+        EXPECT_EQ(keyMap.mKeys[1].first, 1.f);
+        EXPECT_EQ(keyMap.mKeys[1].second.mValue, 2.f);
+        EXPECT_EQ(keyMap.mKeys[2].first, 2.f);
+        EXPECT_EQ(keyMap.mKeys[2].second.mValue, 3.f);
+    }
+
+    TEST_F(NifKeyMapTest, should_sort_keys_by_time)
+    {
+        writeHeader(4, InterpolationType_Linear);
+        writeKey(3.f, 4.f);
+        writeKey(1.f, 2.f);
+        writeKey(0.f, 1.f);
+        writeKey(2.f, 3.f);
+
+        const FloatKeyMap keyMap = read();
+
+        ASSERT_EQ(keyMap.mKeys.size(), 4u);
+        for (std::size_t i = 0; i < keyMap.mKeys.size(); ++i)
+        {
+            EXPECT_EQ(keyMap.mKeys[i].first, static_cast<float>(i));
+            EXPECT_EQ(keyMap.mKeys[i].second.mValue, static_cast<float>(i + 1));
+        }
+    }
+
+    TEST_F(NifKeyMapTest, should_keep_last_key_for_same_time)
+    {
+        writeHeader(4, InterpolationType_Linear);
+        writeKey(1.f, 10.f);
+        writeKey(0.f, 1.f);
+        writeKey(1.f, 20.f);
+        writeKey(1.f, 30.f);
+
+        const FloatKeyMap keyMap = read();
+
+        ASSERT_EQ(keyMap.mKeys.size(), 2u);
+        EXPECT_EQ(keyMap.mKeys[0].first, 0.f);
+        EXPECT_EQ(keyMap.mKeys[0].second.mValue, 1.f);
+        EXPECT_EQ(keyMap.mKeys[1].first, 1.f);
+        EXPECT_EQ(keyMap.mKeys[1].second.mValue, 30.f);
+    }
+
+    TEST_F(NifKeyMapTest, should_keep_last_key_for_same_time_in_sorted_input)
+    {
+        writeHeader(3, InterpolationType_Linear);
+        writeKey(0.f, 1.f);
+        writeKey(1.f, 2.f);
+        writeKey(1.f, 3.f);
+
+        const FloatKeyMap keyMap = read();
+
+        ASSERT_EQ(keyMap.mKeys.size(), 2u);
+        EXPECT_EQ(keyMap.mKeys[1].first, 1.f);
+        EXPECT_EQ(keyMap.mKeys[1].second.mValue, 3.f);
+    }
+
+    TEST_F(NifKeyMapTest, should_keep_tangents_of_last_quadratic_key_for_same_time)
+    {
+        writeHeader(2, InterpolationType_Quadratic);
+        writeQuadraticKey(1.f, 1.f, 2.f, 3.f);
+        writeQuadraticKey(1.f, 4.f, 5.f, 6.f);
+
+        const FloatKeyMap keyMap = read();
+
+        ASSERT_EQ(keyMap.mKeys.size(), 1u);
+        EXPECT_EQ(keyMap.mKeys[0].second.mValue, 4.f);
+        EXPECT_EQ(keyMap.mKeys[0].second.mInTan, 5.f);
+        EXPECT_EQ(keyMap.mKeys[0].second.mOutTan, 6.f);
+    }
+
+    TEST_F(NifKeyMapTest, should_read_no_keys_for_zero_count)
+    {
+        write(0u);
+
+        const FloatKeyMap keyMap = read();
+
+        EXPECT_EQ(keyMap.mInterpolationType, static_cast<unsigned int>(InterpolationType_Unknown));
+        EXPECT_TRUE(keyMap.mKeys.empty());
+    }
+}
@@ -0,0 +1,230 @@
+#include <components/sceneutil/riggeometry.hpp>
+#include <components/sceneutil/skeleton.hpp>
+
+#include <osg/MatrixTransform>
+#include <osgUtil/CullVisitor>
+#include <osgUtil/RenderStage>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace testing;
+    using namespace SceneUtil;
+
+    // Collects the geometries submitted by the RigGeometry instead of adding them to a render graph
+    struct RecordDrawablesVisitor : osgUtil::CullVisitor
+    {
+        using osgUtil::CullVisitor::apply;
+
+        std::vector<osg::Drawable*> mDrawables;
+
+        void apply(osg::Drawable& drawable) override
+        {
+            mDrawables.push_back(&drawable);
+        }
+    };
+
+    // <bone index, weight>
+    typedef std::vector<std::pair<unsigned int, float>> VertexWeights;
+
+    // A synthetic skinned mesh: every vertex is influenced by 1 to 4 neighbouring bones of a flat skeleton
+    struct SceneUtilRigGeometryTest : Test
+    {
+        const unsigned int mNumBones = 40;
+        const unsigned int mNumVertices = 2000;
+        std::mt19937 mRandom;
+        std::uniform_real_distribution<float> mDistribution {-1.f, 1.f};
+        osg::ref_ptr<Skeleton> mSkeleton = new Skeleton;
+        std::vector<osg::ref_ptr<osg::MatrixTransform>> mBones;
+        osg::ref_ptr<RigGeometry::InfluenceMap> mInfluenceMap = new RigGeometry::InfluenceMap;
+        std::vector<VertexWeights> mVertexWeights;
+        osg::ref_ptr<osg::Vec3Array> mPositions = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec3Array> mNormals = new osg::Vec3Array;
+        osg::ref_ptr<osg::Vec4Array> mTangents = new osg::Vec4Array;
+        osg::ref_ptr<RigGeometry> mRig = new RigGeometry;
+        osg::ref_ptr<RecordDrawablesVisitor> mCullVisitor = new RecordDrawablesVisitor;
+        unsigned int mFrameNumber = 0;
+
+        SceneUtilRigGeometryTest()
+        {
+            for (unsigned int i = 0; i < mNumBones; ++i)
+            {
+                osg::ref_ptr<osg::MatrixTransform> bone = new osg::MatrixTransform(randomTransform());
+                bone->setName("Bone " + std::to_string(i));
+                mSkeleton->addChild(bone);
+                mBones.push_back(bone);
+
+                RigGeometry::BoneInfluence influence;
+                influence.mInvBindMatrix = randomTransform();
+                influence.mBoundSphere = osg::BoundingSpheref(osg::Vec3f(), 10.f);
+                mInfluenceMap->mData.emplace_back(bone->getName(), influence);
+            }
+
+            for (unsigned int vertex = 0; vertex < mNumVertices; ++vertex)
+            {
+                mPositions->push_back(randomVector());
+                mNormals->push_back(randomVector());
+                mTangents->push_back(osg::Vec4f(randomVector(), 1.f));
+
+                const unsigned int count = 1 + mRandom() % 4;
+                const unsigned int first = mRandom() % (mNumBones - count + 1);
+                VertexWeights weights;
+                for (unsigned int bone = first; bone < first + count; ++bone)
+                {
+                    weights.emplace_back(bone, 1.f / count);
+                    mInfluenceMap->mData[bone].second.mWeights.emplace_back(vertex, 1.f / count);
+                }
+                mVertexWeights.push_back(weights);
+            }
+
+            osg::ref_ptr<osg::Geometry> sourceGeometry = new osg::Geometry;
+            sourceGeometry->setVertexArray(mPositions);
+            sourceGeometry->setNormalArray(mNormals, osg::Array::BIND_PER_VERTEX);
+            sourceGeometry->setTexCoordArray(7, mTangents, osg::Array::BIND_PER_VERTEX);
+            sourceGeometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, mNumVertices));
+
+            mRig->setInfluenceMap(mInfluenceMap);
+            mRig->setSourceGeometry(sourceGeometry);
+            mSkeleton->addChild(mRig);
+
+            mCullVisitor->setRenderStage(new osgUtil::RenderStage);
+        }
+
+        osg::Vec3f randomVector()
+        {
+            return osg::Vec3f(mDistribution(mRandom), mDistribution(mRandom), mDistribution(mRandom));
+        }
+
+        osg::Matrixf randomTransform()
+        {
+            osg::Vec3f axis = randomVector() + osg::Vec3f(0, 0, 2);
+            axis.normalize();
+            return osg::Matrixf::rotate(mDistribution(mRandom) * osg::PIf, axis) * osg::Matrixf::translate(randomVector() * 10.f);
+        }
+
+        // Runs the update and cull traversals of the next frame and returns the skinned geometry
+        const osg::Geometry* frame()
+        {
+            ++mFrameNumber;
+
+            osg::NodeVisitor updateVisitor(osg::NodeVisitor::UPDATE_VISITOR, osg::NodeVisitor::TRAVERSE_ALL_CHILDREN);
+            updateVisitor.setTraversalNumber(mFrameNumber);
+            mSkeleton->accept(updateVisitor);
+
+            // skip the view frustum culling of the skeleton, the visitor has no camera
+            mCullVisitor->mDrawables.clear();
+            mCullVisitor->setTraversalNumber(mFrameNumber);
+            mCullVisitor->pushOntoNodePath(mSkeleton);
+            mSkeleton->traverse(*mCullVisitor);
+            mCullVisitor->popFromNodePath();
+
+            if (mCullVisitor->mDrawables.size() != 1)
+                return nullptr;
+            return dynamic_cast<const osg::Geometry*>(mCullVisitor->mDrawables.front());
+        }
+
+        // The weighted sum of the skinning matrices of a vertex, computed per vertex as the original implementation did
+        osg::Matrixf getReferenceMatrix(unsigned int vertex) const
+        {
+            osg::Matrixf result (0, 0, 0, 0,
+                                 0, 0, 0, 0,
+                                 0, 0, 0, 0,
+                                 0, 0, 0, 1);
+            for (const auto& weight : mVertexWeights[vertex])
+            {
+                const osg::Matrixf matrix = mInfluenceMap->mData[weight.first].second.mInvBindMatrix * mBones[weight.first]->getMatrix();
+                for (int row = 0; row < 4; ++row)
+                    for (int column = 0; column < 3; ++column)
+                        result(row, column) += matrix(row, column) * weight.second;
+            }
+            return result;
+        }
+
+        void expectSkinned(const osg::Geometry& geometry) const
+        {
+            const osg::Vec3Array& positions = static_cast<const osg::Vec3Array&>(*geometry.getVertexArray());
+            const osg::Vec3Array& normals = static_cast<const osg::Vec3Array&>(*geometry.getNormalArray());
+            const osg::Vec4Array& tangents = static_cast<const osg::Vec4Array&>(*geometry.getTexCoordArray(7));
+            ASSERT_EQ(positions.size(), mNumVertices);
+            ASSERT_EQ(normals.size(), mNumVertices);
+            ASSERT_EQ(tangents.size(), mNumVertices);
+
+            for (unsigned int vertex = 0; vertex < mNumVertices; ++vertex)
+            {
+                const osg::Matrixf matrix = getReferenceMatrix(vertex);
+                const osg::Vec3f position = matrix.preMult((*mPositions)[vertex]);
+                const osg::Vec3f normal = osg::Matrixf::transform3x3((*mNormals)[vertex], matrix);
+                const osg::Vec4f& sourceTangent = (*mTangents)[vertex];
+                const osg::Vec3f tangent = osg::Matrixf::transform3x3(osg::Vec3f(sourceTangent.x(), sourceTangent.y(), sourceTangent.z()), matrix);
+                for (int i = 0; i < 3; ++i)
+                {
+                    EXPECT_NEAR(positions[vertex][i], position[i], 1e-3f) << "vertex " << vertex;
+                    EXPECT_NEAR(normals[vertex][i], normal[i], 1e-3f) << "vertex " << vertex;
+                    EXPECT_NEAR(tangents[vertex][i], tangent[i], 1e-3f) << "vertex " << vertex;
+                }
+                EXPECT_EQ(tangents[vertex].w(), sourceTangent.w()) << "vertex " << vertex;
+            }
+        }
+    };
+
+    TEST_F(SceneUtilRigGeometryTest, cpu_skinning_should_match_per_vertex_reference)
+    {
+        const osg::Geometry* geometry = frame();
+        ASSERT_NE(geometry, nullptr);
+        expectSkinned(*geometry);
+    }
+
+    TEST_F(SceneUtilRigGeometryTest, cpu_skinning_should_follow_moved_bones)
+    {
+        ASSERT_NE(frame(), nullptr);
+
+        mBones[0]->setMatrix(randomTransform());
+        mBones[mNumBones / 2]->setMatrix(randomTransform());
+
+        const osg::Geometry* geometry = frame();
+        ASSERT_NE(geometry, nullptr);
+        expectSkinned(*geometry);
+    }
+
+    TEST_F(SceneUtilRigGeometryTest, cpu_skinning_should_keep_source_geometry)
+    {
+        const std::vector<osg::Vec3f> positions(mPositions->begin(), mPositions->end());
+
+        const osg::Geometry* geometry = frame();
+        ASSERT_NE(geometry, nullptr);
+
+        EXPECT_NE(geometry->getVertexArray(), mPositions.get());
+        EXPECT_EQ(std::vector<osg::Vec3f>(mPositions->begin(), mPositions->end()), positions);
+    }
+
+    // Not a correctness check: reports the time spent per frame on skinning the synthetic mesh on the CPU
+    TEST_F(SceneUtilRigGeometryTest, cpu_skinning_benchmark)
+    {
+        const unsigned int numFrames = 500;
+
+        ASSERT_NE(frame(), nullptr);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < numFrames; ++i)
+        {
+            mBones[i % mNumBones]->setMatrix(randomTransform());
+            frame();
+        }
+        const auto duration = std::chrono::steady_clock::now() - start;
+
+        std::cout << "[          ] " << mNumVertices << " vertices, " << mNumBones << " bones: "
+                  << std::chrono::duration_cast<std::chrono::duration<float, std::micro>>(duration).count() / numFrames
+                  << " us per frame" << std::endl;
+
+        const osg::Geometry* geometry = frame();
+        ASSERT_NE(geometry, nullptr);
+        expectSkinned(*geometry);
+    }
+}
@@ -0,0 +1,115 @@
+#include <components/vfs/manager.hpp>
+#include <components/vfs/archive.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace
+{
+    using namespace testing;
+
+    struct TestFile : VFS::File
+    {
+        Files::IStreamPtr open() override
+        {
+            return Files::IStreamPtr();
+        }
+    };
+
+    struct TestArchive : VFS::Archive
+    {
+        std::vector<std::string> mNames;
+        std::vector<std::unique_ptr<TestFile>> mFiles;
+
+        TestArchive(const std::vector<std::string>& names)
+            : mNames(names)
+        {
+            for (std::size_t i = 0; i < names.size(); ++i)
+                mFiles.emplace_back(new TestFile);
+        }
+
+        void listResources(std::map<std::string, VFS::File*>& out, char (*normalize_function) (char)) override
+        {
+            const VFS::NormalizeTable table(normalize_function);
+            for (std::size_t i = 0; i < mNames.size(); ++i)
+            {
+                std::string name;
+                table.normalize(mNames[i].data(), mNames[i].data() + mNames[i].size(), name);
+                out[name] = mFiles[i].get();
+            }
+        }
+    };
+
+    struct VFSManagerLookupTest : Test
+    {
+        VFS::Manager mManager {false};
+        TestArchive* mArchive = new TestArchive({"meshes/a.nif", "Meshes\\B.nif", "textures/tx_a.dds"});
+
+        VFSManagerLookupTest()
+        {
+            mManager.addArchive(mArchive);
+        }
+    };
+
+    TEST_F(VFSManagerLookupTest, should_find_normalized_name)
+    {
+        mManager.buildIndex();
+        EXPECT_EQ(mManager.lookup("meshes/a.nif"), mArchive->mFiles[0].get());
+        EXPECT_EQ(mManager.lookup("meshes/b.nif"), mArchive->mFiles[1].get());
+        EXPECT_EQ(mManager.lookup("textures/tx_a.dds"), mArchive->mFiles[2].get());
+    }
+
+    TEST_F(VFSManagerLookupTest, should_find_name_with_other_case_and_backslashes)
+    {
+        mManager.buildIndex();
+        EXPECT_EQ(mManager.lookup("MESHES\\A.NIF"), mArchive->mFiles[0].get());
+        EXPECT_EQ(mManager.lookup("Meshes/B.Nif"), mArchive->mFiles[1].get());
+        EXPECT_TRUE(mManager.exists("Textures\\TX_A.dds"));
+    }
+
+    TEST_F(VFSManagerLookupTest, should_return_nullptr_for_missing_name)
+    {
+        mManager.buildIndex();
+        EXPECT_EQ(mManager.lookup("meshes/c.nif"), nullptr);
+        EXPECT_EQ(mManager.lookup("meshes/a.ni"), nullptr);
+        EXPECT_EQ(mManager.lookup("meshes/a.nif "), nullptr);
+        EXPECT_EQ(mManager.lookup(""), nullptr);
+        EXPECT_FALSE(mManager.exists("meshes/c.nif"));
+    }
+
+    TEST_F(VFSManagerLookupTest, should_only_compare_given_size)
+    {
+        mManager.buildIndex();
+        const std::string name = "meshes/a.nif.kf";
+        EXPECT_EQ(mManager.lookup(name.data(), 12), mArchive->mFiles[0].get());
+        EXPECT_EQ(mManager.lookup(name.data(), name.size()), nullptr);
+    }
+
+    TEST_F(VFSManagerLookupTest, should_prefer_file_of_last_added_archive)
+    {
+        TestArchive* archive = new TestArchive({"MESHES/A.NIF"});
+        mManager.addArchive(archive);
+        mManager.buildIndex();
+        EXPECT_EQ(mManager.lookup("meshes/a.nif"), archive->mFiles[0].get());
+        EXPECT_EQ(mManager.lookup("meshes/b.nif"), mArchive->mFiles[1].get());
+    }
+
+    TEST_F(VFSManagerLookupTest, should_return_nullptr_after_reset)
+    {
+        mManager.buildIndex();
+        mManager.reset();
+        EXPECT_EQ(mManager.lookup("meshes/a.nif"), nullptr);
+    }
+
+    TEST(VFSManagerStrictLookupTest, should_only_convert_backslashes)
+    {
+        VFS::Manager manager(true);
+        TestArchive* archive = new TestArchive({"Meshes\\A.nif"});
+        manager.addArchive(archive);
+        manager.buildIndex();
+        EXPECT_EQ(manager.lookup("Meshes/A.nif"), archive->mFiles[0].get());
+        EXPECT_EQ(manager.lookup("Meshes\\A.nif"), archive->mFiles[0].get());
+        EXPECT_EQ(manager.lookup("meshes/a.nif"), nullptr);
+    }
+}
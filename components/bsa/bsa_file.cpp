@@ -27,13 +27,15 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <components/debug/debuglog.hpp>
 
 using namespace std;
 using namespace Bsa;
 
-
 /// Error handling
-void BSAFile::fail(const string &msg)
+void BSAFile::fail(const string &msg) const
 {
     throw std::runtime_error("BSA Error: " + msg + "\nArchive: " + mFilename);
 }
@@ -163,9 +165,60 @@ int BSAFile::getIndex(const char *str) const
 void BSAFile::open(const string &file)
 {
     mFilename = file;
+    mapFile();
     readHeader();
 }
 
+void BSAFile::mapFile()
+{
+    try
+    {
+        mMappedFile = std::make_shared<boost::iostreams::mapped_file_source>(mFilename);
+    }
+    catch (const std::exception& e)
+    {
+        Log(Debug::Warning) << "Warning: Failed to map " << mFilename << " into memory, reading it from disk instead: " << e.what();
+        mMappedFile.reset();
+    }
+}
+
+Files::IStreamPtr BSAFile::openStream(size_t offset, size_t size) const
+{
+    Files::MemoryView view;
+    if (getMappedRegion(offset, size, view))
+        return std::make_shared<Files::IMemViewStream>(view);
+    return Files::openConstrainedFileStream(mFilename.c_str(), offset, size);
+}
+
+bool BSAFile::getMappedRegion(size_t offset, size_t size, Files::MemoryView &view) const
+{
+    if (!mMappedFile || offset + size > mMappedFile->size())
+        return false;
+
+    view.mData = mMappedFile->data() + offset;
+    view.mSize = size;
+    view.mOwner = mMappedFile;
+    return true;
+}
+
+Files::MemoryView BSAFile::readRegion(size_t offset, size_t size) const
+{
+    Files::MemoryView view;
+    if (getMappedRegion(offset, size, view))
+        return view;
+
+    std::shared_ptr<std::vector<char> > buffer = std::make_shared<std::vector<char> >(size);
+    Files::IStreamPtr stream = Files::openConstrainedFileStream(mFilename.c_str(), offset, size);
+    stream->read(buffer->data(), size);
+    if (static_cast<size_t>(stream->gcount()) != size)
+        fail("Failed to read " + std::to_string(size) + " bytes at offset " + std::to_string(offset));
+
+    view.mData = buffer->data();
+    view.mSize = size;
+    view.mOwner = buffer;
+    return view;
+}
+
 Files::IStreamPtr BSAFile::getFile(const char *file)
 {
     assert(file);
@@ -175,10 +228,14 @@ Files::IStreamPtr BSAFile::getFile(const char *file)
 
     const FileStruct &fs = mFiles[i];
 
-    return Files::openConstrainedFileStream (mFilename.c_str (), fs.offset, fs.fileSize);
+    return openStream(fs.offset, fs.fileSize);
 }
 
 Files::IStreamPtr BSAFile::getFile(const FileStruct *file)
 {
-    return Files::openConstrainedFileStream (mFilename.c_str (), file->offset, file->fileSize);
+    return openStream(file->offset, file->fileSize);
+}
+
+void BSAFile::prefetch(const std::vector<const FileStruct*> &files)
+{
 }
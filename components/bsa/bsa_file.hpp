@@ -32,6 +32,15 @@
 #include <components/misc/stringops.hpp>
 
 #include <components/files/constrainedfilestream.hpp>
+#include <components/files/memorystream.hpp>
+
+namespace boost
+{
+namespace iostreams
+{
+    class mapped_file_source;
+}
+}
 
 
 namespace Bsa
@@ -69,6 +78,9 @@ protected:
     /// Used for error messages
     std::string mFilename;
 
+    /// The whole archive mapped into memory, or null if mapping failed
+    std::shared_ptr<boost::iostreams::mapped_file_source> mMappedFile;
+
     /// Case insensitive string comparison
     struct iltstr
     {
@@ -84,13 +96,25 @@ protected:
     Lookup mLookup;
 
     /// Error handling
-    void fail(const std::string &msg);
+    void fail(const std::string &msg) const;
 
     /// Read header information from the input source
     virtual void readHeader();
 
-    /// Read header information from the input source
+    /// Map the archive into memory, streams fall back to reading the file if this fails
+    void mapFile();
 
+    /// Open a stream for a region of the archive, reading straight from the mapped memory if possible.
+    /// @note Thread safe.
+    Files::IStreamPtr openStream(size_t offset, size_t size) const;
+
+    /// Get a view of a region of the mapped archive.
+    /// @return false if the archive is not mapped.
+    bool getMappedRegion(size_t offset, size_t size, Files::MemoryView& view) const;
+
+    /// Get the bytes of a region of the archive, from the mapping if possible, otherwise read into a new buffer.
+    /// @note Thread safe.
+    Files::MemoryView readRegion(size_t offset, size_t size) const;
 
     /// Get the index of a given file name, or -1 if not found
     /// @note Thread safe.
@@ -132,6 +156,12 @@ public:
     */
     virtual Files::IStreamPtr getFile(const FileStruct* file);
 
+    /** Prepare the given files for reading ahead of time, e.g. on a loading thread. Does nothing for
+        uncompressed archives, their files are read straight from the mapped archive.
+     * @note Thread safe.
+    */
+    virtual void prefetch(const std::vector<const FileStruct*>& files);
+
     /// Get a list of all files
     /// @note Thread safe.
     const FileList &getList() const
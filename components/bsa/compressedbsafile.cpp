@@ -26,6 +26,10 @@
 
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <list>
+#include <mutex>
 
 #include <boost/scoped_array.hpp>
 #include <boost/filesystem/path.hpp>
@@ -36,7 +40,90 @@
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/device/array.hpp>
-#include <components/bsa/memorystream.hpp>
+
+namespace
+{
+    // Budget for the uncompressed size of recently used files that are kept in memory, shared by all archives
+    const std::size_t sMaxDecompressedSize = 32 * 1024 * 1024;
+
+    typedef std::shared_ptr<const std::vector<char> > DecompressedData;
+
+    /// Recently decompressed files of all compressed archives, by archive and record offset.
+    class DecompressedCache
+    {
+    public:
+        typedef std::pair<const void*, std::uint32_t> Key;
+
+        DecompressedCache()
+            : mSize(0)
+        {
+        }
+
+        DecompressedData get(const Key& key)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto found = mLookup.find(key);
+            if (found == mLookup.end())
+                return DecompressedData();
+            mFiles.splice(mFiles.begin(), mFiles, found->second);
+            return found->second->second;
+        }
+
+        bool contains(const Key& key)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            return mLookup.find(key) != mLookup.end();
+        }
+
+        void add(const Key& key, const DecompressedData& data)
+        {
+            // Files that are this large are unlikely to be requested again soon and would flush the whole cache
+            if (data->size() > sMaxDecompressedSize / 4)
+                return;
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mLookup.find(key) != mLookup.end())
+                return;
+
+            mFiles.emplace_front(key, data);
+            mLookup[key] = mFiles.begin();
+            mSize += data->size();
+
+            while (mSize > sMaxDecompressedSize)
+            {
+                mSize -= mFiles.back().second->size();
+                mLookup.erase(mFiles.back().first);
+                mFiles.pop_back();
+            }
+        }
+
+        void removeArchive(const void* archive)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mLookup.lower_bound(Key(archive, 0));
+            while (it != mLookup.end() && it->first.first == archive)
+            {
+                mSize -= it->second->second->size();
+                mFiles.erase(it->second);
+                it = mLookup.erase(it);
+            }
+        }
+
+    private:
+        /// The most recently used first
+        typedef std::list<std::pair<Key, DecompressedData> > FileList;
+        FileList mFiles;
+        std::map<Key, FileList::iterator> mLookup;
+        std::size_t mSize;
+        std::mutex mMutex;
+    };
+
+    DecompressedCache& getDecompressedCache()
+    {
+        static DecompressedCache cache;
+        return cache;
+    }
+}
 
 namespace Bsa
 {
@@ -102,7 +189,9 @@ CompressedBSAFile::CompressedBSAFile()
 { }
 
 CompressedBSAFile::~CompressedBSAFile()
-{ }
+{
+    getDecompressedCache().removeArchive(this);
+}
 
 /// Read header information from the input source
 void CompressedBSAFile::readHeader()
@@ -328,31 +417,95 @@ Files::IStreamPtr CompressedBSAFile::getFile(const char* file)
 Files::IStreamPtr CompressedBSAFile::getFile(const FileRecord& fileRecord)
 {
     if (fileRecord.isCompressed(mCompressedByDefault)) {
-        Files::IStreamPtr streamPtr = Files::openConstrainedFileStream(mFilename.c_str(), fileRecord.offset, fileRecord.getSizeWithoutCompressionFlag());
+        DecompressedData data = getDecompressed(fileRecord);
 
-        std::istream* fileStream = streamPtr.get();
+        Files::MemoryView view;
+        view.mData = data->data();
+        view.mSize = data->size();
+        view.mOwner = data;
+        return std::make_shared<Files::IMemViewStream>(view);
+    }
 
-        if (mEmbeddedFileNames) {
-            std::string embeddedFileName;
-            getBZString(embeddedFileName, *fileStream);
-        }
+    return openStream(fileRecord.offset, fileRecord.size);
+}
+
+CompressedBSAFile::DecompressedData CompressedBSAFile::decompress(const FileRecord& fileRecord) const
+{
+    const Files::MemoryView record = readRegion(fileRecord.offset, fileRecord.getSizeWithoutCompressionFlag());
+
+    std::size_t position = 0;
+    if (mEmbeddedFileNames && record.mSize > 0)
+        position += 1 + static_cast<unsigned char>(record.mData[0]);
 
-        uint32_t uncompressedSize = 0u;
-        fileStream->read(reinterpret_cast<char*>(&uncompressedSize), sizeof(uncompressedSize));
+    std::uint32_t uncompressedSize = 0u;
+    if (position + sizeof(uncompressedSize) > record.mSize)
+        fail("Corrupted compressed file record");
+    std::memcpy(&uncompressedSize, record.mData + position, sizeof(uncompressedSize));
+    position += sizeof(uncompressedSize);
 
-        boost::iostreams::filtering_streambuf<boost::iostreams::input> inputStreamBuf;
-        inputStreamBuf.push(boost::iostreams::zlib_decompressor());
-        inputStreamBuf.push(*fileStream);
+    // Inflate straight from the record's bytes into the final buffer
+    std::shared_ptr<std::vector<char> > data = std::make_shared<std::vector<char> >(uncompressedSize);
 
-        std::shared_ptr<Bsa::MemoryInputStream> memoryStreamPtr = std::make_shared<MemoryInputStream>(uncompressedSize);
+    boost::iostreams::filtering_streambuf<boost::iostreams::input> inputStreamBuf;
+    inputStreamBuf.push(boost::iostreams::zlib_decompressor());
+    inputStreamBuf.push(boost::iostreams::array_source(record.mData + position, record.mSize - position));
 
-        boost::iostreams::basic_array_sink<char> sr(memoryStreamPtr->getRawData(), uncompressedSize);
-        boost::iostreams::copy(inputStreamBuf, sr);
+    boost::iostreams::basic_array_sink<char> sink(data->data(), uncompressedSize);
+    boost::iostreams::copy(inputStreamBuf, sink);
 
-        return std::shared_ptr<std::istream>(memoryStreamPtr, (std::istream*)memoryStreamPtr.get());
+    return data;
+}
+
+CompressedBSAFile::DecompressedData CompressedBSAFile::getDecompressed(const FileRecord& fileRecord)
+{
+    DecompressedCache& cache = getDecompressedCache();
+    const DecompressedCache::Key key (this, fileRecord.offset);
+
+    DecompressedData data = cache.get(key);
+    if (!data)
+    {
+        data = decompress(fileRecord);
+        cache.add(key, data);
     }
+    return data;
+}
 
-    return Files::openConstrainedFileStream(mFilename.c_str(), fileRecord.offset, fileRecord.size);
+void CompressedBSAFile::prefetch(const std::vector<const FileStruct*>& files)
+{
+    DecompressedCache& cache = getDecompressedCache();
+    std::vector<FileRecord> records;
+    std::size_t totalSize = 0;
+    for (const FileStruct* file : files)
+    {
+        FileRecord fileRecord = getFileRecord(file->name);
+        if (!fileRecord.isValid() || !fileRecord.isCompressed(mCompressedByDefault))
+            continue;
+
+        if (cache.contains(DecompressedCache::Key(this, fileRecord.offset)))
+            continue;
+
+        // Don't let the batch evict its own files before they are used
+        if (totalSize + file->fileSize > sMaxDecompressedSize / 2)
+            break;
+        totalSize += file->fileSize;
+        records.push_back(fileRecord);
+    }
+
+    std::sort(records.begin(), records.end(), [] (const FileRecord& left, const FileRecord& right) { return left.offset < right.offset; });
+    records.erase(std::unique(records.begin(), records.end(), [] (const FileRecord& left, const FileRecord& right) { return left.offset == right.offset; }), records.end());
+
+    // Runs on the calling loading thread, concurrent loads are spread over the threads of their work queue
+    for (const FileRecord& record : records)
+    {
+        try
+        {
+            cache.add(DecompressedCache::Key(this, record.offset), decompress(record));
+        }
+        catch (const std::exception&)
+        {
+            // the error will be reported when the file is opened
+        }
+    }
 }
 
 BsaVersion CompressedBSAFile::detectVersion(std::string filePath)
@@ -407,7 +560,7 @@ void CompressedBSAFile::convertCompressedSizesToUncompressed()
             continue;
         }
 
-        Files::IStreamPtr dataBegin = Files::openConstrainedFileStream(mFilename.c_str(), fileRecord.offset, fileRecord.getSizeWithoutCompressionFlag());
+        Files::IStreamPtr dataBegin = openStream(fileRecord.offset, fileRecord.getSizeWithoutCompressionFlag());
 
         if (mEmbeddedFileNames)
         {
@@ -26,6 +26,8 @@
 #ifndef BSA_COMPRESSED_BSA_FILE_H
 #define BSA_COMPRESSED_BSA_FILE_H
 
+#include <memory>
+
 #include <components/bsa/bsa_file.hpp>
 
 namespace Bsa
@@ -80,6 +82,16 @@ namespace Bsa
         /// \brief Normalizes given filename or folder and generates format-compatible hash. See https://en.uesp.net/wiki/Tes4Mod:Hash_Calculation.
         std::uint64_t generateHash(std::string stem, std::string extension) const;
         Files::IStreamPtr getFile(const FileRecord& fileRecord);
+
+        typedef std::shared_ptr<const std::vector<char> > DecompressedData;
+
+        /// Inflate a compressed file record.
+        /// @note Thread safe.
+        DecompressedData decompress(const FileRecord& fileRecord) const;
+
+        /// Get a compressed file record from the cache of recently used files, or decompress and cache it.
+        /// @note Thread safe.
+        DecompressedData getDecompressed(const FileRecord& fileRecord);
     public:
         CompressedBSAFile();
         virtual ~CompressedBSAFile();
@@ -92,7 +104,10 @@ namespace Bsa
        
         Files::IStreamPtr getFile(const char* filePath);
         Files::IStreamPtr getFile(const FileStruct* fileStruct);
-        
+
+        /// Decompress the given files in the order they are stored and keep them in the cache of recently used files.
+        void prefetch(const std::vector<const FileStruct*>& files) override;
+
     };
 }
 
@@ -2,6 +2,58 @@
 
 #include <stdexcept>
 
+namespace
+{
+    /// A record that was read into memory, reporting positions as offsets in the file it was read from.
+    class RecordStreamBuf : public std::streambuf
+    {
+    public:
+        RecordStreamBuf(std::vector<char>&& data, size_t fileOffset)
+            : mData(std::move(data))
+            , mFileOffset(fileOffset)
+        {
+            setg(mData.data(), mData.data(), mData.data() + mData.size());
+        }
+
+    protected:
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+        {
+            off_type pos = off;
+            if (dir == std::ios_base::beg)
+                pos -= mFileOffset;
+            else if (dir == std::ios_base::cur)
+                pos += gptr() - eback();
+            else
+                pos += mData.size();
+
+            if (pos < 0 || pos > static_cast<off_type>(mData.size()))
+                return pos_type(off_type(-1));
+
+            setg(eback(), eback() + pos, egptr());
+            return pos_type(mFileOffset + pos);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+        {
+            return seekoff(off_type(pos), std::ios_base::beg, which);
+        }
+
+    private:
+        std::vector<char> mData;
+        size_t mFileOffset;
+    };
+
+    class RecordStream : private RecordStreamBuf, public std::istream
+    {
+    public:
+        RecordStream(std::vector<char>&& data, size_t fileOffset)
+            : RecordStreamBuf(std::move(data), fileOffset)
+            , std::istream(static_cast<std::streambuf*>(this))
+        {
+        }
+    };
+}
+
 namespace ESM
 {
 
@@ -36,6 +88,13 @@ int ESMReader::getFormat() const
 
 void ESMReader::restoreContext(const ESM_Context &rc)
 {
+    // Continue with the file itself if the previous record was read into memory
+    if (mFileStream)
+    {
+        mEsm = mFileStream;
+        mFileStream.reset();
+    }
+
     // Reopen the file if necessary
     if (mCtx.filename != rc.filename)
         openRaw(rc.filename);
@@ -47,9 +106,22 @@ void ESMReader::restoreContext(const ESM_Context &rc)
     mEsm->seekg(mCtx.filePos);
 }
 
+void ESMReader::restoreRecordContext(const ESM_Context &rc)
+{
+    restoreContext(rc);
+
+    std::vector<char> data(mCtx.leftRec);
+    if (!data.empty())
+        getExact(data.data(), static_cast<int>(data.size()));
+
+    mFileStream = mEsm;
+    mEsm = std::make_shared<RecordStream>(std::move(data), mCtx.filePos);
+}
+
 void ESMReader::close()
 {
     mEsm.reset();
+    mFileStream.reset();
     clearCtx();
     mHeader.blank();
 }
@@ -55,6 +55,12 @@ public:
   /** Restore a previously saved context */
   void restoreContext(const ESM_Context &rc);
 
+  /** Restore a previously saved context and read the rest of its record into memory
+      at once, so that it is parsed without further seeks and small reads from the file.
+      Reading beyond the end of the record fails until another context is restored.
+   */
+  void restoreRecordContext(const ESM_Context &rc);
+
   /** Close the file, resets all information. After calling close()
       the structure may be reused to load a new file.
   */
@@ -274,6 +280,9 @@ private:
 
   Files::IStreamPtr mEsm;
 
+  // The file while mEsm reads a record from memory, see restoreRecordContext()
+  Files::IStreamPtr mFileStream;
+
   ESM_Context mCtx;
 
   unsigned int mRecordFlags;
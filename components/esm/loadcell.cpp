@@ -207,6 +207,11 @@ namespace ESM
         esm.restoreContext(mContextList.at (iCtx));
     }
 
+    void Cell::restoreRefs(ESMReader &esm, int iCtx) const
+    {
+        esm.restoreRecordContext(mContextList.at (iCtx));
+    }
+
     std::string Cell::getDescription() const
     {
         if (mData.mFlags & Interior)
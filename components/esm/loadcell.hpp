@@ -171,6 +171,11 @@ struct Cell
   // exactly.
   void restore(ESMReader &esm, int iCtx) const;
 
+  // Like restore(), but reads the remaining references of this cell in the
+  // given file into memory at once. Only getNextRef() and friends may be used
+  // until the reader is restored to another position.
+  void restoreRefs(ESMReader &esm, int iCtx) const;
+
   std::string getDescription() const;
   ///< Return a short string describing the cell (mostly used for debugging/logging purpose)
 
@@ -0,0 +1,230 @@
+#include "chunkcache.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <components/debug/debuglog.hpp>
+#include <components/files/cachefile.hpp>
+#include <components/misc/constants.hpp>
+
+namespace
+{
+    const char sMagic[4] = { 'O', 'M', 'W', 'T' };
+    const std::uint32_t sVersion = 2;
+
+    class Writer
+    {
+    public:
+        Writer()
+        {
+            mData.append(sMagic, sizeof(sMagic));
+            write(sVersion);
+        }
+
+        template <class T>
+        void write(const T& value)
+        {
+            mData.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void write(const void* data, std::size_t size)
+        {
+            mData.append(static_cast<const char*>(data), size);
+        }
+
+        const std::string& getData() const { return mData; }
+
+    private:
+        std::string mData;
+    };
+
+    class Reader
+    {
+    public:
+        Reader(const std::string& data)
+            : mData(data)
+            , mPos(0)
+        {
+            char magic[sizeof(sMagic)];
+            std::uint32_t version = 0;
+            mValid = read(magic, sizeof(magic)) && std::memcmp(magic, sMagic, sizeof(sMagic)) == 0
+                    && read(version) && version == sVersion;
+        }
+
+        template <class T>
+        bool read(T& value)
+        {
+            return read(&value, sizeof(T));
+        }
+
+        bool read(void* data, std::size_t size)
+        {
+            if (mPos + size > mData.size())
+                return mValid = false;
+            std::memcpy(data, mData.data() + mPos, size);
+            mPos += size;
+            return true;
+        }
+
+        bool isValid() const { return mValid; }
+
+        bool atEnd() const { return mPos == mData.size(); }
+
+    private:
+        const std::string& mData;
+        std::size_t mPos;
+        bool mValid;
+    };
+}
+
+namespace ESMTerrain
+{
+
+    ChunkCache::ChunkCache(const std::string& path)
+        : mPath(path)
+    {
+        try
+        {
+            boost::filesystem::create_directories(mPath);
+        }
+        catch (const std::exception& e)
+        {
+            Log(Debug::Warning) << "Warning: Failed to create terrain cache directory " << mPath << ": " << e.what();
+        }
+    }
+
+    bool ChunkCache::readVertices(int lodLevel, float size, const osg::Vec2f& center,
+                                  osg::Vec3Array& positions, osg::Vec3Array& normals, osg::Vec4ubArray& colours) const
+    {
+        std::string data;
+        if (!Files::readCacheFile(getFileName("v", size, center, lodLevel), data))
+            return false;
+
+        Reader reader(data);
+        std::uint32_t numVerts = 0;
+        if (!reader.isValid() || !reader.read(numVerts))
+            return false;
+
+        std::size_t vertexCount = static_cast<std::size_t>(numVerts) * numVerts;
+        if (vertexCount > data.size())
+            return false;
+        std::vector<float> heights(vertexCount);
+        if (vertexCount == 0 || !reader.read(heights.data(), heights.size() * sizeof(float)))
+            return false;
+
+        normals.resize(vertexCount);
+        if (!reader.read(&normals.front(), vertexCount * sizeof(osg::Vec3f)))
+            return false;
+
+        colours.resize(vertexCount);
+        if (!reader.read(&colours.front(), vertexCount * sizeof(osg::Vec4ub)) || !reader.atEnd())
+            return false;
+
+        positions.resize(vertexCount);
+        for (std::uint32_t vertX = 0; vertX < numVerts; ++vertX)
+        {
+            for (std::uint32_t vertY = 0; vertY < numVerts; ++vertY)
+            {
+                std::size_t index = vertX * numVerts + vertY;
+                // Same as in Storage::fillVertexBuffers, the x and y coordinates are implied by the grid
+                positions[index] = osg::Vec3f((vertX / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits,
+                                              (vertY / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits,
+                                              heights[index]);
+            }
+        }
+        return true;
+    }
+
+    void ChunkCache::writeVertices(int lodLevel, float size, const osg::Vec2f& center,
+                                   const osg::Vec3Array& positions, const osg::Vec3Array& normals, const osg::Vec4ubArray& colours) const
+    {
+        std::uint32_t numVerts = static_cast<std::uint32_t>(std::sqrt(positions.size()) + 0.5);
+        if (positions.empty() || numVerts * numVerts != positions.size()
+                || normals.size() != positions.size() || colours.size() != positions.size())
+            return;
+
+        Writer writer;
+        writer.write(numVerts);
+        for (const osg::Vec3f& position : positions)
+            writer.write(position.z());
+        writer.write(&normals.front(), normals.size() * sizeof(osg::Vec3f));
+        writer.write(&colours.front(), colours.size() * sizeof(osg::Vec4ub));
+
+        Files::writeCacheFile(getFileName("v", size, center, lodLevel), writer.getData());
+    }
+
+    bool ChunkCache::readBlendmaps(float size, const osg::Vec2f& center, ImageVector& blendmaps, TextureIdList& textureIds) const
+    {
+        std::string data;
+        if (!Files::readCacheFile(getFileName("b", size, center, 0), data))
+            return false;
+
+        Reader reader(data);
+        std::uint32_t numLayers = 0;
+        std::uint32_t numBlendmaps = 0;
+        if (!reader.isValid() || !reader.read(numLayers) || !reader.read(numBlendmaps))
+            return false;
+
+        TextureIdList ids;
+        for (std::uint32_t i=0; i<numLayers; ++i)
+        {
+            std::pair<short, short> id;
+            if (!reader.read(id.first) || !reader.read(id.second))
+                return false;
+            ids.push_back(id);
+        }
+
+        ImageVector images;
+        for (std::uint32_t i=0; i<numBlendmaps; ++i)
+        {
+            std::uint32_t width = 0;
+            std::uint32_t height = 0;
+            if (!reader.read(width) || !reader.read(height) || width == 0 || height == 0)
+                return false;
+            osg::ref_ptr<osg::Image> image (new osg::Image);
+            image->allocateImage(width, height, 1, GL_ALPHA, GL_UNSIGNED_BYTE);
+            if (!reader.read(image->data(), image->getTotalDataSize()))
+                return false;
+            images.push_back(image);
+        }
+
+        if (!reader.atEnd())
+            return false;
+
+        blendmaps.insert(blendmaps.end(), images.begin(), images.end());
+        textureIds.swap(ids);
+        return true;
+    }
+
+    void ChunkCache::writeBlendmaps(float size, const osg::Vec2f& center, const ImageVector& blendmaps, const TextureIdList& textureIds) const
+    {
+        Writer writer;
+        writer.write(static_cast<std::uint32_t>(textureIds.size()));
+        writer.write(static_cast<std::uint32_t>(blendmaps.size()));
+        for (const auto& id : textureIds)
+        {
+            writer.write(id.first);
+            writer.write(id.second);
+        }
+        for (const osg::ref_ptr<osg::Image>& image : blendmaps)
+        {
+            writer.write(static_cast<std::uint32_t>(image->s()));
+            writer.write(static_cast<std::uint32_t>(image->t()));
+            writer.write(image->data(), image->getTotalDataSize());
+        }
+
+        Files::writeCacheFile(getFileName("b", size, center, 0), writer.getData());
+    }
+
+    std::string ChunkCache::getFileName(const std::string& prefix, float size, const osg::Vec2f& center, int lodLevel) const
+    {
+        std::ostringstream stream;
+        stream << prefix << "_" << center.x() << "_" << center.y() << "_" << size << "_" << lodLevel << ".bin";
+        return (boost::filesystem::path(mPath) / stream.str()).string();
+    }
+
+}
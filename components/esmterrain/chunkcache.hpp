@@ -0,0 +1,52 @@
+#ifndef COMPONENTS_ESM_TERRAIN_CHUNKCACHE_H
+#define COMPONENTS_ESM_TERRAIN_CHUNKCACHE_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osg/Array>
+#include <osg/Image>
+#include <osg/ref_ptr>
+#include <osg/Vec2f>
+
+namespace ESMTerrain
+{
+
+    /// @brief Stores baked terrain chunk data on disk, so that a chunk only has to be computed from the land records once.
+    /// @note Only heights are stored for positions, the rest of the vertex data is stored as it is, so that
+    ///       cached chunks look exactly like newly computed ones.
+    /// @note The cached data is only valid as long as the land data stays the same, so the cache directory
+    ///       should be unique to the set of loaded content files.
+    /// @note Thread safe.
+    class ChunkCache
+    {
+    public:
+        // pair <texture id, plugin id>, see Storage::UniqueTextureId
+        typedef std::vector<std::pair<short, short> > TextureIdList;
+        typedef std::vector<osg::ref_ptr<osg::Image> > ImageVector;
+
+        ChunkCache(const std::string& path);
+
+        /// @return true if cached vertex data was found and written to the buffers
+        bool readVertices(int lodLevel, float size, const osg::Vec2f& center,
+                          osg::Vec3Array& positions, osg::Vec3Array& normals, osg::Vec4ubArray& colours) const;
+
+        void writeVertices(int lodLevel, float size, const osg::Vec2f& center,
+                           const osg::Vec3Array& positions, const osg::Vec3Array& normals, const osg::Vec4ubArray& colours) const;
+
+        /// @return true if cached blendmaps were found
+        /// @param textureIds texture ids of each layer will be written here
+        bool readBlendmaps(float size, const osg::Vec2f& center, ImageVector& blendmaps, TextureIdList& textureIds) const;
+
+        void writeBlendmaps(float size, const osg::Vec2f& center, const ImageVector& blendmaps, const TextureIdList& textureIds) const;
+
+    private:
+        std::string getFileName(const std::string& prefix, float size, const osg::Vec2f& center, int lodLevel) const;
+
+        std::string mPath;
+    };
+
+}
+
+#endif
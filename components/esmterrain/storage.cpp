@@ -10,6 +10,8 @@
 #include <components/misc/stringops.hpp>
 #include <components/vfs/manager.hpp>
 
+#include "chunkcache.hpp"
+
 namespace ESMTerrain
 {
 
@@ -55,6 +57,18 @@ namespace ESMTerrain
     {
     }
 
+    Storage::~Storage()
+    {
+    }
+
+    void Storage::setCachePath(const std::string& path)
+    {
+        if (path.empty())
+            mChunkCache.reset();
+        else
+            mChunkCache.reset(new ChunkCache(path));
+    }
+
     bool Storage::getMinMaxHeights(float size, const osg::Vec2f &center, float &min, float &max)
     {
         assert (size <= 1 && "Storage::getMinMaxHeights, chunk size should be <= 1 cell");
@@ -186,6 +200,10 @@ namespace ESMTerrain
 
         size_t numVerts = static_cast<size_t>(size*(ESM::Land::LAND_SIZE - 1) / increment + 1);
 
+        if (mChunkCache && mChunkCache->readVertices(lodLevel, size, center, *positions, *normals, *colours)
+                && positions->size() == numVerts*numVerts)
+            return;
+
         positions->resize(numVerts*numVerts);
         normals->resize(numVerts*numVerts);
         colours->resize(numVerts*numVerts);
@@ -233,78 +251,102 @@ namespace ESMTerrain
                 int rowEnd = std::min(static_cast<int>(rowStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1), static_cast<int>(ESM::Land::LAND_SIZE));
                 int colEnd = std::min(static_cast<int>(colStart + std::min(1.f, size) * (ESM::Land::LAND_SIZE-1) + 1), static_cast<int>(ESM::Land::LAND_SIZE));
 
+                const int lastVert = ESM::Land::LAND_SIZE-1;
+
+                // Fill whole rows of vertices at once, working on the raw land data.
+                // Vertices at cell edges are fixed up in a separate pass below.
                 vertY = vertY_;
                 for (int col=colStart; col<colEnd; col += increment)
                 {
+                    assert(col >= 0 && col < ESM::Land::LAND_SIZE);
+                    assert (vertY < numVerts);
+
+                    const float* srcHeights = heightData ? &heightData->mHeights[col*ESM::Land::LAND_SIZE] : nullptr;
+                    const ESM::Land::VNML* srcNormals = normalData ? &normalData->mNormals[col*ESM::Land::LAND_SIZE*3] : nullptr;
+                    const unsigned char* srcColours = colourData ? &colourData->mColours[col*ESM::Land::LAND_SIZE*3] : nullptr;
+
+                    const float posY = (vertY / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits;
+                    size_t vertIndex = static_cast<size_t>(vertX_*numVerts + vertY);
+
                     vertX = vertX_;
-                    for (int row=rowStart; row<rowEnd; row += increment)
+                    for (int row=rowStart; row<rowEnd; row += increment, vertIndex += numVerts)
                     {
-                        int srcArrayIndex = col*ESM::Land::LAND_SIZE*3+row*3;
-
                         assert(row >= 0 && row < ESM::Land::LAND_SIZE);
-                        assert(col >= 0 && col < ESM::Land::LAND_SIZE);
-
                         assert (vertX < numVerts);
-                        assert (vertY < numVerts);
 
-                        float height = defaultHeight;
-                        if (heightData)
-                            height = heightData->mHeights[col*ESM::Land::LAND_SIZE + row];
+                        float height = srcHeights ? srcHeights[row] : defaultHeight;
                         if (alteration)
                             height += getAlteredHeight(col, row);
-                        (*positions)[static_cast<unsigned int>(vertX*numVerts + vertY)]
-                            = osg::Vec3f((vertX / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits,
-                                         (vertY / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits,
-                                         height);
+                        (*positions)[vertIndex] = osg::Vec3f((vertX / float(numVerts - 1) - 0.5f) * size * Constants::CellSizeInUnits, posY, height);
 
-                        if (normalData)
+                        if (srcNormals)
                         {
-                            for (int i=0; i<3; ++i)
-                                normal[i] = normalData->mNormals[srcArrayIndex+i];
-
+                            normal.set(srcNormals[row*3], srcNormals[row*3+1], srcNormals[row*3+2]);
                             normal.normalize();
                         }
                         else
                             normal = osg::Vec3f(0,0,1);
+                        (*normals)[vertIndex] = normal;
 
-                        // Normals apparently don't connect seamlessly between cells
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixNormal(normal, cellX, cellY, col, row, cache);
-
-                        // some corner normals appear to be complete garbage (z < 0)
-                        if ((row == 0 || row == ESM::Land::LAND_SIZE-1) && (col == 0 || col == ESM::Land::LAND_SIZE-1))
-                            averageNormal(normal, cellX, cellY, col, row, cache);
-
-                        assert(normal.z() > 0);
-
-                        (*normals)[static_cast<unsigned int>(vertX*numVerts + vertY)] = normal;
-
-                        if (colourData)
-                        {
-                            for (int i=0; i<3; ++i)
-                                color[i] = colourData->mColours[srcArrayIndex+i];
-                        }
+                        if (srcColours)
+                            color.set(srcColours[row*3], srcColours[row*3+1], srcColours[row*3+2], 255);
                         else
-                        {
-                            color.r() = 255;
-                            color.g() = 255;
-                            color.b() = 255;
-                        }
+                            color.set(255, 255, 255, 255);
                         if (alteration)
+                        {
                             adjustColor(col, row, heightData, color); //Does nothing by default, override in OpenMW-CS
+                            color.a() = 255;
+                        }
+                        (*colours)[vertIndex] = color;
+
+                        ++vertX;
+                    }
+                    ++vertY;
+                }
+
+                // Fix up the vertices at the cell edges. Only the last row / column and the corners are affected.
+                const bool hasFirstRow = rowStart == 0;
+                const bool hasLastRow = lastVert < rowEnd && (lastVert - rowStart) % increment == 0;
+                const bool hasFirstCol = colStart == 0;
+                const bool hasLastCol = lastVert < colEnd && (lastVert - colStart) % increment == 0;
+                const size_t firstVertX = static_cast<size_t>(vertX_);
+                const size_t firstVertY = static_cast<size_t>(vertY_);
+                auto fixVertex = [&] (int col, int row)
+                {
+                    size_t vertIndex = (firstVertX + (row - rowStart) / increment) * numVerts + firstVertY + (col - colStart) / increment;
 
-                        // Unlike normals, colors mostly connect seamlessly between cells, but not always...
-                        if (col == ESM::Land::LAND_SIZE-1 || row == ESM::Land::LAND_SIZE-1)
-                            fixColour(color, cellX, cellY, col, row, cache);
+                    // Normals apparently don't connect seamlessly between cells
+                    osg::Vec3f& vertNormal = (*normals)[vertIndex];
+                    if (col == lastVert || row == lastVert)
+                        fixNormal(vertNormal, cellX, cellY, col, row, cache);
 
-                        color.a() = 255;
+                    // some corner normals appear to be complete garbage (z < 0)
+                    if ((row == 0 || row == lastVert) && (col == 0 || col == lastVert))
+                        averageNormal(vertNormal, cellX, cellY, col, row, cache);
 
-                        (*colours)[static_cast<unsigned int>(vertX*numVerts + vertY)] = color;
+                    assert(vertNormal.z() > 0);
 
-                        ++vertX;
+                    // Unlike normals, colors mostly connect seamlessly between cells, but not always...
+                    if (col == lastVert || row == lastVert)
+                        fixColour((*colours)[vertIndex], cellX, cellY, col, row, cache);
+                };
+
+                if (hasLastRow)
+                {
+                    for (int col=colStart; col<colEnd; col += increment)
+                        fixVertex(col, lastVert);
+                }
+                if (hasLastCol)
+                {
+                    for (int row=rowStart; row<rowEnd; row += increment)
+                    {
+                        if (row != lastVert)
+                            fixVertex(lastVert, row);
                     }
-                    ++vertY;
                 }
+                if (hasFirstRow && hasFirstCol)
+                    fixVertex(0, 0);
+
                 vertX_ = vertX;
             }
             vertY_ = vertY;
@@ -312,6 +354,9 @@ namespace ESMTerrain
             assert(vertX_ == numVerts); // Ensure we covered whole area
         }
         assert(vertY_ == numVerts);  // Ensure we covered whole area
+
+        if (mChunkCache)
+            mChunkCache->writeVertices(lodLevel, size, center, *positions, *normals, *colours);
     }
 
     Storage::UniqueTextureId Storage::getVtexIndexAt(int cellX, int cellY,
@@ -374,6 +419,14 @@ namespace ESMTerrain
 
     void Storage::getBlendmaps(float chunkSize, const osg::Vec2f &chunkCenter, ImageVector &blendmaps, std::vector<Terrain::LayerInfo> &layerList)
     {
+        ChunkCache::TextureIdList layerIds;
+        if (mChunkCache && mChunkCache->readBlendmaps(chunkSize, chunkCenter, blendmaps, layerIds))
+        {
+            for (const UniqueTextureId& id : layerIds)
+                layerList.push_back(getLayerInfo(getTextureName(id)));
+            return;
+        }
+
         osg::Vec2f origin = chunkCenter - osg::Vec2f(chunkSize/2.f, chunkSize/2.f);
         int cellX = static_cast<int>(std::floor(origin.x()));
         int cellY = static_cast<int>(std::floor(origin.y()));
@@ -422,6 +475,7 @@ namespace ESMTerrain
                         memset(pData, 0, image->getTotalDataSize());
                         blendmaps.emplace_back(image);
                         layerList.emplace_back(info);
+                        layerIds.emplace_back(id);
                     }
                 }
                 unsigned int layerIndex = found->second;
@@ -437,6 +491,9 @@ namespace ESMTerrain
 
         if (blendmaps.size() == 1)
             blendmaps.clear(); // If a single texture fills the whole terrain, there is no need to blend
+
+        if (mChunkCache)
+            mChunkCache->writeBlendmaps(chunkSize, chunkCenter, blendmaps, layerIds);
     }
 
     float Storage::getHeightAt(const osg::Vec3f &worldPos)
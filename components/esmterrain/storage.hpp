@@ -2,6 +2,7 @@
 #define COMPONENTS_ESM_TERRAIN_STORAGE_H
 
 #include <cassert>
+#include <memory>
 #include <mutex>
 
 #include <components/terrain/storage.hpp>
@@ -18,6 +19,7 @@ namespace ESMTerrain
 {
 
     class LandCache;
+    class ChunkCache;
 
     /// @brief Wrapper around Land Data with reference counting. The wrapper needs to be held as long as the data is still in use
     class LandObject : public osg::Object
@@ -55,6 +57,12 @@ namespace ESMTerrain
     {
     public:
         Storage(const VFS::Manager* vfs, const std::string& normalMapPattern = "", const std::string& normalHeightMapPattern = "", bool autoUseNormalMaps = false, const std::string& specularMapPattern = "", bool autoUseSpecularMaps = false);
+        virtual ~Storage();
+
+        /// Bake vertex data and blendmaps of created chunks into the given directory and reuse them from there.
+        /// @note Only use if the land data can not change, the path should be unique to the set of loaded content files.
+        /// @note Not thread safe, call before creating any chunks.
+        void setCachePath(const std::string& path);
 
         // Not implemented in this class, because we need different Store implementations for game and editor
         virtual osg::ref_ptr<const LandObject> getLand (int cellX, int cellY)= 0;
@@ -147,6 +155,8 @@ namespace ESMTerrain
         bool mAutoUseSpecularMaps;
 
         Terrain::LayerInfo getLayerInfo(const std::string& texture);
+
+        std::unique_ptr<ChunkCache> mChunkCache;
     };
 
 }
@@ -0,0 +1,49 @@
+#include "cachefile.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/debug/debuglog.hpp>
+
+namespace Files
+{
+    bool readCacheFile(const boost::filesystem::path& path, std::string& data)
+    {
+        boost::filesystem::ifstream stream(path, std::ios::binary);
+        if (!stream.is_open())
+            return false;
+        std::ostringstream buffer;
+        buffer << stream.rdbuf();
+        if (stream.bad())
+            return false;
+        data = buffer.str();
+        return true;
+    }
+
+    void writeCacheFile(const boost::filesystem::path& path, const std::string& data)
+    {
+        std::ostringstream tempName;
+        tempName << path.string() << "." << std::this_thread::get_id() << ".tmp";
+        const boost::filesystem::path tempPath = tempName.str();
+        try
+        {
+            {
+                boost::filesystem::ofstream stream(tempPath, std::ios::binary | std::ios::trunc);
+                stream.write(data.data(), data.size());
+                if (!stream.good())
+                    throw std::runtime_error("write failed");
+            }
+            boost::filesystem::rename(tempPath, path);
+        }
+        catch (const std::exception& e)
+        {
+            Log(Debug::Warning) << "Warning: Failed to write cache file " << path.string() << ": " << e.what();
+            boost::system::error_code ec;
+            boost::filesystem::remove(tempPath, ec);
+        }
+    }
+}
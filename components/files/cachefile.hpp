@@ -0,0 +1,20 @@
+#ifndef COMPONENTS_FILES_CACHEFILE_HPP
+#define COMPONENTS_FILES_CACHEFILE_HPP
+
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+namespace Files
+{
+    /// Read the whole contents of a file in a cache directory.
+    /// @return false if the file does not exist or could not be read
+    bool readCacheFile(const boost::filesystem::path& path, std::string& data);
+
+    /// Write a file to a cache directory. The data is written to a temporary file first and moved into place afterwards,
+    /// so several threads may write the same file at once and readers never see a partially written file.
+    /// @note Errors are only logged, since a missing cache file just means that the data has to be computed again.
+    void writeCacheFile(const boost::filesystem::path& path, const std::string& data);
+}
+
+#endif
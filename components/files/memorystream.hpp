@@ -2,6 +2,7 @@
 #define OPENMW_COMPONENTS_FILES_MEMORYSTREAM_H
 
 #include <istream>
+#include <memory>
 
 namespace Files
 {
@@ -36,6 +37,16 @@ namespace Files
         char* bufferEnd;
     };
 
+    /// @brief Read-only bytes of a file that are already in memory, e.g. in a memory mapped archive.
+    struct MemoryView
+    {
+        const char* mData = nullptr;
+        size_t mSize = 0;
+
+        /// Keeps the memory valid for as long as the view or a copy of it exists.
+        std::shared_ptr<const void> mOwner;
+    };
+
     /// @brief A variant of std::istream that reads from a constant in-memory buffer.
     struct IMemStream: virtual MemBuf, std::istream
     {
@@ -46,6 +57,27 @@ namespace Files
         }
     };
 
+    struct MemoryViewHolder
+    {
+        MemoryViewHolder(const MemoryView& view)
+            : mView(view)
+        {
+        }
+
+        MemoryView mView;
+    };
+
+    /// @brief An IMemStream over a MemoryView that keeps the viewed memory alive while the stream exists.
+    struct IMemViewStream : MemoryViewHolder, IMemStream
+    {
+        IMemViewStream(const MemoryView& view)
+            : MemBuf(view.mData, view.mSize)
+            , MemoryViewHolder(view)
+            , IMemStream(view.mData, view.mSize)
+        {
+        }
+    };
+
 }
 
 #endif
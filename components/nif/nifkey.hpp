@@ -5,8 +5,9 @@
 
 #include "nifstream.hpp"
 
+#include <algorithm>
 #include <sstream>
-#include <map>
+#include <vector>
 
 #include "niffile.hpp"
 
@@ -36,6 +37,13 @@ struct KeyT {
     float mContinuity; // Only for TBC interpolation
     */
 };
+
+// Quaternion keys are never interpolated with tangents, so don't store them
+template<>
+struct KeyT<osg::Quat> {
+    osg::Quat mValue;
+};
+
 using FloatKey = KeyT<float>;
 using Vector3Key = KeyT<osg::Vec3f>;
 using Vector4Key = KeyT<osg::Vec4f>;
@@ -43,7 +51,8 @@ using QuaternionKey = KeyT<osg::Quat>;
 
 template<typename T, T (NIFStream::*getValue)()>
 struct KeyMapT {
-    using MapType = std::map<float, KeyT<T>>;
+    // <time, key>, sorted by time with at most one key per time
+    using MapType = std::vector<std::pair<float, KeyT<T>>>;
 
     using ValueType = T;
     using KeyType = KeyT<T>;
@@ -76,7 +85,7 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readValue(nifReference, key);
-                mKeys[time] = key;
+                mKeys.emplace_back(time, key);
             }
         }
         else if (mInterpolationType == InterpolationType_Quadratic)
@@ -85,7 +94,7 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readQuadratic(nifReference, key);
-                mKeys[time] = key;
+                mKeys.emplace_back(time, key);
             }
         }
         else if (mInterpolationType == InterpolationType_TBC)
@@ -94,7 +103,7 @@ struct KeyMapT {
             {
                 float time = nif->getFloat();
                 readTBC(nifReference, key);
-                mKeys[time] = key;
+                mKeys.emplace_back(time, key);
             }
         }
         //XYZ keys aren't actually read here.
@@ -124,9 +133,33 @@ struct KeyMapT {
             error << "Unhandled interpolation type: " << mInterpolationType;
             nif->file->fail(error.str());
         }
+
+        sortKeys();
     }
 
 private:
+    // Keys are normally stored in order already. If they are not, sort them and let the last key win
+    // when several keys have the same time.
+    void sortKeys()
+    {
+        const auto notIncreasing = [] (const std::pair<float, KeyT<T>>& left, const std::pair<float, KeyT<T>>& right) { return left.first >= right.first; };
+        if (std::adjacent_find(mKeys.begin(), mKeys.end(), notIncreasing) == mKeys.end())
+            return;
+
+        std::stable_sort(mKeys.begin(), mKeys.end(),
+            [] (const std::pair<float, KeyT<T>>& left, const std::pair<float, KeyT<T>>& right) { return left.first < right.first; });
+
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < mKeys.size(); ++i)
+        {
+            if (count > 0 && mKeys[count-1].first == mKeys[i].first)
+                mKeys[count-1] = mKeys[i];
+            else
+                mKeys[count++] = mKeys[i];
+        }
+        mKeys.resize(count);
+    }
+
     static void readValue(NIFStream &nif, KeyT<T> &key)
     {
         key.mValue = (nif.*getValue)();
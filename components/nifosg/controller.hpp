@@ -9,6 +9,7 @@
 #include <components/sceneutil/controller.hpp>
 #include <components/sceneutil/statesetupdater.hpp>
 
+#include <algorithm>
 #include <set>
 
 #include <osg/Texture2D>
@@ -35,23 +36,24 @@ namespace NifOsg
     template <typename MapT>
     class ValueInterpolator
     {
-        typename MapT::MapType::const_iterator retrieveKey(float time) const
+        std::size_t retrieveKey(float time) const
         {
-            // retrieve the current position in the map, optimized for the most common case
+            // retrieve the current position in the track, optimized for the most common case
             // where time moves linearly along the keyframe track
-            if (mLastHighKey != mKeys->mKeys.end())
+            const typename MapT::MapType & keys = mKeys->mKeys;
+            if (mLastHighKey > 0 && mLastHighKey < keys.size())
             {
-                if (time > mLastHighKey->first)
+                if (time > keys[mLastHighKey].first)
                 {
                     // try if we're there by incrementing one
-                    ++mLastLowKey;
                     ++mLastHighKey;
                 }
-                if (mLastHighKey != mKeys->mKeys.end() && time >= mLastLowKey->first && time <= mLastHighKey->first)
+                if (mLastHighKey < keys.size() && time >= keys[mLastHighKey-1].first && time <= keys[mLastHighKey].first)
                     return mLastHighKey;
             }
 
-            return mKeys->mKeys.lower_bound(time);
+            return std::lower_bound(keys.begin(), keys.end(), time,
+                [] (const typename MapT::MapType::value_type& key, float value) { return key.first < value; }) - keys.begin();
         }
 
     public:
@@ -63,11 +65,6 @@ namespace NifOsg
             : mKeys(keys)
             , mDefaultVal(defaultVal)
         {
-            if (keys)
-            {
-                mLastLowKey = mKeys->mKeys.end();
-                mLastHighKey = mKeys->mKeys.end();
-            }
         }
 
         ValueT interpKey(float time) const
@@ -77,24 +74,26 @@ namespace NifOsg
 
             const typename MapT::MapType & keys = mKeys->mKeys;
 
-            if(time <= keys.begin()->first)
-                return keys.begin()->second.mValue;
+            if(time <= keys.front().first)
+                return keys.front().second.mValue;
 
-            typename MapT::MapType::const_iterator it = retrieveKey(time);
+            // the first key is never returned here, the time is past it
+            std::size_t highKey = retrieveKey(time);
 
             // now do the actual interpolation
-            if (it != keys.end())
+            if (highKey < keys.size())
             {
                 // cache for next time
-                mLastHighKey = it;
-                mLastLowKey = --it;
+                mLastHighKey = highKey;
 
-                float a = (time - mLastLowKey->first) / (mLastHighKey->first - mLastLowKey->first);
+                const typename MapT::MapType::value_type& low = keys[highKey-1];
+                const typename MapT::MapType::value_type& high = keys[highKey];
+                float a = (time - low.first) / (high.first - low.first);
 
-                return interpolate(mLastLowKey->second, mLastHighKey->second, a, mKeys->mInterpolationType);
+                return interpolate(low.second, high.second, a, mKeys->mInterpolationType);
             }
 
-            return keys.rbegin()->second.mValue;
+            return keys.back().second.mValue;
         }
 
         bool empty() const
@@ -148,8 +147,8 @@ namespace NifOsg
             }
         }
 
-        mutable typename MapT::MapType::const_iterator mLastLowKey;
-        mutable typename MapT::MapType::const_iterator mLastHighKey;
+        // index of the key after the current time, the previous key is the one before it
+        mutable std::size_t mLastHighKey = 0;
 
         std::shared_ptr<const MapT> mKeys;
 
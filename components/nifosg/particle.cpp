@@ -13,6 +13,24 @@
 
 #include "nodeindexholder.hpp"
 
+namespace
+{
+    // Force scale of GravityAffector, shared by its per-particle and batched paths
+    const float sGravityMagic = 1.6f;
+
+    // Operators loop over the particles themselves, which avoids a virtual call per particle
+    template <class Function>
+    void forEachAliveParticle(osgParticle::ParticleSystem* ps, Function function)
+    {
+        for (int i = 0, n = ps->numParticles(); i < n; ++i)
+        {
+            osgParticle::Particle* particle = ps->getParticle(i);
+            if (particle->isAlive())
+                function(particle);
+        }
+    }
+}
+
 namespace NifOsg
 {
 
@@ -166,6 +184,24 @@ void GrowFadeAffector::operate(osgParticle::Particle* particle, double /* dt */)
     particle->setSizeRange(osgParticle::rangef(size, size));
 }
 
+void GrowFadeAffector::operateParticles(osgParticle::ParticleSystem* ps, double dt)
+{
+    if (!isEnabled())
+        return;
+
+    const float growFactor = mGrowTime != 0.f ? mCachedDefaultSize / mGrowTime : 0.f;
+    const float fadeFactor = mFadeTime != 0.f ? 1.f / mFadeTime : 0.f;
+    forEachAliveParticle(ps, [&] (osgParticle::Particle* particle)
+    {
+        const float age = particle->getAge();
+        const float remaining = particle->getLifeTime() - age;
+        float size = age < mGrowTime ? age * growFactor : mCachedDefaultSize;
+        if (remaining < mFadeTime && mFadeTime != 0.f)
+            size *= remaining * fadeFactor;
+        particle->setSizeRange(osgParticle::rangef(size, size));
+    });
+}
+
 ParticleColorAffector::ParticleColorAffector(const Nif::NiColorData *clrdata)
     : mData(clrdata->mKeyMap, osg::Vec4f(1,1,1,1))
 {
@@ -194,6 +230,14 @@ void ParticleColorAffector::operate(osgParticle::Particle* particle, double /* d
     particle->setAlphaRange(osgParticle::rangef(alpha, alpha));
 }
 
+void ParticleColorAffector::operateParticles(osgParticle::ParticleSystem* ps, double dt)
+{
+    if (!isEnabled())
+        return;
+
+    forEachAliveParticle(ps, [&] (osgParticle::Particle* particle) { ParticleColorAffector::operate(particle, dt); });
+}
+
 GravityAffector::GravityAffector(const Nif::NiGravity *gravity)
     : mForce(gravity->mForce)
     , mType(static_cast<ForceType>(gravity->mType))
@@ -234,7 +278,6 @@ void GravityAffector::beginOperate(osgParticle::Program* program)
 
 void GravityAffector::operate(osgParticle::Particle *particle, double dt)
 {
-    const float magic = 1.6f;
     switch (mType)
     {
         case Type_Wind:
@@ -247,7 +290,7 @@ void GravityAffector::operate(osgParticle::Particle *particle, double dt)
                 decayFactor = std::exp(-1.f * mDecay * distance);
             }
 
-            particle->addVelocity(mCachedWorldDirection * mForce * dt * decayFactor * magic);
+            particle->addVelocity(mCachedWorldDirection * mForce * dt * decayFactor * sGravityMagic);
 
             break;
         }
@@ -261,12 +304,28 @@ void GravityAffector::operate(osgParticle::Particle *particle, double dt)
 
             diff.normalize();
 
-            particle->addVelocity(diff * mForce * dt * decayFactor * magic);
+            particle->addVelocity(diff * mForce * dt * decayFactor * sGravityMagic);
             break;
         }
     }
 }
 
+void GravityAffector::operateParticles(osgParticle::ParticleSystem* ps, double dt)
+{
+    if (!isEnabled())
+        return;
+
+    if (mType == Type_Wind && mDecay == 0.f)
+    {
+        // The most common case, e.g. for weather particles: the same velocity change for every particle
+        const osg::Vec3f velocity = mCachedWorldDirection * (mForce * dt * sGravityMagic);
+        forEachAliveParticle(ps, [&] (osgParticle::Particle* particle) { particle->addVelocity(velocity); });
+        return;
+    }
+
+    forEachAliveParticle(ps, [&] (osgParticle::Particle* particle) { GravityAffector::operate(particle, dt); });
+}
+
 Emitter::Emitter()
     : osgParticle::Emitter()
 {
@@ -440,6 +499,14 @@ void PlanarCollider::operate(osgParticle::Particle *particle, double dt)
     }
 }
 
+void PlanarCollider::operateParticles(osgParticle::ParticleSystem* ps, double dt)
+{
+    if (!isEnabled())
+        return;
+
+    forEachAliveParticle(ps, [&] (osgParticle::Particle* particle) { PlanarCollider::operate(particle, dt); });
+}
+
 SphericalCollider::SphericalCollider(const Nif::NiSphericalCollider* collider)
     : mBounceFactor(collider->mBounceFactor),
       mSphere(collider->mCenter, collider->mRadius)
@@ -509,4 +576,12 @@ void SphericalCollider::operate(osgParticle::Particle* particle, double dt)
     }
 }
 
+void SphericalCollider::operateParticles(osgParticle::ParticleSystem* ps, double dt)
+{
+    if (!isEnabled())
+        return;
+
+    forEachAliveParticle(ps, [&] (osgParticle::Particle* particle) { SphericalCollider::operate(particle, dt); });
+}
+
 }
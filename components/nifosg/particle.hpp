@@ -109,6 +109,7 @@ namespace NifOsg
 
         virtual void beginOperate(osgParticle::Program* program);
         virtual void operate(osgParticle::Particle* particle, double dt);
+        virtual void operateParticles(osgParticle::ParticleSystem* ps, double dt);
 
     private:
         float mBounceFactor;
@@ -127,6 +128,7 @@ namespace NifOsg
 
         virtual void beginOperate(osgParticle::Program* program);
         virtual void operate(osgParticle::Particle* particle, double dt);
+        virtual void operateParticles(osgParticle::ParticleSystem* ps, double dt);
     private:
         float mBounceFactor;
         osg::BoundingSphere mSphere;
@@ -146,6 +148,7 @@ namespace NifOsg
 
         virtual void beginOperate(osgParticle::Program* program);
         virtual void operate(osgParticle::Particle* particle, double dt);
+        virtual void operateParticles(osgParticle::ParticleSystem* ps, double dt);
 
     private:
         float mGrowTime;
@@ -166,6 +169,7 @@ namespace NifOsg
         META_Object(NifOsg, ParticleColorAffector)
 
         virtual void operate(osgParticle::Particle* particle, double dt);
+        virtual void operateParticles(osgParticle::ParticleSystem* ps, double dt);
 
     private:
         Vec4Interpolator mData;
@@ -183,6 +187,7 @@ namespace NifOsg
         META_Object(NifOsg, GravityAffector)
 
         virtual void operate(osgParticle::Particle* particle, double dt);
+        virtual void operateParticles(osgParticle::ParticleSystem* ps, double dt);
         virtual void beginOperate(osgParticle::Program *);
 
     private:
@@ -1,9 +1,17 @@
 #include "imagemanager.hpp"
 
 #include <cassert>
+#include <functional>
+#include <iterator>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osgDB/ImageProcessor>
 #include <osgDB/Registry>
 
 #include <components/debug/debuglog.hpp>
+#include <components/files/cachefile.hpp>
 #include <components/vfs/manager.hpp>
 
 #include "objectcache.hpp"
@@ -48,6 +56,8 @@ namespace Resource
         : ResourceManager(vfs)
         , mWarningImage(createWarningImage())
         , mOptions(new osgDB::Options("dds_flip dds_dxt1_detect_rgba ignoreTga2Fields"))
+        // Cached images are stored as they are in memory, so don't flip them in either direction
+        , mCompressionCacheOptions(new osgDB::Options("ddsNoAutoFlipWrite"))
     {
     }
 
@@ -81,6 +91,74 @@ namespace Resource
         return true;
     }
 
+    void ImageManager::setCompressionCachePath(const std::string& path)
+    {
+        mCompressionCachePath.clear();
+        if (path.empty())
+            return;
+
+        if (!osgDB::Registry::instance()->getImageProcessor() || !osgDB::Registry::instance()->getReaderWriterForExtension("dds"))
+        {
+            Log(Debug::Warning) << "Warning: Texture compression is not available, no image processor plugin found";
+            return;
+        }
+
+        try
+        {
+            boost::filesystem::create_directories(path);
+        }
+        catch (const std::exception& e)
+        {
+            Log(Debug::Warning) << "Warning: Failed to create texture cache directory " << path << ": " << e.what();
+            return;
+        }
+
+        mCompressionCachePath = path;
+    }
+
+    osg::ref_ptr<osg::Image> ImageManager::readCompressedImage(const std::string& cacheFile)
+    {
+        std::string data;
+        if (!Files::readCacheFile(cacheFile, data))
+            return nullptr;
+
+        std::istringstream stream(data);
+        osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension("dds");
+        osgDB::ReaderWriter::ReadResult result = reader->readImage(stream, mCompressionCacheOptions);
+        if (!result.success())
+        {
+            Log(Debug::Warning) << "Warning: Failed to read cached texture " << cacheFile << ": " << result.message();
+            return nullptr;
+        }
+        return result.getImage();
+    }
+
+    osg::ref_ptr<osg::Image> ImageManager::compressImage(osg::ref_ptr<osg::Image> image, const std::string& cacheFile)
+    {
+        if (image->isCompressed() || image->r() != 1 || image->getDataType() != GL_UNSIGNED_BYTE
+                || (image->getPixelFormat() != GL_RGB && image->getPixelFormat() != GL_RGBA))
+            return image;
+
+        osg::ref_ptr<osg::Image> compressed = new osg::Image(*image, osg::CopyOp::DEEP_COPY_ALL);
+        osg::Texture::InternalFormatMode format = image->isImageTranslucent() ? osg::Texture::USE_S3TC_DXT5_COMPRESSION
+                                                                              : osg::Texture::USE_S3TC_DXT1_COMPRESSION;
+        osgDB::Registry::instance()->getImageProcessor()->compress(*compressed, format, true, true,
+                                                                    osgDB::ImageProcessor::USE_CPU, osgDB::ImageProcessor::NORMAL);
+        if (!compressed->isCompressed() || !checkSupported(compressed, cacheFile))
+            return image;
+
+        std::ostringstream stream;
+        osgDB::ReaderWriter* writer = osgDB::Registry::instance()->getReaderWriterForExtension("dds");
+        osgDB::ReaderWriter::WriteResult result = writer->writeImage(*compressed, stream, mCompressionCacheOptions);
+        if (result.success())
+            Files::writeCacheFile(cacheFile, stream.str());
+        else
+            Log(Debug::Warning) << "Warning: Failed to write cached texture " << cacheFile << ": " << result.message();
+
+        compressed->setFileName(image->getFileName());
+        return compressed;
+    }
+
     osg::ref_ptr<osg::Image> ImageManager::getImage(const std::string &filename)
     {
         std::string normalized = filename;
@@ -115,6 +193,26 @@ namespace Resource
                 return mWarningImage;
             }
 
+            std::string cacheFile;
+            if (!mCompressionCachePath.empty() && ext != "dds")
+            {
+                // Hash the file contents as well as the path, so that the cached image is replaced when the file changes
+                std::string data ((std::istreambuf_iterator<char>(*stream)), std::istreambuf_iterator<char>());
+                std::ostringstream cacheName;
+                cacheName << std::hex << std::hash<std::string>()(normalized) << "_" << std::hash<std::string>()(data) << ".dds";
+                cacheFile = (boost::filesystem::path(mCompressionCachePath) / cacheName.str()).string();
+
+                osg::ref_ptr<osg::Image> cachedImage = readCompressedImage(cacheFile);
+                if (cachedImage && checkSupported(cachedImage, filename))
+                {
+                    cachedImage->setFileName(normalized);
+                    mCache->addEntryToObjectCache(normalized, cachedImage);
+                    return cachedImage;
+                }
+
+                stream = std::make_shared<std::istringstream>(data);
+            }
+
             bool killAlpha = false;
             if (reader->supportedExtensions().count("tga"))
             {
@@ -185,6 +283,9 @@ namespace Resource
                 image = newImage;
             }
 
+            if (!cacheFile.empty())
+                image = compressImage(image, cacheFile);
+
             mCache->addEntryToObjectCache(normalized, image);
             return image;
         }
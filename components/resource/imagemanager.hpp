@@ -32,11 +32,21 @@ namespace Resource
 
         osg::Image* getWarningImage();
 
+        /// Compress uncompressed images to S3TC with mipmaps when they are first loaded, and keep the results in the given
+        /// directory to load them from there afterwards. Requires an osgDB image processor (i.e. the nvtt plugin).
+        /// @note Not thread safe, call before loading any images. An empty path disables compression.
+        void setCompressionCachePath(const std::string& path);
+
         void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
 
     private:
+        osg::ref_ptr<osg::Image> readCompressedImage(const std::string& cacheFile);
+        osg::ref_ptr<osg::Image> compressImage(osg::ref_ptr<osg::Image> image, const std::string& cacheFile);
+
         osg::ref_ptr<osg::Image> mWarningImage;
         osg::ref_ptr<osgDB::Options> mOptions;
+        osg::ref_ptr<osgDB::Options> mCompressionCacheOptions;
+        std::string mCompressionCachePath;
 
         ImageManager(const ImageManager&);
         void operator = (const ImageManager&);
@@ -21,10 +21,13 @@
 
 #include <components/vfs/manager.hpp>
 
+#include <components/sceneutil/attach.hpp>
 #include <components/sceneutil/clone.hpp>
 #include <components/sceneutil/util.hpp>
 #include <components/sceneutil/controller.hpp>
 #include <components/sceneutil/optimizer.hpp>
+#include <components/sceneutil/skeleton.hpp>
+#include <components/sceneutil/riggeometry.hpp>
 
 #include <components/shader/shadervisitor.hpp>
 #include <components/shader/shadermanager.hpp>
@@ -33,6 +36,7 @@
 #include "niffilemanager.hpp"
 #include "objectcache.hpp"
 #include "multiobjectcache.hpp"
+#include "texturestreamer.hpp"
 
 namespace
 {
@@ -220,6 +224,8 @@ namespace Resource
         , mClampLighting(true)
         , mAutoUseNormalMaps(false)
         , mAutoUseSpecularMaps(false)
+        , mGpuSkinning(false)
+        , mMaxVertexUniformComponents(0)
         , mInstanceCache(new MultiObjectCache)
         , mSharedStateManager(new SharedStateManager)
         , mImageManager(imageManager)
@@ -230,6 +236,7 @@ namespace Resource
         , mUnRefImageDataAfterApply(false)
         , mParticleSystemMask(~0u)
     {
+        SceneUtil::RigGeometry::addSkinningAttribLocations(*mShaderManager);
     }
 
     void SceneManager::setForceShaders(bool force)
@@ -284,6 +291,16 @@ namespace Resource
         mSpecularMapPattern = pattern;
     }
 
+    void SceneManager::setGpuSkinning(bool gpuSkinning)
+    {
+        mGpuSkinning = gpuSkinning;
+    }
+
+    void SceneManager::setMaxVertexUniformComponents(int components)
+    {
+        mMaxVertexUniformComponents = components;
+    }
+
     SceneManager::~SceneManager()
     {
         // this has to be defined in the .cpp file as we can't delete incomplete types
@@ -307,6 +324,14 @@ namespace Resource
         return mCache->checkInObjectCache(normalized, timeStamp);
     }
 
+    bool SceneManager::isLoaded(const std::string &name)
+    {
+        std::string normalized = name;
+        mVFS->normalizeFilename(normalized);
+
+        return mCache->getRefFromObjectCache(normalized) != nullptr;
+    }
+
     /// @brief Callback to read image files from the VFS.
     class ImageReadCallback : public osgDB::ReadFileCallback
     {
@@ -513,11 +538,22 @@ namespace Resource
             osg::ref_ptr<Shader::ShaderVisitor> shaderVisitor (createShaderVisitor());
             loaded->accept(*shaderVisitor);
 
+            // give streamed textures their current level first, so that they can be shared with those of other scenes
+            if (mTextureStreamer)
+                mTextureStreamer->prepareTextures(*loaded);
+
             // share state
             // do this before optimizing so the optimizer will be able to combine nodes more aggressively
             // note, because StateSets will be shared at this point, StateSets can not be modified inside the optimizer
             mSharedStateMutex.lock();
-            mSharedStateManager->share(loaded.get());
+            if (mTextureStreamer)
+            {
+                // the texture streamer swaps the images of shared textures on the draw thread
+                std::lock_guard<std::mutex> lock(mTextureStreamer->getSwapMutex());
+                mSharedStateManager->share(loaded.get());
+            }
+            else
+                mSharedStateManager->share(loaded.get());
             mSharedStateMutex.unlock();
 
             if (canOptimize(normalized))
@@ -530,6 +566,9 @@ namespace Resource
                 optimizer.optimize(loaded, options);
             }
 
+            if (mTextureStreamer)
+                mTextureStreamer->addTextures(*loaded);
+
             if (compile && mIncrementalCompileOperation)
                 mIncrementalCompileOperation->add(loaded);
             else
@@ -613,6 +652,32 @@ namespace Resource
         return cloned;
     }
 
+    osg::ref_ptr<osg::Node> SceneManager::getSkinnedInstance(const std::string &name, osg::Node *master, const std::string &filter)
+    {
+        std::string normalized = name;
+        mVFS->normalizeFilename(normalized);
+
+        osg::ref_ptr<const osg::Node> scene = getTemplate(normalized);
+        if (!dynamic_cast<const SceneUtil::Skeleton*>(scene.get()))
+            return nullptr;
+
+        // An instance preloaded by cacheInstance is already a copy, its skinned nodes can be moved without cloning them again
+        osg::ref_ptr<osg::Object> obj = mInstanceCache->takeFromObjectCache(normalized);
+        if (obj.get())
+            return SceneUtil::attach(static_cast<osg::Node*>(obj.get()), master, filter, nullptr);
+
+        osg::ref_ptr<osg::Node> attached = SceneUtil::attachSkinned(*scene, master, filter);
+        attached->getOrCreateUserDataContainer()->addUserObject(new TemplateRef(scene));
+
+        if (attached->getNumChildrenRequiringUpdateTraversal() > 0)
+        {
+            InitParticlesVisitor visitor (mParticleSystemMask);
+            attached->accept(visitor);
+        }
+
+        return attached;
+    }
+
     void SceneManager::attachTo(osg::Node *instance, osg::Group *parentNode) const
     {
         parentNode->addChild(instance);
@@ -700,6 +765,11 @@ namespace Resource
         tex->setMaxAnisotropy(mMaxAnisotropy);
     }
 
+    void SceneManager::setTextureStreamer(TextureStreamer *streamer)
+    {
+        mTextureStreamer = streamer;
+    }
+
     void SceneManager::setUnRefImageDataAfterApply(bool unref)
     {
         mUnRefImageDataAfterApply = unref;
@@ -759,6 +829,9 @@ namespace Resource
 
         stats->setAttribute(frameNumber, "Node", mCache->getCacheSize());
         stats->setAttribute(frameNumber, "Node Instance", mInstanceCache->getCacheSize());
+
+        if (mTextureStreamer)
+            mTextureStreamer->reportStats(frameNumber, stats);
     }
 
     Shader::ShaderVisitor *SceneManager::createShaderVisitor()
@@ -770,6 +843,8 @@ namespace Resource
         shaderVisitor->setNormalHeightMapPattern(mNormalHeightMapPattern);
         shaderVisitor->setAutoUseSpecularMaps(mAutoUseSpecularMaps);
         shaderVisitor->setSpecularMapPattern(mSpecularMapPattern);
+        if (mGpuSkinning)
+            shaderVisitor->setMaxGpuBones(SceneUtil::RigGeometry::getMaxGpuBones(mMaxVertexUniformComponents));
         return shaderVisitor;
     }
 
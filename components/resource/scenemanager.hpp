@@ -17,6 +17,7 @@ namespace Resource
     class ImageManager;
     class NifFileManager;
     class SharedStateManager;
+    class TextureStreamer;
 }
 
 namespace osgUtil
@@ -73,11 +74,23 @@ namespace Resource
 
         void setSpecularMapPattern(const std::string& pattern);
 
+        /// Skin animated meshes in the vertex shader when they are rendered with shaders.
+        /// @see ShaderVisitor::setMaxGpuBones
+        void setGpuSkinning(bool gpuSkinning);
+
+        /// Set GL_MAX_VERTEX_UNIFORM_COMPONENTS of the graphics driver, which limits the number of bones for skinning in the vertex shader.
+        /// Skinning in the vertex shader is not used while this is unknown.
+        void setMaxVertexUniformComponents(int components);
+
         void setShaderPath(const std::string& path);
 
         /// Check if a given scene is loaded and if so, update its usage timestamp to prevent it from being unloaded
         bool checkLoaded(const std::string& name, double referenceTime);
 
+        /// Check if a given scene is loaded, without updating its usage timestamp.
+        /// @note Thread safe.
+        bool isLoaded(const std::string& name);
+
         /// Get a read-only copy of this scene "template"
         /// @note If the given filename does not exist or fails to load, an error marker mesh will be used instead.
         ///  If even the error marker mesh can not be found, an exception is thrown.
@@ -104,6 +117,14 @@ namespace Resource
         /// @note Not thread safe, unless parentNode is not part of the main scene graph yet.
         osg::ref_ptr<osg::Node> getInstance(const std::string& name, osg::Group* parentNode);
 
+        /// Get an instance of the skinned objects of the given scene template that match the filter, and attach it to the skeleton of \a master.
+        /// Cheaper than getInstance() followed by SceneUtil::attach(), as the bones of the template are not cloned.
+        /// An instance preloaded with cacheInstance() is used instead of the template when available.
+        /// @return nullptr if the scene template has no skeleton, use getInstance() and SceneUtil::attach() in that case.
+        /// @see SceneUtil::attachSkinned
+        /// @note Not thread safe, unless master is not part of the main scene graph yet.
+        osg::ref_ptr<osg::Node> getSkinnedInstance(const std::string& name, osg::Node* master, const std::string& filter);
+
         /// Attach the given scene instance to the given parent node
         /// @note You should have the parentNode in its intended position before calling this method,
         ///       so that world space particles of the \a instance get transformed correctly.
@@ -133,6 +154,10 @@ namespace Resource
         /// the filter settings are applied automatically. This method is provided for textures that were created outside of the SceneManager.
         void applyFilterSettings (osg::Texture* tex);
 
+        /// Register the textures of loaded scenes with the given TextureStreamer.
+        /// @note Must be called before any scenes are loaded.
+        void setTextureStreamer(TextureStreamer* streamer);
+
         /// Keep a copy of the texture data around in system memory? This is needed when using multiple graphics contexts,
         /// otherwise should be disabled to reduce memory usage.
         void setUnRefImageDataAfterApply(bool unref);
@@ -156,6 +181,8 @@ namespace Resource
         std::string mNormalHeightMapPattern;
         bool mAutoUseSpecularMaps;
         std::string mSpecularMapPattern;
+        bool mGpuSkinning;
+        int mMaxVertexUniformComponents;
 
         osg::ref_ptr<MultiObjectCache> mInstanceCache;
 
@@ -172,6 +199,8 @@ namespace Resource
 
         osg::ref_ptr<osgUtil::IncrementalCompileOperation> mIncrementalCompileOperation;
 
+        osg::ref_ptr<TextureStreamer> mTextureStreamer;
+
         unsigned int mParticleSystemMask;
 
         SceneManager(const SceneManager&);
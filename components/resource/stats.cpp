@@ -291,6 +291,8 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase *viewer)
             "Shape",
             "Shape Instance",
             "Image",
+            "Streamed Texture",
+            "Streaming MB",
             "Nif",
             "Keyframe",
             "",
@@ -310,9 +312,16 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase *viewer)
             "Mechanics Actors",
             "Mechanics Objects",
             "",
+            "Animation Updated",
+            "Animation Skipped",
+            "",
             "Physics Actors",
             "Physics Objects",
             "Physics HeightFields",
+            "",
+            "Sound Buffer MB",
+            "Sound Decoded MB",
+            "Sound Decoding",
         });
 
         static const auto longest = std::max_element(statNames.begin(), statNames.end(),
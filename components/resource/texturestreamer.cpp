@@ -0,0 +1,330 @@
+#include "texturestreamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <osg/NodeCallback>
+#include <osg/State>
+#include <osg/Stats>
+
+#include <osgUtil/CullVisitor>
+
+namespace
+{
+    // Textures that were not seen for this many frames are moved back to their base level
+    const unsigned int sMaxUnusedFrames = 300;
+
+    // Limit the amount of texture data uploaded per frame, to avoid stalling the draw thread
+    const std::size_t sMaxUploadSizePerFrame = 16 * 1024 * 1024;
+
+    osg::ref_ptr<osg::Image> createLevel(const osg::Image& image, unsigned int level)
+    {
+        const unsigned int offset = image.getMipmapOffset(level);
+        const unsigned int size = image.getTotalSizeInBytesIncludingMipmaps() - offset;
+        unsigned char* data = new unsigned char[size];
+        std::memcpy(data, image.data() + offset, size);
+
+        osg::ref_ptr<osg::Image> result (new osg::Image);
+        result->setFileName(image.getFileName());
+        result->setImage(std::max(1, image.s() >> level), std::max(1, image.t() >> level), image.r(),
+                         image.getInternalTextureFormat(), image.getPixelFormat(), image.getDataType(),
+                         data, osg::Image::USE_NEW_DELETE, image.getPacking());
+        result->setOrigin(image.getOrigin());
+
+        osg::Image::MipmapDataType mipmaps;
+        for (unsigned int i = level + 1; i < image.getNumMipmapLevels(); ++i)
+            mipmaps.push_back(image.getMipmapOffset(i) - offset);
+        result->setMipmapLevels(mipmaps);
+        return result;
+    }
+
+    class StreamingCullCallback : public osg::NodeCallback
+    {
+    public:
+        StreamingCullCallback()
+        {
+        }
+
+        StreamingCullCallback(const std::vector<osg::ref_ptr<Resource::TextureStreamer::StreamedImage> >& images)
+            : mImages(images)
+        {
+        }
+
+        StreamingCullCallback(const StreamingCullCallback& copy, const osg::CopyOp& copyop)
+            : osg::NodeCallback(copy, copyop)
+            , mImages(copy.mImages)
+        {
+        }
+
+        META_Object(Resource, StreamingCullCallback)
+
+        void operator()(osg::Node* node, osg::NodeVisitor* nv) override
+        {
+            osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
+            const unsigned int size = static_cast<unsigned int>(2.f * cv->clampedPixelSize(node->getBound()));
+            const unsigned int frameNumber = nv->getTraversalNumber();
+            for (const auto& image : mImages)
+                image->request(size, frameNumber);
+
+            traverse(node, nv);
+        }
+
+    private:
+        std::vector<osg::ref_ptr<Resource::TextureStreamer::StreamedImage> > mImages;
+    };
+}
+
+namespace Resource
+{
+
+    class AddStreamedTexturesVisitor : public osg::NodeVisitor
+    {
+    public:
+        AddStreamedTexturesVisitor(TextureStreamer& streamer, bool addCallbacks)
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mStreamer(streamer)
+            , mAddCallbacks(addCallbacks)
+        {
+        }
+
+        void apply(osg::Node& node) override
+        {
+            osg::StateSet* stateset = node.getStateSet();
+            if (stateset)
+            {
+                std::vector<osg::ref_ptr<TextureStreamer::StreamedImage> > images;
+                const osg::StateSet::TextureAttributeList& texAttributes = stateset->getTextureAttributeList();
+                for (unsigned int unit=0; unit<texAttributes.size(); ++unit)
+                {
+                    osg::StateAttribute* attr = stateset->getTextureAttribute(unit, osg::StateAttribute::TEXTURE);
+                    osg::Texture2D* texture = attr ? dynamic_cast<osg::Texture2D*>(attr) : nullptr;
+                    if (!texture)
+                        continue;
+                    osg::ref_ptr<TextureStreamer::StreamedImage> image = mStreamer.addTexture(texture);
+                    if (image && std::find(images.begin(), images.end(), image) == images.end())
+                        images.push_back(image);
+                }
+                if (mAddCallbacks && !images.empty())
+                    node.addCullCallback(new StreamingCullCallback(images));
+            }
+
+            traverse(node);
+        }
+
+    private:
+        TextureStreamer& mStreamer;
+        bool mAddCallbacks;
+    };
+
+    TextureStreamer::StreamedImage::StreamedImage(osg::Image* image, unsigned int baseLevel)
+        : mImage(image)
+        , mBaseLevel(baseLevel)
+        , mLevelImage(createLevel(*image, baseLevel))
+        , mLevel(baseLevel)
+        , mRequestedSize(0)
+        , mLastUsedFrame(0)
+    {
+    }
+
+    void TextureStreamer::StreamedImage::request(unsigned int size, unsigned int frameNumber)
+    {
+        mLastUsedFrame = frameNumber;
+        unsigned int requested = mRequestedSize;
+        while (requested < size && !mRequestedSize.compare_exchange_weak(requested, size))
+            ;
+    }
+
+    unsigned int TextureStreamer::StreamedImage::getLevelForSize(unsigned int size) const
+    {
+        const unsigned int dimension = std::max(mImage->s(), mImage->t());
+        unsigned int level = 0;
+        while (level < mBaseLevel && (dimension >> (level+1)) >= size)
+            ++level;
+        return level;
+    }
+
+    std::size_t TextureStreamer::StreamedImage::getLevelSize(unsigned int level) const
+    {
+        return mImage->getTotalSizeInBytesIncludingMipmaps() - mImage->getMipmapOffset(level);
+    }
+
+    TextureStreamer::TextureStreamer(int baseSize, int budget)
+        : osg::GraphicsOperation("TextureStreamer", true)
+        , mBaseSize(std::max(1, baseSize))
+        , mBudget(static_cast<std::size_t>(std::max(0, budget)) * 1024 * 1024)
+        , mResidentSize(0)
+        , mNumStreamedIn(0)
+    {
+    }
+
+    void TextureStreamer::prepareTextures(osg::Node& node)
+    {
+        AddStreamedTexturesVisitor visitor(*this, false);
+        node.accept(visitor);
+    }
+
+    void TextureStreamer::addTextures(osg::Node& node)
+    {
+        AddStreamedTexturesVisitor visitor(*this, true);
+        node.accept(visitor);
+    }
+
+    osg::ref_ptr<TextureStreamer::StreamedImage> TextureStreamer::addTexture(osg::Texture2D* texture)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto found = mTextures.find(texture);
+        if (found != mTextures.end())
+        {
+            if (found->second.mTexture.valid())
+                return found->second.mImage;
+            mTextures.erase(found);
+        }
+
+        osg::Image* image = texture->getImage();
+        if (!image || image->r() != 1 || image->getNumMipmapLevels() <= 1)
+            return nullptr;
+
+        osg::ref_ptr<StreamedImage>& streamedImage = mImages[image];
+        if (!streamedImage)
+        {
+            const unsigned int dimension = std::max(image->s(), image->t());
+            unsigned int baseLevel = 0;
+            while (baseLevel + 1 < image->getNumMipmapLevels() && (dimension >> baseLevel) > mBaseSize)
+                ++baseLevel;
+            if (baseLevel == 0)
+            {
+                mImages.erase(image);
+                return nullptr;
+            }
+            streamedImage = new StreamedImage(image, baseLevel);
+        }
+
+        // The texture is not shared yet, so it can not be in use by another thread
+        texture->setImage(streamedImage->mLevelImage.get());
+        streamedImage->mTextures.push_back(osg::observer_ptr<osg::Texture2D>(texture));
+        TextureEntry& entry = mTextures[texture];
+        entry.mTexture = texture;
+        entry.mImage = streamedImage;
+        return streamedImage;
+    }
+
+    void TextureStreamer::setLevel(StreamedImage& image, unsigned int level)
+    {
+        osg::ref_ptr<osg::Image> levelImage = level == 0 ? image.mImage : createLevel(*image.mImage, level);
+        {
+            std::lock_guard<std::mutex> lock(mSwapMutex);
+            for (const auto& observer : image.mTextures)
+            {
+                osg::ref_ptr<osg::Texture2D> texture;
+                if (observer.lock(texture))
+                    texture->setImage(levelImage.get());
+            }
+        }
+        // Releases the copy of the previous level
+        image.mLevelImage = levelImage;
+        image.mLevel = level;
+    }
+
+    void TextureStreamer::operator()(osg::GraphicsContext* graphicsContext)
+    {
+        const osg::FrameStamp* frameStamp = graphicsContext->getState() ? graphicsContext->getState()->getFrameStamp() : nullptr;
+        if (!frameStamp)
+            return;
+        const unsigned int frameNumber = frameStamp->getFrameNumber();
+
+        struct Candidate
+        {
+            StreamedImage* mImage;
+            unsigned int mLevel;
+            unsigned int mPriority;
+        };
+        std::vector<Candidate> upgrades;
+        std::vector<Candidate> evictable;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (auto it = mTextures.begin(); it != mTextures.end();)
+        {
+            if (!it->second.mTexture.valid())
+                it = mTextures.erase(it);
+            else
+                ++it;
+        }
+
+        std::size_t residentSize = 0;
+        for (auto it = mImages.begin(); it != mImages.end();)
+        {
+            StreamedImage& image = *it->second;
+            image.mTextures.erase(std::remove_if(image.mTextures.begin(), image.mTextures.end(),
+                [] (const osg::observer_ptr<osg::Texture2D>& texture) { return !texture.valid(); }), image.mTextures.end());
+            if (image.mTextures.empty())
+            {
+                it = mImages.erase(it);
+                continue;
+            }
+            ++it;
+
+            const unsigned int requestedSize = image.mRequestedSize.exchange(0);
+            const unsigned int lastUsedFrame = image.mLastUsedFrame;
+            if (image.mLevel != image.mBaseLevel && frameNumber > lastUsedFrame + sMaxUnusedFrames)
+                setLevel(image, image.mBaseLevel);
+            else if (requestedSize > 0)
+            {
+                const unsigned int level = image.getLevelForSize(requestedSize);
+                if (level < image.mLevel)
+                    upgrades.push_back({&image, level, requestedSize});
+            }
+
+            if (image.mLevel != image.mBaseLevel && frameNumber > lastUsedFrame + 2)
+                evictable.push_back({&image, image.mBaseLevel, lastUsedFrame});
+
+            residentSize += image.getLevelSize(image.mLevel);
+        }
+
+        // Objects that are bigger on screen are streamed in first, least recently used images are evicted first
+        std::sort(upgrades.begin(), upgrades.end(), [] (const Candidate& left, const Candidate& right) { return left.mPriority > right.mPriority; });
+        std::sort(evictable.begin(), evictable.end(), [] (const Candidate& left, const Candidate& right) { return left.mPriority < right.mPriority; });
+
+        std::size_t uploadSize = 0;
+        auto victim = evictable.begin();
+        for (const Candidate& upgrade : upgrades)
+        {
+            const std::size_t size = upgrade.mImage->getLevelSize(upgrade.mLevel);
+            if (uploadSize > 0 && uploadSize + size > sMaxUploadSizePerFrame)
+                break;
+
+            const std::size_t oldSize = upgrade.mImage->getLevelSize(upgrade.mImage->mLevel);
+            while (residentSize - oldSize + size > mBudget && victim != evictable.end())
+            {
+                residentSize -= victim->mImage->getLevelSize(victim->mImage->mLevel);
+                setLevel(*victim->mImage, victim->mLevel);
+                residentSize += victim->mImage->getLevelSize(victim->mLevel);
+                ++victim;
+            }
+            if (residentSize - oldSize + size > mBudget)
+                break;
+
+            setLevel(*upgrade.mImage, upgrade.mLevel);
+            residentSize = residentSize - oldSize + size;
+            uploadSize += size;
+        }
+
+        unsigned int numStreamedIn = 0;
+        for (const auto& pair : mImages)
+        {
+            if (pair.second->mLevel != pair.second->mBaseLevel)
+                ++numStreamedIn;
+        }
+
+        mResidentSize = residentSize;
+        mNumStreamedIn = numStreamedIn;
+    }
+
+    void TextureStreamer::reportStats(unsigned int frameNumber, osg::Stats *stats) const
+    {
+        stats->setAttribute(frameNumber, "Streamed Texture", mNumStreamedIn);
+        stats->setAttribute(frameNumber, "Streaming MB", mResidentSize / (1024 * 1024));
+    }
+
+}
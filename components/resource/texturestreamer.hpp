@@ -0,0 +1,116 @@
+#ifndef OPENMW_COMPONENTS_RESOURCE_TEXTURESTREAMER_H
+#define OPENMW_COMPONENTS_RESOURCE_TEXTURESTREAMER_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <osg/GraphicsContext>
+#include <osg/Image>
+#include <osg/observer_ptr>
+#include <osg/ref_ptr>
+#include <osg/Texture2D>
+
+namespace osg
+{
+    class Node;
+    class Stats;
+}
+
+namespace Resource
+{
+
+    /// @brief Streams the mipmap levels of large textures in and out of video memory depending on how big their objects appear on screen.
+    /// @par The images of loaded scenes are registered using prepareTextures(). Textures are given a copy of their image that lacks
+    /// the mip levels above the configured base size, so that only these low resolution levels are uploaded when a scene is first compiled.
+    /// The current level is tracked per image rather than per texture, so textures of different scenes using the same image
+    /// always hold the same level copy and can still be shared.
+    /// A cull callback added by addTextures() records the projected size of the objects using the image, and the streamer, running
+    /// as a graphics operation at the end of each frame, swaps in the resolution that is needed. Images that have not been seen for
+    /// a while, or that are the least recently used ones when the memory budget is exceeded, go back to the base level.
+    /// Only the original image and the copy of its current level are kept in memory.
+    /// @note The texture swap happens on the draw thread, when the textures are not in use by the rendering. Other threads that read
+    /// the images of registered textures, such as the state sharing of the SceneManager, must hold getSwapMutex().
+    /// Textures must keep their image data after apply.
+    class TextureStreamer : public osg::GraphicsOperation
+    {
+    public:
+        /// @param baseSize The resolution that is always resident.
+        /// @param budget Memory budget in megabytes for streamed texture data.
+        TextureStreamer(int baseSize, int budget);
+
+        /// Register the 2D textures found in the StateSets of this scene for streaming and give them the current level of their image.
+        /// @note Must be called before the state of the scene is shared, so that its textures match those of other scenes.
+        /// @note Thread safe.
+        void prepareTextures(osg::Node& node);
+
+        /// Add the cull callbacks requesting the resolution that the streamed textures of this scene need.
+        /// @note Must be called after the scene was optimized and before it is rendered for the first time.
+        /// @note Thread safe.
+        void addTextures(osg::Node& node);
+
+        /// Locked while the images of registered textures are swapped.
+        std::mutex& getSwapMutex() { return mSwapMutex; }
+
+        void operator()(osg::GraphicsContext* graphicsContext) override;
+
+        void reportStats(unsigned int frameNumber, osg::Stats* stats) const;
+
+        /// A streamed image and the textures using it. Level 0 is the full image, level n lacks the first n mipmaps.
+        class StreamedImage : public osg::Referenced
+        {
+        public:
+            StreamedImage(osg::Image* image, unsigned int baseLevel);
+
+            /// Record that the image is used for an object of the given size on screen.
+            /// @note Thread safe.
+            void request(unsigned int size, unsigned int frameNumber);
+
+            /// @return The lowest resolution level that still covers the given size in pixels.
+            unsigned int getLevelForSize(unsigned int size) const;
+
+            /// @return The size in bytes of the given level, including its mipmaps.
+            std::size_t getLevelSize(unsigned int level) const;
+
+            osg::ref_ptr<osg::Image> mImage;
+            unsigned int mBaseLevel;
+
+            /// The copy of the current level, or the original image at level 0.
+            osg::ref_ptr<osg::Image> mLevelImage;
+            unsigned int mLevel;
+
+            std::vector<osg::observer_ptr<osg::Texture2D> > mTextures;
+
+            std::atomic<unsigned int> mRequestedSize;
+            std::atomic<unsigned int> mLastUsedFrame;
+        };
+
+    private:
+        osg::ref_ptr<StreamedImage> addTexture(osg::Texture2D* texture);
+
+        void setLevel(StreamedImage& image, unsigned int level);
+
+        struct TextureEntry
+        {
+            osg::observer_ptr<osg::Texture2D> mTexture;
+            osg::ref_ptr<StreamedImage> mImage;
+        };
+
+        unsigned int mBaseSize;
+        std::size_t mBudget;
+
+        std::map<osg::Image*, osg::ref_ptr<StreamedImage> > mImages;
+        std::map<osg::Texture2D*, TextureEntry> mTextures;
+        mutable std::mutex mMutex;
+        std::mutex mSwapMutex;
+
+        std::atomic<std::size_t> mResidentSize;
+        std::atomic<unsigned int> mNumStreamedIn;
+
+        friend class AddStreamedTexturesVisitor;
+    };
+
+}
+
+#endif
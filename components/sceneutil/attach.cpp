@@ -14,6 +14,7 @@
 
 #include <components/sceneutil/skeleton.hpp>
 
+#include "clone.hpp"
 #include "visitor.hpp"
 
 namespace SceneUtil
@@ -73,6 +74,13 @@ namespace SceneUtil
             mToCopy.clear();
         }
 
+        void doClone(const osg::CopyOp& copyop)
+        {
+            for (const osg::ref_ptr<osg::Node>& node : mToCopy)
+                mParent->addChild(static_cast<osg::Node*>(node->clone(copyop)));
+            mToCopy.clear();
+        }
+
     private:
 
         bool filterMatches(const std::string& name) const
@@ -92,6 +100,8 @@ namespace SceneUtil
 
     void mergeUserData(osg::UserDataContainer* source, osg::Object* target)
     {
+        if (!source)
+            return;
         if (!target->getUserDataContainer())
             target->setUserDataContainer(source);
         else
@@ -101,6 +111,24 @@ namespace SceneUtil
         }
     }
 
+    osg::ref_ptr<osg::Node> attachRigHandle(osg::ref_ptr<osg::Group> handle, osg::Node* master, osg::UserDataContainer* userData)
+    {
+        if (handle->getNumChildren() == 1)
+        {
+            osg::ref_ptr<osg::Node> newHandle = handle->getChild(0);
+            handle->removeChild(newHandle);
+            master->asGroup()->addChild(newHandle);
+            mergeUserData(userData, newHandle);
+            return newHandle;
+        }
+        else
+        {
+            master->asGroup()->addChild(handle);
+            handle->setUserDataContainer(userData);
+            return handle;
+        }
+    }
+
     osg::ref_ptr<osg::Node> attach(osg::ref_ptr<osg::Node> toAttach, osg::Node *master, const std::string &filter, osg::Group* attachNode)
     {
         if (dynamic_cast<SceneUtil::Skeleton*>(toAttach.get()))
@@ -111,20 +139,7 @@ namespace SceneUtil
             toAttach->accept(copyVisitor);
             copyVisitor.doCopy();
 
-            if (handle->getNumChildren() == 1)
-            {
-                osg::ref_ptr<osg::Node> newHandle = handle->getChild(0);
-                handle->removeChild(newHandle);
-                master->asGroup()->addChild(newHandle);
-                mergeUserData(toAttach->getUserDataContainer(), newHandle);
-                return newHandle;
-            }
-            else
-            {
-                master->asGroup()->addChild(handle);
-                handle->setUserDataContainer(toAttach->getUserDataContainer());
-                return handle;
-            }
+            return attachRigHandle(handle, master, toAttach->getUserDataContainer());
         }
         else
         {
@@ -183,4 +198,20 @@ namespace SceneUtil
         }
     }
 
+    osg::ref_ptr<osg::Node> attachSkinned(const osg::Node& toAttach, osg::Node* master, const std::string& filter)
+    {
+        osg::ref_ptr<osg::Group> handle = new osg::Group;
+
+        // The visitor only collects the nodes to clone, the template itself is not modified
+        CopyRigVisitor copyVisitor(handle, filter);
+        const_cast<osg::Node&>(toAttach).accept(copyVisitor);
+        SceneUtil::CopyOp copyop;
+        copyVisitor.doClone(copyop);
+
+        osg::ref_ptr<osg::UserDataContainer> userData;
+        if (const osg::UserDataContainer* source = toAttach.getUserDataContainer())
+            userData = static_cast<osg::UserDataContainer*>(source->clone(copyop));
+        return attachRigHandle(handle, master, userData);
+    }
+
 }
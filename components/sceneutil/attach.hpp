@@ -21,6 +21,13 @@ namespace SceneUtil
     /// @return A newly created node that is directly attached to the master scene graph
     osg::ref_ptr<osg::Node> attach(osg::ref_ptr<osg::Node> toAttach, osg::Node* master, const std::string& filter, osg::Group* attachNode);
 
+    /// Attach the skinned objects of the \a toAttach scene graph that match the filter to the \a master scenegraph, like attach() does.
+    /// Unlike attach(), \a toAttach may be a shared template: only the attached nodes are cloned, rather than also the bone hierarchy and
+    /// its controllers that would be thrown away afterwards.
+    /// @note \a toAttach is expected to be a Skeleton.
+    /// @return A newly created node that is directly attached to the master scene graph
+    osg::ref_ptr<osg::Node> attachSkinned(const osg::Node& toAttach, osg::Node* master, const std::string& filter);
+
 }
 
 #endif
@@ -24,8 +24,11 @@
 #include <osg/io_utils>
 #include <osg/Depth>
 
+#include <cmath>
 #include <sstream>
 
+#include "riggeometry.hpp"
+
 namespace {
 
 using namespace osgShadow;
@@ -120,6 +123,27 @@ std::string debugFragmentShaderSource =
 #endif
         "}                                                                       \n";
 
+// Writes the cached static shadow map into the depth buffer of the shadow map that is being rendered
+std::string staticCompositeVertexShaderSource = "void main(void){gl_Position = gl_Vertex; gl_TexCoord[0]=gl_MultiTexCoord0;}";
+std::string staticCompositeFragmentShaderSource =
+        "uniform sampler2D staticShadowMap;                                      \n"
+        "                                                                        \n"
+        "void main(void)                                                         \n"
+        "{                                                                       \n"
+        "    gl_FragDepth = texture2D(staticShadowMap, gl_TexCoord[0].xy).r;     \n"
+        "}                                                                       \n";
+
+// The cached static shadow map covers this much more than the shadow map it was created for, so it stays usable while the view moves
+const double staticCacheMargin = 1.25;
+// Refresh the static shadow map at least this often, to pick up newly loaded objects
+const unsigned int staticCacheMaxAge = 120;
+// Refresh the static shadow map when the light direction changed by more than this angle
+const double staticCacheMaxLightAngle = osg::DegreesToRadians(0.5);
+// A static shadow map that had to be refreshed after being reused fewer times than this was not worth the resolution lost to the margin
+const unsigned int staticCacheMinUses = 4;
+// Number of frames to render without the static shadow map cache after that happened
+const unsigned int staticCacheRetryDelay = 60;
+
 std::string debugFrustumVertexShaderSource = "varying float depth; uniform mat4 transform; void main(void){gl_Position = transform * gl_Vertex; depth = gl_Position.z / gl_Position.w;}";
 std::string debugFrustumFragmentShaderSource =
         "varying float depth;                                                    \n"
@@ -234,7 +258,7 @@ class VDSMCameraCullCallback : public osg::NodeCallback
 {
     public:
 
-        VDSMCameraCullCallback(MWShadowTechnique* vdsm, osg::Polytope& polytope);
+        VDSMCameraCullCallback(MWShadowTechnique* vdsm, osg::Polytope& polytope, osg::Node* composite = nullptr);
 
         virtual void operator()(osg::Node*, osg::NodeVisitor* nv);
 
@@ -247,11 +271,13 @@ class VDSMCameraCullCallback : public osg::NodeCallback
         osg::ref_ptr<osg::RefMatrix>            _projectionMatrix;
         osg::ref_ptr<osgUtil::RenderStage>      _renderStage;
         osg::Polytope                           _polytope;
+        osg::ref_ptr<osg::Node>                 _composite;
 };
 
-VDSMCameraCullCallback::VDSMCameraCullCallback(MWShadowTechnique* vdsm, osg::Polytope& polytope):
+VDSMCameraCullCallback::VDSMCameraCullCallback(MWShadowTechnique* vdsm, osg::Polytope& polytope, osg::Node* composite):
     _vdsm(vdsm),
-    _polytope(polytope)
+    _polytope(polytope),
+    _composite(composite)
 {
 }
 
@@ -277,6 +303,8 @@ void VDSMCameraCullCallback::operator()(osg::Node* node, osg::NodeVisitor* nv)
     {
         _vdsm->getShadowedScene()->osg::Group::traverse(*nv);
     }
+    if (_composite)
+        _composite->accept(*nv);
 #if 1
     if (!_polytope.empty())
     {
@@ -515,7 +543,11 @@ void MWShadowTechnique::LightData::setLightData(osg::RefMatrix* lm, const osg::L
 //
 MWShadowTechnique::ShadowData::ShadowData(MWShadowTechnique::ViewDependentData* vdd):
     _viewDependentData(vdd),
-    _textureUnit(0)
+    _textureUnit(0),
+    _staticCacheFrameNumber(0),
+    _staticCacheGeneration(0),
+    _staticCacheUses(0),
+    _staticCacheRetryFrameNumber(0)
 {
 
     const ShadowSettings* settings = vdd->getViewDependentShadowMap()->getShadowedScene()->getShadowSettings();
@@ -554,6 +586,7 @@ MWShadowTechnique::ShadowData::ShadowData(MWShadowTechnique::ViewDependentData*
     // set up the camera
     _camera = new osg::Camera;
     _camera->setName("ShadowCamera");
+    _camera->setUserData(new SceneUtil::RigGeometry::ShadowCastingCamera);
     _camera->setReferenceFrame(osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT);
 
     //_camera->setClearColor(osg::Vec4(1.0f,1.0f,1.0f,1.0f));
@@ -605,11 +638,52 @@ MWShadowTechnique::ShadowData::ShadowData(MWShadowTechnique::ViewDependentData*
     }
 }
 
+void MWShadowTechnique::ShadowData::createStaticCache(osg::Program* compositeProgram)
+{
+    _staticTexture = new osg::Texture2D;
+    _staticTexture->setTextureSize(_texture->getTextureWidth(), _texture->getTextureHeight());
+    _staticTexture->setInternalFormat(GL_DEPTH_COMPONENT);
+    _staticTexture->setFilter(osg::Texture2D::MIN_FILTER,osg::Texture2D::NEAREST);
+    _staticTexture->setFilter(osg::Texture2D::MAG_FILTER,osg::Texture2D::NEAREST);
+    _staticTexture->setWrap(osg::Texture2D::WRAP_S,osg::Texture2D::CLAMP_TO_EDGE);
+    _staticTexture->setWrap(osg::Texture2D::WRAP_T,osg::Texture2D::CLAMP_TO_EDGE);
+
+    // same setup as the shadow camera, but rendered before it
+    _staticCamera = new osg::Camera;
+    _staticCamera->setName("StaticShadowCamera");
+    _staticCamera->setUserData(new SceneUtil::RigGeometry::ShadowCastingCamera);
+    _staticCamera->setReferenceFrame(osg::Camera::ABSOLUTE_RF_INHERIT_VIEWPOINT);
+    _staticCamera->setComputeNearFarMode(osg::Camera::DO_NOT_COMPUTE_NEAR_FAR);
+    _staticCamera->setCullingMode(_staticCamera->getCullingMode() & ~osg::CullSettings::SMALL_FEATURE_CULLING);
+    _staticCamera->setViewport(0,0,_staticTexture->getTextureWidth(),_staticTexture->getTextureHeight());
+    _staticCamera->setClearMask(GL_DEPTH_BUFFER_BIT);
+    _staticCamera->setRenderOrder(osg::Camera::PRE_RENDER, -1);
+    _staticCamera->setRenderTargetImplementation(osg::Camera::FRAME_BUFFER_OBJECT);
+    _staticCamera->attach(osg::Camera::DEPTH_BUFFER, _staticTexture.get());
+
+    // full screen quad copying the static depth into the shadow map, the regular depth test merges it with the dynamic casters
+    _staticCompositeQuad = osg::createTexturedQuadGeometry(osg::Vec3(-1, -1, 0), osg::Vec3(2, 0, 0), osg::Vec3(0, 2, 0));
+    _staticCompositeQuad->setCullingActive(false);
+    osg::StateSet* stateset = _staticCompositeQuad->getOrCreateStateSet();
+    stateset->setAttributeAndModes(compositeProgram, osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    stateset->setTextureAttributeAndModes(0, _staticTexture.get(), osg::StateAttribute::ON | osg::StateAttribute::PROTECTED);
+    stateset->setMode(GL_CULL_FACE, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED);
+    stateset->addUniform(new osg::Uniform("staticShadowMap", 0));
+
+    _staticCacheFrameNumber = 0;
+}
+
 void MWShadowTechnique::ShadowData::releaseGLObjects(osg::State* state) const
 {
     OSG_INFO<<"MWShadowTechnique::ShadowData::releaseGLObjects"<<std::endl;
     _texture->releaseGLObjects(state);
     _camera->releaseGLObjects(state);
+    if (_staticCamera)
+    {
+        _staticTexture->releaseGLObjects(state);
+        _staticCamera->releaseGLObjects(state);
+        _staticCompositeQuad->releaseGLObjects(state);
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
@@ -872,7 +946,11 @@ void SceneUtil::MWShadowTechnique::setupCastingShader(Shader::ShaderManager & sh
     
     _castingProgram = new osg::Program();
 
-    _castingProgram->addShader(shaderManager.getShader("shadowcasting_vertex.glsl", Shader::ShaderManager::DefineMap(), osg::Shader::VERTEX));
+    // RigGeometries skinned in the vertex shader provide the skinning variant themselves, see RigGeometry::ShadowCastingCamera
+    Shader::ShaderManager::DefineMap vertexDefineMap;
+    vertexDefineMap["skinning"] = "0";
+    vertexDefineMap["maxBones"] = "0";
+    _castingProgram->addShader(shaderManager.getShader("shadowcasting_vertex.glsl", vertexDefineMap, osg::Shader::VERTEX));
     _castingProgram->addShader(shaderManager.getShader("shadowcasting_fragment.glsl", Shader::ShaderManager::DefineMap(), osg::Shader::FRAGMENT));
 
     _shadowMapAlphaTestDisableUniform = shaderManager.getShadowMapAlphaTestDisableUniform();
@@ -885,6 +963,25 @@ void SceneUtil::MWShadowTechnique::setupCastingShader(Shader::ShaderManager & sh
     shaderManager.getShadowMapAlphaTestEnableUniform()->set(true);
 }
 
+void SceneUtil::MWShadowTechnique::enableStaticCasterCaching(unsigned int staticCasterMask, unsigned int dynamicCasterMask)
+{
+    _staticCasterCaching = true;
+    _staticCasterMask = staticCasterMask;
+    _dynamicCasterMask = dynamicCasterMask;
+
+    if (!_staticCompositeProgram)
+    {
+        _staticCompositeProgram = new osg::Program;
+        _staticCompositeProgram->addShader(new osg::Shader(osg::Shader::VERTEX, staticCompositeVertexShaderSource));
+        _staticCompositeProgram->addShader(new osg::Shader(osg::Shader::FRAGMENT, staticCompositeFragmentShaderSource));
+    }
+}
+
+void SceneUtil::MWShadowTechnique::invalidateStaticCasterCache()
+{
+    ++_staticCasterCacheGeneration;
+}
+
 MWShadowTechnique::ViewDependentData* MWShadowTechnique::createViewDependentData(osgUtil::CullVisitor* /*cv*/)
 {
     return new ViewDependentData(this);
@@ -1324,7 +1421,66 @@ void MWShadowTechnique::cull(osgUtil::CullVisitor& cv)
             else
                 cropShadowCameraToMainFrustum(frustum, camera, reducedNear, reducedFar, extraPlanes);
 
-            osg::ref_ptr<VDSMCameraCullCallback> vdsmCallback = new VDSMCameraCullCallback(this, local_polytope);
+            unsigned int castsShadowTraversalMask = _shadowedScene->getCastsShadowTraversalMask();
+            osg::ref_ptr<osg::Node> staticComposite;
+            // there is nothing to cache when static objects do not cast shadows, e.g. in interiors
+            if (_staticCasterCaching && (castsShadowTraversalMask & _staticCasterMask) && cv.getTraversalNumber() >= sd->_staticCacheRetryFrameNumber
+                    && !settings->getDebugDraw() && settings->getShadowMapProjectionHint() != ShadowSettings::PERSPECTIVE_SHADOW_MAP)
+            {
+                if (!sd->_staticCamera)
+                    sd->createStaticCache(_staticCompositeProgram.get());
+
+                bool useStaticCache = true;
+                if (isStaticCacheUsable(*sd, camera->getViewMatrix(), camera->getProjectionMatrix(), cv.getTraversalNumber()))
+                    ++sd->_staticCacheUses;
+                else if (sd->_staticCacheFrameNumber != 0 && sd->_staticCacheUses < staticCacheMinUses)
+                {
+                    // the sun, the view or the static objects change too quickly for the cache to pay off,
+                    // render at the full resolution of the shadow map for a while
+                    sd->_staticCacheFrameNumber = 0;
+                    sd->_staticCacheRetryFrameNumber = cv.getTraversalNumber() + staticCacheRetryDelay;
+                    useStaticCache = false;
+                }
+                else
+                {
+                    // 4.2.1 refresh the static shadow map, covering a slightly bigger area than needed
+                    //
+                    sd->_staticViewMatrix = camera->getViewMatrix();
+                    sd->_staticProjectionMatrix = camera->getProjectionMatrix() * osg::Matrixd::scale(1.0 / staticCacheMargin, 1.0 / staticCacheMargin, 1.0);
+                    sd->_staticCacheFrameNumber = cv.getTraversalNumber();
+                    sd->_staticCacheGeneration = _staticCasterCacheGeneration;
+                    sd->_staticCacheUses = 0;
+                    sd->_staticCamera->setViewMatrix(sd->_staticViewMatrix);
+                    sd->_staticCamera->setProjectionMatrix(sd->_staticProjectionMatrix);
+
+                    // only clip the sides, casters in front of the near plane still need to be rendered as we use depth clamping
+                    osg::Polytope staticPolytope;
+                    staticPolytope.add(osg::Plane(1.0, 0.0, 0.0, 1.0));
+                    staticPolytope.add(osg::Plane(-1.0, 0.0, 0.0, 1.0));
+                    staticPolytope.add(osg::Plane(0.0, 1.0, 0.0, 1.0));
+                    staticPolytope.add(osg::Plane(0.0, -1.0, 0.0, 1.0));
+                    staticPolytope.transformProvidingInverse(sd->_staticProjectionMatrix);
+                    staticPolytope.setupMask();
+                    sd->_staticCamera->setCullCallback(new VDSMCameraCullCallback(this, staticPolytope));
+
+                    cv.pushStateSet(_shadowCastingStateSet.get());
+                    cullShadowCastingScene(&cv, sd->_staticCamera.get(), castsShadowTraversalMask & ~_dynamicCasterMask);
+                    cv.popStateSet();
+                }
+
+                if (useStaticCache)
+                {
+                    // render the dynamic casters with the matrices of the static shadow map so that both line up
+                    local_polytope.transformProvidingInverse(osg::Matrixd::inverse(sd->_staticViewMatrix) * camera->getViewMatrix());
+                    camera->setViewMatrix(sd->_staticViewMatrix);
+                    camera->setProjectionMatrix(sd->_staticProjectionMatrix);
+
+                    castsShadowTraversalMask &= ~_staticCasterMask;
+                    staticComposite = sd->_staticCompositeQuad;
+                }
+            }
+
+            osg::ref_ptr<VDSMCameraCullCallback> vdsmCallback = new VDSMCameraCullCallback(this, local_polytope, staticComposite.get());
             camera->setCullCallback(vdsmCallback.get());
 
             // 4.3 traverse RTT camera
@@ -1332,7 +1488,7 @@ void MWShadowTechnique::cull(osgUtil::CullVisitor& cv)
 
             cv.pushStateSet(_shadowCastingStateSet.get());
 
-            cullShadowCastingScene(&cv, camera.get());
+            cullShadowCastingScene(&cv, camera.get(), castsShadowTraversalMask);
 
             cv.popStateSet();
 
@@ -2962,14 +3118,14 @@ void MWShadowTechnique::cullShadowReceivingScene(osgUtil::CullVisitor* cv) const
     return;
 }
 
-void MWShadowTechnique::cullShadowCastingScene(osgUtil::CullVisitor* cv, osg::Camera* camera) const
+void MWShadowTechnique::cullShadowCastingScene(osgUtil::CullVisitor* cv, osg::Camera* camera, unsigned int castsShadowTraversalMask) const
 {
     OSG_INFO<<"cullShadowCastingScene()"<<std::endl;
 
     // record the traversal mask on entry so we can reapply it later.
     unsigned int traversalMask = cv->getTraversalMask();
 
-    cv->setTraversalMask( traversalMask & _shadowedScene->getShadowSettings()->getCastsShadowTraversalMask() );
+    cv->setTraversalMask( traversalMask & castsShadowTraversalMask );
 
         if (camera) camera->accept(*cv);
 
@@ -2978,6 +3134,29 @@ void MWShadowTechnique::cullShadowCastingScene(osgUtil::CullVisitor* cv, osg::Ca
     return;
 }
 
+bool MWShadowTechnique::isStaticCacheUsable(const ShadowData& sd, const osg::Matrixd& viewMatrix, const osg::Matrixd& projectionMatrix, unsigned int traversalNumber) const
+{
+    if (sd._staticCacheFrameNumber == 0 || traversalNumber > sd._staticCacheFrameNumber + staticCacheMaxAge
+            || sd._staticCacheGeneration != _staticCasterCacheGeneration)
+        return false;
+
+    // the light looks along the negative z axis of its view matrix
+    osg::Vec3d lightDir(viewMatrix(0,2), viewMatrix(1,2), viewMatrix(2,2));
+    osg::Vec3d cachedLightDir(sd._staticViewMatrix(0,2), sd._staticViewMatrix(1,2), sd._staticViewMatrix(2,2));
+    if (lightDir * cachedLightDir < std::cos(staticCacheMaxLightAngle))
+        return false;
+
+    // the area covered by the new shadow map, in clip space of the cached one
+    osg::Matrixd toCachedClipSpace = osg::Matrixd::inverse(projectionMatrix) * osg::Matrixd::inverse(viewMatrix) * sd._staticViewMatrix * sd._staticProjectionMatrix;
+    osg::BoundingBox bb;
+    for (int i = 0; i < 8; ++i)
+        bb.expandBy(osg::Vec3d(i & 1 ? 1.0 : -1.0, i & 2 ? 1.0 : -1.0, i & 4 ? 1.0 : -1.0) * toCachedClipSpace);
+
+    // it has to be covered by the cache, and the cache must not have a much lower resolution than a new shadow map would have
+    return bb.xMin() >= -1.0 && bb.xMax() <= 1.0 && bb.yMin() >= -1.0 && bb.yMax() <= 1.0
+        && bb.xMax() - bb.xMin() >= 1.0 && bb.yMax() - bb.yMin() >= 1.0;
+}
+
 osg::StateSet* MWShadowTechnique::selectStateSetForRenderingShadow(ViewDependentData& vdd, unsigned int traversalNumber) const
 {
     OSG_INFO<<"   selectStateSetForRenderingShadow() "<<vdd.getStateSet(traversalNumber)<<std::endl;
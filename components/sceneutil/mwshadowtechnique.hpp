@@ -20,6 +20,7 @@
 #define COMPONENTS_SCENEUTIL_MWSHADOWTECHNIQUE_H 1
 
 #include <array>
+#include <atomic>
 #include <mutex>
 
 #include <osg/Camera>
@@ -87,6 +88,15 @@ namespace SceneUtil {
 
         virtual void setupCastingShader(Shader::ShaderManager &shaderManager);
 
+        /** Render casters matching staticCasterMask into a cached shadow map that is only refreshed when the light direction changes or the
+          * shadow map no longer covers the view. Casters matching dynamicCasterMask are rendered on top of the cached map every frame.
+          * Only supported for orthographic shadow maps.*/
+        virtual void enableStaticCasterCaching(unsigned int staticCasterMask, unsigned int dynamicCasterMask);
+
+        /** Refresh the cached shadow maps of static casters in the next frame, for example after static objects were added, moved or removed.
+          * May be called while the cull traversal is running.*/
+        virtual void invalidateStaticCasterCache();
+
         class ComputeLightSpaceBounds : public osg::NodeVisitor, public osg::CullStack
         {
         public:
@@ -176,6 +186,21 @@ namespace SceneUtil {
             osg::ref_ptr<osg::Texture2D>        _texture;
             osg::ref_ptr<osg::TexGen>           _texgen;
             osg::ref_ptr<osg::Camera>           _camera;
+
+            // static caster cache, see enableStaticCasterCaching
+            void createStaticCache(osg::Program* compositeProgram);
+
+            osg::ref_ptr<osg::Texture2D>        _staticTexture;
+            osg::ref_ptr<osg::Camera>           _staticCamera;
+            osg::ref_ptr<osg::Geometry>         _staticCompositeQuad;
+            osg::Matrixd                        _staticViewMatrix;
+            osg::Matrixd                        _staticProjectionMatrix;
+            unsigned int                        _staticCacheFrameNumber;
+            unsigned int                        _staticCacheGeneration;
+            // number of frames the cached map was reused since it was rendered
+            unsigned int                        _staticCacheUses;
+            // caching is suspended until this frame when cached maps had to be refreshed right after rendering them
+            unsigned int                        _staticCacheRetryFrameNumber;
         };
 
         typedef std::list< osg::ref_ptr<ShadowData> > ShadowDataList;
@@ -229,7 +254,9 @@ namespace SceneUtil {
 
         virtual void cullShadowReceivingScene(osgUtil::CullVisitor* cv) const;
 
-        virtual void cullShadowCastingScene(osgUtil::CullVisitor* cv, osg::Camera* camera) const;
+        virtual void cullShadowCastingScene(osgUtil::CullVisitor* cv, osg::Camera* camera, unsigned int castsShadowTraversalMask) const;
+
+        bool isStaticCacheUsable(const ShadowData& sd, const osg::Matrixd& viewMatrix, const osg::Matrixd& projectionMatrix, unsigned int traversalNumber) const;
 
         virtual osg::StateSet* selectStateSetForRenderingShadow(ViewDependentData& vdd, unsigned int traversalNumber) const;
 
@@ -263,6 +290,12 @@ namespace SceneUtil {
 
         float                                   _shadowFadeStart = 0.0;
 
+        bool                                    _staticCasterCaching = false;
+        unsigned int                            _staticCasterMask = 0;
+        unsigned int                            _dynamicCasterMask = 0;
+        std::atomic<unsigned int>               _staticCasterCacheGeneration{0};
+        osg::ref_ptr<osg::Program>              _staticCompositeProgram;
+
         class DebugHUD final : public osg::Referenced
         {
         public:
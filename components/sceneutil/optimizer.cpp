@@ -17,6 +17,7 @@
 #include <string.h>
 
 #include "optimizer.hpp"
+#include "workqueue.hpp"
 
 #include <osg/Version>
 #include <osg/Transform>
@@ -36,12 +37,97 @@
 
 #include <typeinfo>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <numeric>
 
 #include <iterator>
 
 using namespace osgUtil;
 
+namespace
+{
+    template <class T>
+    void sortUnique(std::vector<T>& list)
+    {
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+
+    /// Shared by parallelFor and the work items helping it, a work item may only start after parallelFor has returned.
+    class ParallelForState : public osg::Referenced
+    {
+    public:
+        ParallelForState(std::size_t count, const std::function<void(std::size_t)>& function)
+            : mCount(count), mFunction(function), mNext(0), mDone(0) {}
+
+        /// Calls the function for indices that are not taken yet, does not touch the function after all indices are taken.
+        void run()
+        {
+            for (std::size_t i = mNext++; i < mCount; i = mNext++)
+            {
+                mFunction(i);
+                if (++mDone == mCount)
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mCondition.notify_all();
+                }
+            }
+        }
+
+        /// Waits until every index that was taken is done.
+        void wait()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mDone == mCount; });
+        }
+
+    private:
+        const std::size_t mCount;
+        const std::function<void(std::size_t)>& mFunction;
+        std::atomic<std::size_t> mNext;
+        std::atomic<std::size_t> mDone;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+    };
+
+    class ParallelForWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        ParallelForWorkItem(ParallelForState* state) : mState(state) {}
+
+        void doWork() override
+        {
+            mState->run();
+        }
+
+    private:
+        osg::ref_ptr<ParallelForState> mState;
+    };
+
+    /// Calls function(i) for every i in [0, count) on the calling thread and up to numThreads-1 items of the work queue.
+    /// The calling thread only waits for indices a helper has already started, so it may be a thread of the work queue itself.
+    /// The function must only modify data that belongs to its own index.
+    void parallelFor(std::size_t count, SceneUtil::WorkQueue* workQueue, unsigned int numThreads, const std::function<void(std::size_t)>& function)
+    {
+        const std::size_t numWorkers = std::min<std::size_t>(numThreads, count);
+        if (!workQueue || numWorkers <= 1)
+        {
+            for (std::size_t i=0; i<count; ++i)
+                function(i);
+            return;
+        }
+
+        osg::ref_ptr<ParallelForState> state = new ParallelForState(count, function);
+        for (std::size_t i=1; i<numWorkers; ++i)
+            workQueue->addWorkItem(new ParallelForWorkItem(state), true);
+        state->run();
+        state->wait();
+    }
+}
+
 namespace SceneUtil
 {
 
@@ -264,13 +350,14 @@ class CollectLowestTransformsVisitor : public BaseOptimizerVisitor
 
         struct TransformStruct
         {
-            typedef std::set<osg::Object*> ObjectSet;
+            typedef std::vector<osg::Object*> ObjectSet;
 
             TransformStruct():_canBeApplied(true) {}
 
+            // objects are unique, since each object lists a transform only once
             void add(osg::Object* obj)
             {
-                _objectSet.insert(obj);
+                _objectSet.push_back(obj);
             }
 
             bool        _canBeApplied;
@@ -279,7 +366,7 @@ class CollectLowestTransformsVisitor : public BaseOptimizerVisitor
 
         struct ObjectStruct
         {
-            typedef std::set<osg::Transform*> TransformSet;
+            typedef std::vector<osg::Transform*> TransformSet;
 
             ObjectStruct():_canBeApplied(true),_moreThanOneMatrixRequired(false) {}
 
@@ -308,7 +395,8 @@ class CollectLowestTransformsVisitor : public BaseOptimizerVisitor
                     }
 
                 }
-                _transformSet.insert(transform);
+                if (std::find(_transformSet.begin(), _transformSet.end(), transform) == _transformSet.end())
+                    _transformSet.push_back(transform);
             }
 
             bool            _canBeApplied;
@@ -339,6 +427,7 @@ class CollectLowestTransformsVisitor : public BaseOptimizerVisitor
 
         void disableObject(ObjectMap::iterator itr);
         void doTransform(osg::Object* obj,osg::Matrix& matrix);
+        void transformDrawable(osg::Drawable& drawable, const osg::Matrix& matrix);
 
         osgUtil::TransformAttributeFunctor _transformFunctor;
         TransformMap    _transformMap;
@@ -356,22 +445,7 @@ void CollectLowestTransformsVisitor::doTransform(osg::Object* obj,osg::Matrix& m
     osg::Drawable* drawable = node->asDrawable();
     if (drawable)
     {
-        osgUtil::TransformAttributeFunctor tf(matrix);
-        drawable->accept(tf);
-
-        osg::Geometry *geom = drawable->asGeometry();
-        osg::Vec4Array* tangents = geom ? dynamic_cast<osg::Vec4Array*>(geom->getTexCoordArray(7)) : nullptr;
-        if (tangents)
-        {
-            for (unsigned int i=0; i<tangents->size(); ++i)
-            {
-                osg::Vec4f& itr = (*tangents)[i];
-                osg::Vec3f vec3 (itr.x(), itr.y(), itr.z());
-                vec3 = osg::Matrix::transform3x3(tf._im, vec3);
-                vec3.normalize();
-                itr = osg::Vec4f(vec3.x(), vec3.y(), vec3.z(), itr.w());
-            }
-        }
+        transformDrawable(*drawable, matrix);
 
         drawable->dirtyBound();
         drawable->dirtyDisplayList();
@@ -432,6 +506,26 @@ void CollectLowestTransformsVisitor::doTransform(osg::Object* obj,osg::Matrix& m
     }
 }
 
+void CollectLowestTransformsVisitor::transformDrawable(osg::Drawable& drawable, const osg::Matrix& matrix)
+{
+    osgUtil::TransformAttributeFunctor tf(matrix);
+    drawable.accept(tf);
+
+    osg::Geometry *geom = drawable.asGeometry();
+    osg::Vec4Array* tangents = geom ? dynamic_cast<osg::Vec4Array*>(geom->getTexCoordArray(7)) : nullptr;
+    if (tangents)
+    {
+        for (unsigned int i=0; i<tangents->size(); ++i)
+        {
+            osg::Vec4f& itr = (*tangents)[i];
+            osg::Vec3f vec3 (itr.x(), itr.y(), itr.z());
+            vec3 = osg::Matrix::transform3x3(tf._im, vec3);
+            vec3.normalize();
+            itr = osg::Vec4f(vec3.x(), vec3.y(), vec3.z(), itr.w());
+        }
+    }
+}
+
 void CollectLowestTransformsVisitor::disableObject(ObjectMap::iterator itr)
 {
     if (itr==_objectMap.end())
@@ -521,19 +615,36 @@ void CollectLowestTransformsVisitor::setUpMaps()
 
 bool CollectLowestTransformsVisitor::removeTransforms(osg::Node* nodeWeCannotRemove)
 {
-    // transform the objects that can be applied.
+    // transform the objects that can be applied. Drawables own their arrays by now, so they are transformed in parallel.
+    // Dirtying a bound also dirties the parents, which drawables may share, so their bounds are dirtied after the join.
+    std::vector<std::pair<osg::Drawable*, ObjectStruct*> > drawablesToTransform;
+    drawablesToTransform.reserve(_objectMap.size());
     for(ObjectMap::iterator oitr=_objectMap.begin();
         oitr!=_objectMap.end();
         ++oitr)
     {
-        osg::Object* object = oitr->first;
-        ObjectStruct& os = oitr->second;
-        if (os._canBeApplied)
+        if (oitr->second._canBeApplied)
         {
-            doTransform(object,os._firstMatrix);
+            osg::Node* node = oitr->first->asNode();
+            osg::Drawable* drawable = node ? node->asDrawable() : nullptr;
+            if (drawable)
+                drawablesToTransform.emplace_back(drawable, &oitr->second);
+            else
+                doTransform(oitr->first, oitr->second._firstMatrix);
         }
     }
 
+    parallelFor(drawablesToTransform.size(), getWorkQueue(), getNumThreads(), [&] (std::size_t i)
+    {
+        transformDrawable(*drawablesToTransform[i].first, drawablesToTransform[i].second->_firstMatrix);
+    });
+
+    for (const auto& pair : drawablesToTransform)
+    {
+        pair.first->dirtyBound();
+        pair.first->dirtyDisplayList();
+    }
+
 
     bool transformRemoved = false;
 
@@ -636,14 +747,14 @@ void Optimizer::FlattenStaticTransformsVisitor::apply(osg::Drawable& drawable)
         if(geometry->getTexCoordArray(7) && geometry->getTexCoordArray(7)->referenceCount() > 1) // tangents
             geometry->setTexCoordArray(7, cloneArray(geometry->getTexCoordArray(7), vbo, geometry));
     }
-    _drawableSet.insert(&drawable);
+    _drawableSet.push_back(&drawable);
 }
 
 void Optimizer::FlattenStaticTransformsVisitor::apply(osg::Billboard& billboard)
 {
     if (!_transformStack.empty())
     {
-        _billboardSet.insert(&billboard);
+        _billboardSet.push_back(&billboard);
     }
 }
 
@@ -652,7 +763,7 @@ void Optimizer::FlattenStaticTransformsVisitor::apply(osg::Transform& transform)
     if (!_transformStack.empty())
     {
         // we need to disable any transform higher in the list.
-        _transformSet.insert(_transformStack.back());
+        _transformSet.push_back(_transformStack.back());
     }
 
     _transformStack.push_back(&transform);
@@ -667,6 +778,11 @@ bool Optimizer::FlattenStaticTransformsVisitor::removeTransforms(osg::Node* node
 {
     CollectLowestTransformsVisitor cltv(_optimizer);
 
+    sortUnique(_excludedNodeSet);
+    sortUnique(_drawableSet);
+    sortUnique(_billboardSet);
+    sortUnique(_transformSet);
+
     for(NodeSet::iterator nitr=_excludedNodeSet.begin();
         nitr!=_excludedNodeSet.end();
         ++nitr)
@@ -714,7 +830,7 @@ void Optimizer::CombineStaticTransformsVisitor::apply(osg::MatrixTransform& tran
         transform.getChild(0)->asTransform()->getDataVariance()==osg::Object::STATIC &&
         isOperationPermissibleForObject(&transform) && isOperationPermissibleForObject(transform.getChild(0)))
     {
-        _transformSet.insert(&transform);
+        _transformSet.push_back(&transform);
     }
 
     traverse(transform);
@@ -722,20 +838,23 @@ void Optimizer::CombineStaticTransformsVisitor::apply(osg::MatrixTransform& tran
 
 bool Optimizer::CombineStaticTransformsVisitor::removeTransforms(osg::Node* nodeWeCannotRemove)
 {
+    sortUnique(_transformSet);
+
     if (nodeWeCannotRemove && nodeWeCannotRemove->asTransform()!=0 && nodeWeCannotRemove->asTransform()->asMatrixTransform()!=0)
     {
         // remove topmost node from transform set if it exists there.
-        TransformSet::iterator itr = _transformSet.find(nodeWeCannotRemove->asTransform()->asMatrixTransform());
-        if (itr!=_transformSet.end()) _transformSet.erase(itr);
+        TransformSet::iterator itr = std::lower_bound(_transformSet.begin(), _transformSet.end(), nodeWeCannotRemove->asTransform()->asMatrixTransform());
+        if (itr!=_transformSet.end() && *itr==nodeWeCannotRemove) _transformSet.erase(itr);
     }
 
     bool transformRemoved = false;
 
-    while (!_transformSet.empty())
+    TransformSet transformSet;
+    transformSet.swap(_transformSet);
+    for (osg::MatrixTransform* transformToCombine : transformSet)
     {
-        // get the first available transform to combine.
-        osg::ref_ptr<osg::MatrixTransform> transform = *_transformSet.begin();
-        _transformSet.erase(_transformSet.begin());
+        // get the next available transform to combine.
+        osg::ref_ptr<osg::MatrixTransform> transform = transformToCombine;
 
         if (transform->getNumChildren()==1 &&
             transform->getChild(0)->asTransform()!=0 &&
@@ -782,7 +901,7 @@ void Optimizer::RemoveEmptyNodesVisitor::apply(osg::Group& group)
             (typeid(group)==typeid(osg::Group) || (group.asTransform())) &&
             (group.getNumChildrenRequiringUpdateTraversal()==0 && group.getNumChildrenRequiringEventTraversal()==0) )
         {
-            _redundantNodeList.insert(&group);
+            _redundantNodeList.push_back(&group);
         }
     }
     traverse(group);
@@ -796,6 +915,8 @@ void Optimizer::RemoveEmptyNodesVisitor::removeEmptyNodes()
     // keep iterator through until scene graph is cleaned of empty nodes.
     while (!_redundantNodeList.empty())
     {
+        sortUnique(_redundantNodeList);
+
         for(NodeList::iterator itr=_redundantNodeList.begin();
             itr!=_redundantNodeList.end();
             ++itr)
@@ -814,7 +935,7 @@ void Optimizer::RemoveEmptyNodesVisitor::removeEmptyNodes()
                 if (!parent->asSwitch() && !dynamic_cast<osg::LOD*>(parent))
                 {
                     parent->removeChild(nodeToRemove.get());
-                    if (parent->getNumChildren()==0 && isOperationPermissibleForObject(parent)) newEmptyGroups.insert(parent);
+                    if (parent->getNumChildren()==0 && isOperationPermissibleForObject(parent)) newEmptyGroups.push_back(parent);
                 }
             }
         }
@@ -858,7 +979,7 @@ void Optimizer::RemoveRedundantNodesVisitor::apply(osg::Group& group)
     if (typeid(group)==typeid(osg::Group) &&
         isOperationPermissible(group))
     {
-        _redundantNodeList.insert(&group);
+        _redundantNodeList.push_back(&group);
     }
 
     traverse(group);
@@ -875,7 +996,7 @@ void Optimizer::RemoveRedundantNodesVisitor::apply(osg::Transform& transform)
         transform.computeWorldToLocalMatrix(matrix,nullptr);
         if (matrix.isIdentity())
         {
-            _redundantNodeList.insert(&transform);
+            _redundantNodeList.push_back(&transform);
         }
     }
     traverse(transform);
@@ -884,6 +1005,7 @@ void Optimizer::RemoveRedundantNodesVisitor::apply(osg::Transform& transform)
 
 void Optimizer::RemoveRedundantNodesVisitor::removeRedundantNodes()
 {
+    sortUnique(_redundantNodeList);
 
     for(NodeList::iterator itr=_redundantNodeList.begin();
         itr!=_redundantNodeList.end();
@@ -1333,17 +1455,22 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
                         lgvp._viewPoint = _viewPoint;
                         std::sort(duplicateList.begin(), duplicateList.end(), lgvp);
                     }
-                    DuplicateList::iterator ditr = duplicateList.begin();
-                    osg::ref_ptr<osg::Geometry> lhs = *ditr++;
-                    group.addChild(lhs.get());
-                    for(;
-                        ditr != duplicateList.end();
-                        ++ditr)
-                    {
-                        mergeGeometry(*lhs, **ditr);
-                    }
+                    group.addChild(duplicateList.front().get());
                 }
             }
+
+            // every list is merged into its own first geometry, shared arrays are copied on write, so the lists can be merged in parallel.
+            // Dirtying a bound also dirties the parents, so the bounds are dirtied up front, which keeps the dirtying while merging local to each geometry.
+            for (DuplicateList& duplicateList : mergeList)
+                if (duplicateList.size() > 1)
+                    duplicateList.front()->dirtyBound();
+
+            parallelFor(mergeList.size(), getWorkQueue(), getNumThreads(), [&] (std::size_t i)
+            {
+                DuplicateList& duplicateList = mergeList[i];
+                for (std::size_t j=1; j<duplicateList.size(); ++j)
+                    mergeGeometry(*duplicateList.front(), *duplicateList[j]);
+            });
         }
 
     }
@@ -1403,9 +1530,8 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
 #if 1
                 bool doneCombine = false;
 
-                std::set<osg::PrimitiveSet*> toremove;
-
                 osg::Geometry::PrimitiveSetList& primitives = geom->getPrimitiveSetList();
+                std::vector<bool> toremove(primitives.size(), false);
                 unsigned int lhsNo=0;
                 unsigned int rhsNo=1;
                 while(rhsNo<primitives.size())
@@ -1462,7 +1588,7 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
                     if (combine)
                     {
                         // make this primitive set as invalid and needing cleaning up.
-                        toremove.insert(rhs);
+                        toremove[rhsNo] = true;
                         doneCombine = true;
                         ++rhsNo;
                     }
@@ -1482,11 +1608,9 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
                     primitives.swap(oldPrimitives);
 
                     // now add the active primitive sets
-                    for(osg::Geometry::PrimitiveSetList::iterator pitr = oldPrimitives.begin();
-                        pitr != oldPrimitives.end();
-                        ++pitr)
+                    for(unsigned int primNo=0; primNo<oldPrimitives.size(); ++primNo)
                     {
-                        if (!toremove.count(*pitr)) primitives.push_back(*pitr);
+                        if (!toremove[primNo]) primitives.push_back(oldPrimitives[primNo]);
                     }
                 }
     #endif
@@ -1922,7 +2046,7 @@ void Optimizer::MergeGroupsVisitor::apply(osg::Group &group)
         traverse(group);
     else
     {
-        typedef std::map<osg::StateSet*, std::set<osg::Group*> > GroupMap;
+        typedef std::map<osg::StateSet*, std::vector<osg::Group*> > GroupMap;
         GroupMap childGroups;
         for (unsigned int i=0; i<group.getNumChildren(); ++i)
         {
@@ -1930,19 +2054,21 @@ void Optimizer::MergeGroupsVisitor::apply(osg::Group &group)
             osg::Group* childGroup = child->asGroup();
             if (childGroup && isOperationPermissible(*childGroup))
             {
-                childGroups[childGroup->getStateSet()].insert(childGroup);
+                std::vector<osg::Group*>& groups = childGroups[childGroup->getStateSet()];
+                if (std::find(groups.begin(), groups.end(), childGroup) == groups.end())
+                    groups.push_back(childGroup);
             }
         }
 
         for (GroupMap::iterator it = childGroups.begin(); it != childGroups.end(); ++it)
         {
-            const std::set<osg::Group*>& groupSet = it->second;
+            const std::vector<osg::Group*>& groupSet = it->second;
             if (groupSet.size() <= 1)
                 continue;
             else
             {
-                osg::Group* first = *groupSet.begin();
-                for (std::set<osg::Group*>::const_iterator groupIt = ++groupSet.begin(); groupIt != groupSet.end(); ++groupIt)
+                osg::Group* first = groupSet.front();
+                for (std::vector<osg::Group*>::const_iterator groupIt = groupSet.begin() + 1; groupIt != groupSet.end(); ++groupIt)
                 {
                     osg::Group* toMerge = *groupIt;
                     for (unsigned int i=0; i<toMerge->getNumChildren(); ++i)
@@ -24,13 +24,16 @@
 
 //#include <osgUtil/Export>
 
+#include <algorithm>
 #include <set>
+#include <vector>
 
 //namespace osgUtil {
 namespace SceneUtil {
 
 // forward declare
 class Optimizer;
+class WorkQueue;
 
 /** Helper base class for implementing Optimizer techniques.*/
 class BaseOptimizerVisitor : public osg::NodeVisitor
@@ -50,6 +53,9 @@ class BaseOptimizerVisitor : public osg::NodeVisitor
         inline bool isOperationPermissibleForObject(const osg::Drawable* object) const;
         inline bool isOperationPermissibleForObject(const osg::Node* object) const;
 
+        inline unsigned int getNumThreads() const;
+        inline WorkQueue* getWorkQueue() const;
+
     protected:
 
         Optimizer*      _optimizer;
@@ -65,7 +71,7 @@ class Optimizer
 
     public:
 
-        Optimizer() : _mergeAlphaBlending(false) {}
+        Optimizer() : _mergeAlphaBlending(false), _numThreads(1), _workQueue(nullptr) {}
         virtual ~Optimizer() {}
 
         enum OptimizationOptions
@@ -121,6 +127,15 @@ class Optimizer
         void setMergeAlphaBlending(bool merge) { _mergeAlphaBlending = merge; }
         void setViewPoint(const osg::Vec3f& viewPoint) { _viewPoint = viewPoint; }
 
+        /** Set the number of threads, including the calling thread, used for the passes that work on independent objects,
+          * i.e. applying flattened transforms and merging geometries. Defaults to 1. The other threads are taken from the work queue.*/
+        void setNumThreads(unsigned int numThreads) { _numThreads = std::max(1u, numThreads); }
+        unsigned int getNumThreads() const { return _numThreads; }
+
+        /** Set the work queue that helps the calling thread, which may be one of its threads. Without a work queue everything runs on the calling thread.*/
+        void setWorkQueue(WorkQueue* workQueue) { _workQueue = workQueue; }
+        WorkQueue* getWorkQueue() const { return _workQueue; }
+
         /** Reset internal data to initial state - the getPermissibleOptionsMap is cleared.*/
         void reset();
 
@@ -257,6 +272,8 @@ class Optimizer
 
         osg::Vec3f _viewPoint;
         bool _mergeAlphaBlending;
+        unsigned int _numThreads;
+        WorkQueue* _workQueue;
 
     public:
 
@@ -283,10 +300,11 @@ class Optimizer
             protected:
 
                 typedef std::vector<osg::Transform*>                TransformStack;
-                typedef std::set<osg::Drawable*>                    DrawableSet;
-                typedef std::set<osg::Billboard*>                   BillboardSet;
-                typedef std::set<osg::Node* >                       NodeSet;
-                typedef std::set<osg::Transform*>                   TransformSet;
+                // Flat lists that may contain duplicates, they are sorted and made unique before use.
+                typedef std::vector<osg::Drawable*>                 DrawableSet;
+                typedef std::vector<osg::Billboard*>                BillboardSet;
+                typedef std::vector<osg::Node* >                    NodeSet;
+                typedef std::vector<osg::Transform*>                TransformSet;
 
                 TransformStack  _transformStack;
                 NodeSet         _excludedNodeSet;
@@ -310,7 +328,7 @@ class Optimizer
 
             protected:
 
-                typedef std::set<osg::MatrixTransform*> TransformSet;
+                typedef std::vector<osg::MatrixTransform*> TransformSet;
                 TransformSet  _transformSet;
         };
 
@@ -320,7 +338,7 @@ class Optimizer
             public:
 
 
-                typedef std::set<osg::Node*> NodeList;
+                typedef std::vector<osg::Node*> NodeList;
                 NodeList                     _redundantNodeList;
 
                 RemoveEmptyNodesVisitor(Optimizer* optimizer=0):
@@ -337,7 +355,7 @@ class Optimizer
         {
             public:
 
-                typedef std::set<osg::Node*> NodeList;
+                typedef std::vector<osg::Node*> NodeList;
                 NodeList                     _redundantNodeList;
 
                 RemoveRedundantNodesVisitor(Optimizer* optimizer=0):
@@ -426,6 +444,16 @@ class Optimizer
 
 };
 
+inline unsigned int BaseOptimizerVisitor::getNumThreads() const
+{
+    return _optimizer ? _optimizer->getNumThreads() : 1;
+}
+
+inline WorkQueue* BaseOptimizerVisitor::getWorkQueue() const
+{
+    return _optimizer ? _optimizer->getWorkQueue() : nullptr;
+}
+
 inline bool BaseOptimizerVisitor::isOperationPermissibleForObject(const osg::StateSet* object) const
 {
     return _optimizer ? _optimizer->isOperationPermissibleForObject(object,_operationType) :  true;
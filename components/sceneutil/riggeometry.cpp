@@ -1,18 +1,22 @@
 #include "riggeometry.hpp"
 
+#include <algorithm>
+
 #include <osg/Version>
 
+#include <osgUtil/CullVisitor>
+
 #include <components/debug/debuglog.hpp>
+#include <components/shader/shadermanager.hpp>
 
 #include "skeleton.hpp"
 #include "util.hpp"
 
 namespace
 {
-    inline void accumulateMatrix(const osg::Matrixf& invBindMatrix, const osg::Matrixf& matrix, const float weight, osg::Matrixf& result)
+    inline void accumulateMatrix(const osg::Matrixf& matrix, const float weight, osg::Matrixf& result)
     {
-        osg::Matrixf m = invBindMatrix * matrix;
-        float* ptr = m.ptr();
+        const float* ptr = matrix.ptr();
         float* ptrresult = result.ptr();
         ptrresult[0] += ptr[0] * weight;
         ptrresult[1] += ptr[1] * weight;
@@ -30,6 +34,21 @@ namespace
         ptrresult[13] += ptr[13] * weight;
         ptrresult[14] += ptr[14] * weight;
     }
+
+    // Same as osg::Matrixf::preMult, but without the perspective divide, the skinning matrices are always affine
+    inline osg::Vec3f transformPoint(const float* m, const osg::Vec3f& v)
+    {
+        return osg::Vec3f(v.x() * m[0] + v.y() * m[4] + v.z() * m[8] + m[12],
+                          v.x() * m[1] + v.y() * m[5] + v.z() * m[9] + m[13],
+                          v.x() * m[2] + v.y() * m[6] + v.z() * m[10] + m[14]);
+    }
+
+    inline osg::Vec3f transformDirection(const float* m, const osg::Vec3f& v)
+    {
+        return osg::Vec3f(v.x() * m[0] + v.y() * m[4] + v.z() * m[8],
+                          v.x() * m[1] + v.y() * m[5] + v.z() * m[9],
+                          v.x() * m[2] + v.y() * m[6] + v.z() * m[10]);
+    }
 }
 
 namespace SceneUtil
@@ -37,6 +56,7 @@ namespace SceneUtil
 
 RigGeometry::RigGeometry()
     : mSkeleton(nullptr)
+    , mGpuSkinning(false)
     , mLastFrameNumber(0)
     , mBoundsFirstFrame(true)
 {
@@ -48,6 +68,10 @@ RigGeometry::RigGeometry(const RigGeometry &copy, const osg::CopyOp &copyop)
     : Drawable(copy, copyop)
     , mSkeleton(nullptr)
     , mInfluenceMap(copy.mInfluenceMap)
+    , mGpuSkinning(copy.mGpuSkinning)
+    , mShadowCastingStateSet(copy.mShadowCastingStateSet)
+    , mBoneIndices(copy.mBoneIndices)
+    , mBoneWeights(copy.mBoneWeights)
     , mBone2VertexVector(copy.mBone2VertexVector)
     , mBoneSphereVector(copy.mBoneSphereVector)
     , mLastFrameNumber(0)
@@ -72,37 +96,58 @@ void RigGeometry::setSourceGeometry(osg::ref_ptr<osg::Geometry> sourceGeometry)
         to.setComputeBoundingBoxCallback(new CopyBoundingBoxCallback());
         to.setComputeBoundingSphereCallback(new CopyBoundingSphereCallback());
 
-        // vertices and normals are modified every frame, so we need to deep copy them.
-        // assign a dedicated VBO to make sure that modifications don't interfere with source geometry's VBO.
-        osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
-        vbo->setUsage(GL_DYNAMIC_DRAW_ARB);
-
-        osg::ref_ptr<osg::Array> vertexArray = static_cast<osg::Array*>(from.getVertexArray()->clone(osg::CopyOp::DEEP_COPY_ALL));
-        if (vertexArray)
+        if (mGpuSkinning)
         {
-            vertexArray->setVertexBufferObject(vbo);
-            to.setVertexArray(vertexArray);
-        }
+            // vertices stay the same, the skinning is done in the vertex shader
+            to.setVertexAttribArray(sBoneIndicesLocation, mBoneIndices, osg::Array::BIND_PER_VERTEX);
+            to.setVertexAttribArray(sBoneWeightsLocation, mBoneWeights, osg::Array::BIND_PER_VERTEX);
+
+            // the program is set on the StateSet of the RigGeometry, so that recreating the shaders of the object replaces it
+            osg::ref_ptr<osg::StateSet> stateset = from.getStateSet() ? new osg::StateSet(*from.getStateSet(), osg::CopyOp::SHALLOW_COPY) : new osg::StateSet;
+
+            // the last matrix is used for vertices that are not influenced by any bones
+            const unsigned int numBones = mInfluenceMap->mData.size();
+            mBoneMatrices[i] = new osg::Uniform(osg::Uniform::FLOAT_MAT4, "boneMatrices", numBones + 1);
+            mBoneMatrices[i]->setElement(numBones, osg::Matrixf());
+            stateset->addUniform(mBoneMatrices[i]);
+            to.setStateSet(stateset);
 
-        if (const osg::Array* normals = from.getNormalArray())
+            mSourceTangents = nullptr;
+        }
+        else
         {
-            osg::ref_ptr<osg::Array> normalArray = static_cast<osg::Array*>(normals->clone(osg::CopyOp::DEEP_COPY_ALL));
-            if (normalArray)
+            // vertices and normals are modified every frame, so we need to deep copy them.
+            // assign a dedicated VBO to make sure that modifications don't interfere with source geometry's VBO.
+            osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
+            vbo->setUsage(GL_DYNAMIC_DRAW_ARB);
+
+            osg::ref_ptr<osg::Array> vertexArray = static_cast<osg::Array*>(from.getVertexArray()->clone(osg::CopyOp::DEEP_COPY_ALL));
+            if (vertexArray)
             {
-                normalArray->setVertexBufferObject(vbo);
-                to.setNormalArray(normalArray, osg::Array::BIND_PER_VERTEX);
+                vertexArray->setVertexBufferObject(vbo);
+                to.setVertexArray(vertexArray);
             }
-        }
 
-        if (const osg::Vec4Array* tangents = dynamic_cast<const osg::Vec4Array*>(from.getTexCoordArray(7)))
-        {
-            mSourceTangents = tangents;
-            osg::ref_ptr<osg::Array> tangentArray = static_cast<osg::Array*>(tangents->clone(osg::CopyOp::DEEP_COPY_ALL));
-            tangentArray->setVertexBufferObject(vbo);
-            to.setTexCoordArray(7, tangentArray, osg::Array::BIND_PER_VERTEX);
+            if (const osg::Array* normals = from.getNormalArray())
+            {
+                osg::ref_ptr<osg::Array> normalArray = static_cast<osg::Array*>(normals->clone(osg::CopyOp::DEEP_COPY_ALL));
+                if (normalArray)
+                {
+                    normalArray->setVertexBufferObject(vbo);
+                    to.setNormalArray(normalArray, osg::Array::BIND_PER_VERTEX);
+                }
+            }
+
+            if (const osg::Vec4Array* tangents = dynamic_cast<const osg::Vec4Array*>(from.getTexCoordArray(7)))
+            {
+                mSourceTangents = tangents;
+                osg::ref_ptr<osg::Array> tangentArray = static_cast<osg::Array*>(tangents->clone(osg::CopyOp::DEEP_COPY_ALL));
+                tangentArray->setVertexBufferObject(vbo);
+                to.setTexCoordArray(7, tangentArray, osg::Array::BIND_PER_VERTEX);
+            }
+            else
+                mSourceTangents = nullptr;
         }
-        else
-            mSourceTangents = nullptr;
     }
 }
 
@@ -150,23 +195,7 @@ bool RigGeometry::initFromParentSkeleton(osg::NodeVisitor* nv)
 
         mBoneNodesVector.push_back(bone);
     }
-
-    for (auto& pair : mBone2VertexVector->mData)
-    {
-        for (auto &weight : pair.first)
-        {
-            const std::string& boneName = weight.first.first;
-            Bone* bone = mSkeleton->getBone(boneName);
-            if (!bone)
-            {
-                mBoneNodesVector.push_back(nullptr);
-                Log(Debug::Error) << "Error: RigGeometry did not find bone " << boneName;
-                continue;
-            }
-
-            mBoneNodesVector.push_back(bone);
-        }
-    }
+    mSkinMatrices.resize(mBoneNodesVector.size());
 
     return true;
 }
@@ -182,29 +211,71 @@ void RigGeometry::cull(osg::NodeVisitor* nv)
     }
 
     unsigned int traversalNumber = nv->getTraversalNumber();
-    if (mLastFrameNumber == traversalNumber || (mLastFrameNumber != 0 && !mSkeleton->getActive()))
+    if (mLastFrameNumber == traversalNumber || (mLastFrameNumber != 0
+            && (!mSkeleton->getActive() || mSkeleton->isPoseUnchangedSince(mLastFrameNumber))))
     {
-        osg::Geometry& geom = *getGeometry(mLastFrameNumber);
-        nv->pushOntoNodePath(&geom);
-        nv->apply(geom);
-        nv->popFromNodePath();
+        cullGeometry(nv, *getGeometry(mLastFrameNumber));
         return;
     }
     mLastFrameNumber = traversalNumber;
     osg::Geometry& geom = *getGeometry(mLastFrameNumber);
 
     mSkeleton->updateBoneMatrices(traversalNumber);
+    updateSkinMatrices();
 
-    // skinning
-    const osg::Vec3Array* positionSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getVertexArray());
-    const osg::Vec3Array* normalSrc = static_cast<osg::Vec3Array*>(mSourceGeometry->getNormalArray());
-    const osg::Vec4Array* tangentSrc = mSourceTangents;
+    if (mGpuSkinning)
+        updateBoneMatrices(*mBoneMatrices[mLastFrameNumber%2]);
+    else
+        updateVertices(geom);
+
+    cullGeometry(nv, geom);
+}
+
+void RigGeometry::cullGeometry(osg::NodeVisitor* nv, osg::Geometry& geom)
+{
+    osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
+    const osg::Camera* camera = cv->getCurrentCamera();
+    const bool castingShadows = mShadowCastingStateSet && camera && dynamic_cast<const ShadowCastingCamera*>(camera->getUserData());
+    if (castingShadows)
+        cv->pushStateSet(mShadowCastingStateSet);
+
+    nv->pushOntoNodePath(&geom);
+    nv->apply(geom);
+    nv->popFromNodePath();
+
+    if (castingShadows)
+        cv->popStateSet();
+}
+
+void RigGeometry::updateSkinMatrices()
+{
+    // Bones are usually shared by many vertex groups, so only multiply with the inverse bind matrix once per bone
+    for (std::size_t i=0; i<mBoneNodesVector.size(); ++i)
+    {
+        Bone* bone = mBoneNodesVector[i];
+        if (bone == nullptr)
+            mSkinMatrices[i].makeIdentity();
+        else
+            mSkinMatrices[i] = mInfluenceMap->mData[i].second.mInvBindMatrix * bone->mMatrixInSkeletonSpace;
+    }
+}
+
+void RigGeometry::updateVertices(osg::Geometry& geom)
+{
+    // work on raw pointers, so that the inner loops do not go through the osg::MixinVector accessors
+    const osg::Vec3Array* positionArray = static_cast<const osg::Vec3Array*>(mSourceGeometry->getVertexArray());
+    const osg::Vec3Array* normalArray = static_cast<const osg::Vec3Array*>(mSourceGeometry->getNormalArray());
+    const osg::Vec3f* positionSrc = positionArray->asVector().data();
+    const osg::Vec3f* normalSrc = normalArray ? normalArray->asVector().data() : nullptr;
+    const osg::Vec4f* tangentSrc = mSourceTangents ? mSourceTangents->asVector().data() : nullptr;
 
     osg::Vec3Array* positionDst = static_cast<osg::Vec3Array*>(geom.getVertexArray());
     osg::Vec3Array* normalDst = static_cast<osg::Vec3Array*>(geom.getNormalArray());
     osg::Vec4Array* tangentDst = static_cast<osg::Vec4Array*>(geom.getTexCoordArray(7));
+    osg::Vec3f* positions = positionDst->asVector().data();
+    osg::Vec3f* normals = normalDst ? normalDst->asVector().data() : nullptr;
+    osg::Vec4f* tangents = tangentDst ? tangentDst->asVector().data() : nullptr;
 
-    int index = mBoneSphereVector->mData.size();
     for (auto &pair : mBone2VertexVector->mData)
     {
         osg::Matrixf resultMat (0, 0, 0, 0,
@@ -214,28 +285,30 @@ void RigGeometry::cull(osg::NodeVisitor* nv)
 
         for (auto &weight : pair.first)
         {
-            Bone* bone = mBoneNodesVector[index];
-            if (bone == nullptr)
-                continue;
-
-            accumulateMatrix(weight.first.second, bone->mMatrixInSkeletonSpace, weight.second, resultMat);
-            index++;
+            if (mBoneNodesVector[weight.first] != nullptr)
+                accumulateMatrix(mSkinMatrices[weight.first], weight.second, resultMat);
         }
 
         if (mGeomToSkelMatrix)
             resultMat *= (*mGeomToSkelMatrix);
 
-        for (auto &vertex : pair.second)
+        const float* matrix = resultMat.ptr();
+        const VertexList& vertices = pair.second;
+        for (unsigned short vertex : vertices)
+            positions[vertex] = transformPoint(matrix, positionSrc[vertex]);
+
+        if (normals)
         {
-            (*positionDst)[vertex] = resultMat.preMult((*positionSrc)[vertex]);
-            if (normalDst)
-                (*normalDst)[vertex] = osg::Matrixf::transform3x3((*normalSrc)[vertex], resultMat);
+            for (unsigned short vertex : vertices)
+                normals[vertex] = transformDirection(matrix, normalSrc[vertex]);
+        }
 
-            if (tangentDst)
+        if (tangents)
+        {
+            for (unsigned short vertex : vertices)
             {
-                const osg::Vec4f& srcTangent = (*tangentSrc)[vertex];
-                osg::Vec3f transformedTangent = osg::Matrixf::transform3x3(osg::Vec3f(srcTangent.x(), srcTangent.y(), srcTangent.z()), resultMat);
-                (*tangentDst)[vertex] = osg::Vec4f(transformedTangent, srcTangent.w());
+                const osg::Vec4f& srcTangent = tangentSrc[vertex];
+                tangents[vertex] = osg::Vec4f(transformDirection(matrix, osg::Vec3f(srcTangent.x(), srcTangent.y(), srcTangent.z())), srcTangent.w());
             }
         }
     }
@@ -249,10 +322,17 @@ void RigGeometry::cull(osg::NodeVisitor* nv)
 #if OSG_MIN_VERSION_REQUIRED(3, 5, 6)
     geom.dirtyGLObjects();
 #endif
+}
 
-    nv->pushOntoNodePath(&geom);
-    nv->apply(geom);
-    nv->popFromNodePath();
+void RigGeometry::updateBoneMatrices(osg::Uniform& uniform)
+{
+    for (std::size_t i=0; i<mSkinMatrices.size(); ++i)
+    {
+        if (mGeomToSkelMatrix && mBoneNodesVector[i] != nullptr)
+            uniform.setElement(i, mSkinMatrices[i] * (*mGeomToSkelMatrix));
+        else
+            uniform.setElement(i, mSkinMatrices[i]);
+    }
 }
 
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
@@ -273,15 +353,13 @@ void RigGeometry::updateBounds(osg::NodeVisitor *nv)
 
     osg::BoundingBox box;
 
-    int index = 0;
-    for (auto& boundPair : mBoneSphereVector->mData)
+    for (std::size_t index=0; index<mBoneSphereVector->mData.size(); ++index)
     {
         Bone* bone = mBoneNodesVector[index];
         if (bone == nullptr)
             continue;
 
-        index++;
-        osg::BoundingSpheref bs = boundPair.second;
+        osg::BoundingSpheref bs = mBoneSphereVector->mData[index].second;
         if (mGeomToSkelMatrix)
             transformBoundingSphere(bone->mMatrixInSkeletonSpace * (*mGeomToSkelMatrix), bs);
         else
@@ -342,17 +420,17 @@ void RigGeometry::setInfluenceMap(osg::ref_ptr<InfluenceMap> influenceMap)
     mBoneSphereVector = new BoneSphereVector;
     mBoneSphereVector->mData.reserve(mInfluenceMap->mData.size());
     mBone2VertexVector = new Bone2VertexVector;
-    for (auto& influencePair : mInfluenceMap->mData)
+    for (unsigned short boneIndex=0; boneIndex<mInfluenceMap->mData.size(); ++boneIndex)
     {
-        const std::string& boneName = influencePair.first;
-        const BoneInfluence& bi = influencePair.second;
+        const std::string& boneName = mInfluenceMap->mData[boneIndex].first;
+        const BoneInfluence& bi = mInfluenceMap->mData[boneIndex].second;
         mBoneSphereVector->mData.emplace_back(boneName, bi.mBoundSphere);
 
         for (auto& weightPair: bi.mWeights)
         {
             std::vector<BoneWeight>& vec = vertex2BoneMap[weightPair.first];
 
-            vec.emplace_back(std::make_pair(boneName, bi.mInvBindMatrix), weightPair.second);
+            vec.emplace_back(boneIndex, weightPair.second);
         }
     }
 
@@ -366,6 +444,65 @@ void RigGeometry::setInfluenceMap(osg::ref_ptr<InfluenceMap> influenceMap)
     mBone2VertexVector->mData.assign(bone2VertexMap.begin(), bone2VertexMap.end());
 }
 
+void RigGeometry::addSkinningAttribLocations(Shader::ShaderManager& shaderManager)
+{
+    shaderManager.addAttribLocation("boneIndices", sBoneIndicesLocation);
+    shaderManager.addAttribLocation("boneWeights", sBoneWeightsLocation);
+}
+
+unsigned int RigGeometry::getMaxGpuBones(int maxVertexUniformComponents)
+{
+    // Leave room for the matrices, lights, material and shadow uniforms of the object shader
+    const int reservedComponents = 768;
+    // Keep the bone matrix array reasonably small on drivers with generous limits, few meshes have that many bones
+    const int maxBones = 128;
+    return static_cast<unsigned int>(std::min(maxBones, std::max(0, (maxVertexUniformComponents - reservedComponents) / 16)));
+}
+
+bool RigGeometry::supportsGpuSkinning(unsigned int maxBones) const
+{
+    if (!mInfluenceMap || !mSourceGeometry || mInfluenceMap->mData.size() >= maxBones)
+        return false;
+
+    for (auto& pair : mBone2VertexVector->mData)
+    {
+        if (pair.first.size() > 4)
+            return false;
+    }
+    return true;
+}
+
+void RigGeometry::setGpuSkinning(bool enabled, osg::ref_ptr<osg::StateSet> shadowCastingStateSet)
+{
+    if (enabled && !mBoneIndices)
+    {
+        const unsigned int numVertices = mSourceGeometry->getVertexArray()->getNumElements();
+        const float unusedBone = static_cast<float>(mInfluenceMap->mData.size());
+        mBoneIndices = new osg::Vec4Array(numVertices, osg::Vec4f(unusedBone, unusedBone, unusedBone, unusedBone));
+        mBoneWeights = new osg::Vec4Array(numVertices, osg::Vec4f(1.f, 0.f, 0.f, 0.f));
+
+        std::vector<unsigned char> numInfluences(numVertices, 0);
+        for (unsigned int bone=0; bone<mInfluenceMap->mData.size(); ++bone)
+        {
+            for (auto& weight : mInfluenceMap->mData[bone].second.mWeights)
+            {
+                const unsigned short vertex = weight.first;
+                if (vertex >= numVertices || numInfluences[vertex] >= 4)
+                    continue;
+                if (numInfluences[vertex] == 0)
+                    (*mBoneWeights)[vertex] = osg::Vec4f();
+                (*mBoneIndices)[vertex][numInfluences[vertex]] = static_cast<float>(bone);
+                (*mBoneWeights)[vertex][numInfluences[vertex]] = weight.second;
+                ++numInfluences[vertex];
+            }
+        }
+    }
+
+    mGpuSkinning = enabled;
+    mShadowCastingStateSet = enabled ? shadowCastingStateSet : nullptr;
+    setSourceGeometry(mSourceGeometry);
+}
+
 void RigGeometry::accept(osg::NodeVisitor &nv)
 {
     if (!nv.validNodeMask(*this))
@@ -3,6 +3,12 @@
 
 #include <osg/Geometry>
 #include <osg/Matrixf>
+#include <osg/StateSet>
+
+namespace Shader
+{
+    class ShaderManager;
+}
 
 namespace SceneUtil
 {
@@ -14,6 +20,8 @@ namespace SceneUtil
     /// Note though that the RigGeometry ignores any transforms below the Skeleton, so the attachment point is not that important.
     /// @note The internal Geometry used for rendering is double buffered, this allows updates to be done in a thread safe way while
     /// not compromising rendering performance. This is crucial when using osg's default threading model of DrawThreadPerContext.
+    /// @note When GPU skinning is enabled, the vertices are transformed in the vertex shader and only the bone matrices
+    /// are updated each frame. Otherwise the skinning is done on the CPU.
     class RigGeometry : public osg::Drawable
     {
     public:
@@ -46,6 +54,37 @@ namespace SceneUtil
 
         osg::ref_ptr<osg::Geometry> getSourceGeometry() const;
 
+        /// Vertex attribute locations used by skinning.glsl.
+        static const unsigned int sBoneIndicesLocation = 6;
+        static const unsigned int sBoneWeightsLocation = 7;
+
+        /// Bind the vertex attributes of skinning.glsl to their locations in the programs created by the given ShaderManager.
+        static void addSkinningAttribLocations(Shader::ShaderManager& shaderManager);
+
+        /// @return The number of bone matrices that fit into the vertex shader uniforms next to the other uniforms of the object shader,
+        /// which is also the size of the bone matrix array in skinning.glsl.
+        /// @param maxVertexUniformComponents GL_MAX_VERTEX_UNIFORM_COMPONENTS of the graphics driver.
+        static unsigned int getMaxGpuBones(int maxVertexUniformComponents);
+
+        /// @return true if this geometry can be skinned in the vertex shader, i.e. it uses less than maxBones bones
+        /// and no vertex has more than 4 bone influences.
+        bool supportsGpuSkinning(unsigned int maxBones) const;
+
+        /// Skin this geometry in the vertex shader or on the CPU. The skinning variant of the object program must be set
+        /// on the StateSet of this RigGeometry.
+        /// @param shadowCastingStateSet Applied when this geometry is drawn by a shadow casting camera, to provide the skinning
+        /// variant of the shadow casting program, see ShadowCastingCamera.
+        /// @note Call after setInfluenceMap and setSourceGeometry.
+        void setGpuSkinning(bool enabled, osg::ref_ptr<osg::StateSet> shadowCastingStateSet = nullptr);
+
+        bool getGpuSkinning() const { return mGpuSkinning; }
+
+        /// @brief User data marking a camera that overrides the program of the scene to cast shadows.
+        /// RigGeometries skinned in the vertex shader apply their shadow casting StateSet when drawn by such a camera.
+        struct ShadowCastingCamera : public osg::Referenced
+        {
+        };
+
         virtual void accept(osg::NodeVisitor &nv);
         virtual bool supports(const osg::PrimitiveFunctor&) const { return true; }
         virtual void accept(osg::PrimitiveFunctor&) const;
@@ -66,8 +105,13 @@ namespace SceneUtil
 
     private:
         void cull(osg::NodeVisitor* nv);
+        void cullGeometry(osg::NodeVisitor* nv, osg::Geometry& geom);
         void updateBounds(osg::NodeVisitor* nv);
 
+        void updateSkinMatrices();
+        void updateVertices(osg::Geometry& geom);
+        void updateBoneMatrices(osg::Uniform& uniform);
+
         osg::ref_ptr<osg::Geometry> mGeometry[2];
         osg::Geometry* getGeometry(unsigned int frame) const;
 
@@ -79,9 +123,14 @@ namespace SceneUtil
 
         osg::ref_ptr<InfluenceMap> mInfluenceMap;
 
-        typedef std::pair<std::string, osg::Matrixf> BoneBindMatrixPair;
+        bool mGpuSkinning;
+        osg::ref_ptr<osg::StateSet> mShadowCastingStateSet;
+        osg::ref_ptr<osg::Vec4Array> mBoneIndices;
+        osg::ref_ptr<osg::Vec4Array> mBoneWeights;
+        osg::ref_ptr<osg::Uniform> mBoneMatrices[2];
 
-        typedef std::pair<BoneBindMatrixPair, float> BoneWeight;
+        // <bone index in the influence map, weight>
+        typedef std::pair<unsigned short, float> BoneWeight;
 
         typedef std::vector<unsigned short> VertexList;
 
@@ -100,6 +149,9 @@ namespace SceneUtil
         osg::ref_ptr<BoneSphereVector> mBoneSphereVector;
         std::vector<Bone*> mBoneNodesVector;
 
+        // inverse bind matrix * bone matrix of each bone, updated every frame
+        std::vector<osg::Matrixf> mSkinMatrices;
+
         unsigned int mLastFrameNumber;
         bool mBoundsFirstFrame;
 
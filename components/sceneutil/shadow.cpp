@@ -28,7 +28,7 @@ namespace SceneUtil
         numberOfShadowMapsPerLight = std::max(1, std::min(numberOfShadowMapsPerLight, 8));
 
         mShadowSettings->setNumShadowMapsPerLight(numberOfShadowMapsPerLight);
-        mShadowSettings->setBaseShadowTextureUnit(8 - numberOfShadowMapsPerLight);
+        mShadowSettings->setBaseShadowTextureUnit(getBaseShadowTextureUnit());
 
         const float maximumShadowMapDistance = Settings::Manager::getFloat("maximum shadow map distance", "Shadows");
         if (maximumShadowMapDistance > 0)
@@ -70,12 +70,19 @@ namespace SceneUtil
             mShadowTechnique->disableDebugHUD();
     }
 
+    int ShadowManager::getBaseShadowTextureUnit()
+    {
+        int numberOfShadowMapsPerLight = Settings::Manager::getInt("number of shadow maps", "Shadows");
+        numberOfShadowMapsPerLight = std::max(1, std::min(numberOfShadowMapsPerLight, 8));
+        return 8 - numberOfShadowMapsPerLight;
+    }
+
     void ShadowManager::disableShadowsForStateSet(osg::ref_ptr<osg::StateSet> stateset)
     {
         int numberOfShadowMapsPerLight = Settings::Manager::getInt("number of shadow maps", "Shadows");
         numberOfShadowMapsPerLight = std::max(1, std::min(numberOfShadowMapsPerLight, 8));
 
-        int baseShadowTextureUnit = 8 - numberOfShadowMapsPerLight;
+        int baseShadowTextureUnit = getBaseShadowTextureUnit();
         
         osg::ref_ptr<osg::Image> fakeShadowMapImage = new osg::Image();
         fakeShadowMapImage->allocateImage(1, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT);
@@ -171,6 +178,16 @@ namespace SceneUtil
             mShadowTechnique->disableShadows();
     }
 
+    void ShadowManager::enableStaticCasterCaching(unsigned int staticCasterMask, unsigned int dynamicCasterMask)
+    {
+        mShadowTechnique->enableStaticCasterCaching(staticCasterMask, dynamicCasterMask);
+    }
+
+    void ShadowManager::invalidateStaticCasterCache()
+    {
+        mShadowTechnique->invalidateStaticCasterCache();
+    }
+
     void ShadowManager::enableOutdoorMode()
     {
         if (mEnableShadows)
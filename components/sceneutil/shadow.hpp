@@ -17,6 +17,9 @@ namespace SceneUtil
 
         static Shader::ShaderManager::DefineMap getShadowsDisabledDefines();
 
+        /// The texture units from this one up to 7 are used for shadow maps, whether shadows are enabled or not.
+        static int getBaseShadowTextureUnit();
+
         ShadowManager(osg::ref_ptr<osg::Group> sceneRoot, osg::ref_ptr<osg::Group> rootNode, unsigned int outdoorShadowCastingMask, unsigned int indoorShadowCastingMask, Shader::ShaderManager &shaderManager);
 
         void setupShadowSettings();
@@ -26,6 +29,12 @@ namespace SceneUtil
         void enableIndoorMode();
 
         void enableOutdoorMode();
+
+        /// @see MWShadowTechnique::enableStaticCasterCaching
+        void enableStaticCasterCaching(unsigned int staticCasterMask, unsigned int dynamicCasterMask);
+
+        /// @see MWShadowTechnique::invalidateStaticCasterCache
+        void invalidateStaticCasterCache();
     protected:
         bool mEnableShadows;
 
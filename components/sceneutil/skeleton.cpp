@@ -3,9 +3,31 @@
 #include <osg/Transform>
 #include <osg/MatrixTransform>
 
+#include <osgUtil/CullVisitor>
+
+#include <atomic>
+
 #include <components/debug/debuglog.hpp>
 #include <components/misc/stringops.hpp>
 
+namespace
+{
+    std::atomic<unsigned int> sNumUpdated(0);
+    std::atomic<unsigned int> sNumSkipped(0);
+
+    // Number of frames between bone updates of a skeleton with the given radius on screen, in pixels
+    unsigned int getUpdateInterval(float pixelSize)
+    {
+        if (pixelSize >= 100.f)
+            return 1;
+        if (pixelSize >= 50.f)
+            return 2;
+        if (pixelSize >= 25.f)
+            return 3;
+        return 4;
+    }
+}
+
 namespace SceneUtil
 {
 
@@ -38,6 +60,9 @@ Skeleton::Skeleton()
     , mActive(Active)
     , mLastFrameNumber(0)
     , mLastCullFrameNumber(0)
+    , mUpdateLod(false)
+    , mPixelSize(0.f)
+    , mLastPoseFrameNumber(0)
 {
 
 }
@@ -49,6 +74,9 @@ Skeleton::Skeleton(const Skeleton &copy, const osg::CopyOp &copyop)
     , mActive(copy.mActive)
     , mLastFrameNumber(0)
     , mLastCullFrameNumber(0)
+    , mUpdateLod(copy.mUpdateLod)
+    , mPixelSize(0.f)
+    , mLastPoseFrameNumber(0)
 {
 
 }
@@ -134,6 +162,22 @@ bool Skeleton::getActive() const
     return mActive != Inactive;
 }
 
+void Skeleton::setUpdateLod(bool enabled)
+{
+    mUpdateLod = enabled;
+}
+
+bool Skeleton::isPoseUnchangedSince(unsigned int traversalNumber) const
+{
+    return mActive == SemiActive && mLastPoseFrameNumber != 0 && mLastPoseFrameNumber <= traversalNumber;
+}
+
+void Skeleton::takeUpdateStats(unsigned int &numUpdated, unsigned int &numSkipped)
+{
+    numUpdated = sNumUpdated.exchange(0);
+    numSkipped = sNumSkipped.exchange(0);
+}
+
 void Skeleton::markDirty()
 {
     mLastFrameNumber = 0;
@@ -141,17 +185,45 @@ void Skeleton::markDirty()
     mBoneCacheInit = false;
 }
 
+bool Skeleton::needsUpdate(unsigned int traversalNumber) const
+{
+    if (mActive == Inactive)
+        return false;
+    if (mActive == SemiActive)
+    {
+        // Off-screen, the animation time still advances in Animation::runAnimation so text keys keep firing,
+        // only the bone transforms are not updated until the skeleton becomes visible again.
+        if (mLastCullFrameNumber+3 <= traversalNumber)
+            return false;
+        if (mUpdateLod && traversalNumber < mLastPoseFrameNumber + getUpdateInterval(mPixelSize))
+            return false;
+    }
+    return true;
+}
+
 void Skeleton::traverse(osg::NodeVisitor& nv)
 {
     if (nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR)
     {
-        if (mActive == Inactive && mLastFrameNumber != 0)
-            return;
-        if (mActive == SemiActive && mLastFrameNumber != 0 && mLastCullFrameNumber+3 <= nv.getTraversalNumber())
+        if (mLastFrameNumber != 0 && !needsUpdate(nv.getTraversalNumber()))
+        {
+            ++sNumSkipped;
             return;
+        }
+        ++sNumUpdated;
+        mLastPoseFrameNumber = nv.getTraversalNumber();
     }
     else if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
+    {
+        if (mUpdateLod)
+        {
+            // Use the biggest size the skeleton has in any of the views rendered this frame
+            float pixelSize = static_cast<osgUtil::CullVisitor&>(nv).clampedPixelSize(getBound());
+            if (mLastCullFrameNumber != nv.getTraversalNumber() || pixelSize > mPixelSize)
+                mPixelSize = pixelSize;
+        }
         mLastCullFrameNumber = nv.getTraversalNumber();
+    }
 
     osg::Group::traverse(nv);
 }
@@ -60,6 +60,16 @@ namespace SceneUtil
 
         bool getActive() const;
 
+        /// Enable the update LOD: a SemiActive skeleton that appears small on screen will not update its bones every frame.
+        void setUpdateLod(bool enabled);
+
+        /// @return true if the bones were not moved by an update traversal since the given frame.
+        /// @note Only reports frozen poses for SemiActive skeletons, Active skeletons may be moved outside of the update traversal.
+        bool isPoseUnchangedSince(unsigned int traversalNumber) const;
+
+        /// Retrieve the number of update traversals that were done and skipped by all skeletons since the last call.
+        static void takeUpdateStats(unsigned int& numUpdated, unsigned int& numSkipped);
+
         void traverse(osg::NodeVisitor& nv);
 
         void markDirty();
@@ -68,6 +78,8 @@ namespace SceneUtil
         virtual void childRemoved(unsigned int, unsigned int);
 
     private:
+        bool needsUpdate(unsigned int traversalNumber) const;
+
         // The root bone is not a "real" bone, it has no corresponding node in the scene graph.
         // As far as the scene graph goes we support multiple root bones.
         std::unique_ptr<Bone> mRootBone;
@@ -82,6 +94,10 @@ namespace SceneUtil
 
         unsigned int mLastFrameNumber;
         unsigned int mLastCullFrameNumber;
+
+        bool mUpdateLod;
+        float mPixelSize;
+        unsigned int mLastPoseFrameNumber;
     };
 
 }
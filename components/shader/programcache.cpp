@@ -0,0 +1,427 @@
+#include "programcache.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/GLExtensions>
+#include <osg/State>
+
+#include <components/debug/debuglog.hpp>
+#include <components/files/cachefile.hpp>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+namespace
+{
+    const char sBinaryMagic[4] = { 'O', 'M', 'W', 'P' };
+    const std::size_t sBinaryHeaderSize = sizeof(sBinaryMagic) + sizeof(std::uint32_t);
+    // Version 2 added the session counter, and entries of version 1 lack the defines that were added since
+    const std::string sProgramListVersion = "2";
+    // Permutations that were not used in this many sessions are forgotten
+    const unsigned int sMaxUnusedSessions = 3;
+
+    bool readNumber(std::istream& stream, unsigned int& number)
+    {
+        std::string line;
+        if (!std::getline(stream, line))
+            return false;
+        try
+        {
+            number = std::stoul(line);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void writeDefines(std::ostream& stream, const Shader::ProgramCache::DefineMap& defines)
+    {
+        stream << defines.size() << '\n';
+        for (const auto& define : defines)
+            stream << define.first << '\n' << define.second << '\n';
+    }
+
+    bool readDefines(std::istream& stream, Shader::ProgramCache::DefineMap& defines)
+    {
+        unsigned int count = 0;
+        if (!readNumber(stream, count))
+            return false;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            std::string name;
+            std::string value;
+            if (!std::getline(stream, name) || !std::getline(stream, value))
+                return false;
+            defines[name] = value;
+        }
+        return true;
+    }
+
+    std::string serializeKey(const Shader::ProgramCache::ProgramKey& key)
+    {
+        std::ostringstream stream;
+        stream << key.mVertexTemplate << '\n';
+        writeDefines(stream, key.mVertexDefines);
+        stream << key.mFragmentTemplate << '\n';
+        writeDefines(stream, key.mFragmentDefines);
+        return stream.str();
+    }
+
+    bool readKey(std::istream& stream, Shader::ProgramCache::ProgramKey& key)
+    {
+        key.mVertexDefines.clear();
+        key.mFragmentDefines.clear();
+        return std::getline(stream, key.mVertexTemplate) && readDefines(stream, key.mVertexDefines)
+            && std::getline(stream, key.mFragmentTemplate) && readDefines(stream, key.mFragmentDefines);
+    }
+
+    bool isBinary(const std::string& data)
+    {
+        return data.size() > sBinaryHeaderSize && std::memcmp(data.data(), sBinaryMagic, sizeof(sBinaryMagic)) == 0;
+    }
+
+    std::string getString(GLenum name)
+    {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : std::string();
+    }
+}
+
+namespace Shader
+{
+
+    ProgramCache::ProgramCache(const std::string& path)
+        : osg::GraphicsOperation("ProgramCache", true)
+        , mPath(path)
+        , mSession(0)
+        , mProgramKeysChanged(false)
+        , mDone(false)
+    {
+        try
+        {
+            boost::filesystem::create_directories(mPath);
+        }
+        catch (const std::exception& e)
+        {
+            Log(Debug::Warning) << "Warning: Failed to create shader cache directory " << mPath << ": " << e.what();
+        }
+
+        readProgramList();
+
+        mThread = std::thread([this] { run(); });
+    }
+
+    ProgramCache::~ProgramCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mProgramKeysChanged)
+            {
+                FileOperation operation;
+                operation.mType = FileOperation::WriteProgramList;
+                std::lock_guard<std::mutex> fileLock(mFileMutex);
+                mFileOperations.push_back(std::move(operation));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mFileMutex);
+            mDone = true;
+        }
+        mFileCondition.notify_all();
+        mThread.join();
+    }
+
+    void ProgramCache::addProgram(osg::Program* program, const ProgramKey& key)
+    {
+        std::string serialized = serializeKey(key);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingPrograms.push_back(program);
+        setLastUsed(serialized, mSession);
+    }
+
+    void ProgramCache::addPrewarmedProgram(osg::Program* program)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingPrograms.push_back(program);
+    }
+
+    void ProgramCache::markUsed(const ProgramKey& key)
+    {
+        std::string serialized = serializeKey(key);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        setLastUsed(serialized, mSession);
+    }
+
+    void ProgramCache::removeProgramKey(const ProgramKey& key)
+    {
+        std::string serialized = serializeKey(key);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mProgramKeys.erase(serialized))
+            mProgramKeysChanged = true;
+    }
+
+    std::vector<ProgramCache::ProgramKey> ProgramCache::getProgramKeys()
+    {
+        std::vector<ProgramKey> keys;
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& entry : mProgramKeys)
+        {
+            std::istringstream stream(entry.first);
+            ProgramKey key;
+            if (readKey(stream, key))
+                keys.push_back(key);
+        }
+        return keys;
+    }
+
+    void ProgramCache::readProgramList()
+    {
+        std::string data;
+        if (!Files::readCacheFile(boost::filesystem::path(mPath) / "programs.txt", data))
+            return;
+
+        std::istringstream stream(data);
+        std::string version;
+        unsigned int lastSession = 0;
+        if (!std::getline(stream, version) || version != sProgramListVersion || !readNumber(stream, lastSession))
+        {
+            // Start over, the list of an older version may have permutations that can no longer be created
+            mProgramKeysChanged = true;
+            return;
+        }
+        mSession = lastSession + 1;
+
+        unsigned int lastUsed = 0;
+        while (readNumber(stream, lastUsed))
+        {
+            ProgramKey key;
+            if (!readKey(stream, key))
+            {
+                Log(Debug::Warning) << "Warning: Ignoring malformed shader program list in " << mPath;
+                break;
+            }
+            if (mSession - lastUsed <= sMaxUnusedSessions)
+                mProgramKeys[serializeKey(key)] = lastUsed;
+            else
+                mProgramKeysChanged = true;
+        }
+    }
+
+    void ProgramCache::setLastUsed(const std::string& key, unsigned int session)
+    {
+        auto inserted = mProgramKeys.emplace(key, session);
+        if (inserted.second || inserted.first->second != session)
+        {
+            inserted.first->second = session;
+            mProgramKeysChanged = true;
+        }
+    }
+
+    void ProgramCache::operator()(osg::GraphicsContext* graphicsContext)
+    {
+        osg::State* state = graphicsContext->getState();
+        if (!state)
+            return;
+
+        std::vector<osg::ref_ptr<osg::Program> > programs;
+        bool programKeysChanged = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            programs.swap(mPendingPrograms);
+            std::swap(programKeysChanged, mProgramKeysChanged);
+        }
+
+        if (programKeysChanged)
+        {
+            FileOperation operation;
+            operation.mType = FileOperation::WriteProgramList;
+            addFileOperation(std::move(operation));
+        }
+
+        std::vector<FileOperation> readBinaries;
+        {
+            std::lock_guard<std::mutex> lock(mFileMutex);
+            readBinaries.swap(mReadBinaries);
+        }
+        for (const FileOperation& read : readBinaries)
+            linkProgram(*read.mProgram, read.mFileName, read.mData, *state);
+
+        if (programs.empty())
+            return;
+
+        osg::GLExtensions* extensions = state->get<osg::GLExtensions>();
+        if (!extensions->isGetProgramBinarySupported)
+        {
+            for (const osg::ref_ptr<osg::Program>& program : programs)
+                program->compileGLObjects(*state);
+            return;
+        }
+
+        if (mDriverId.empty())
+        {
+            // Binaries are only valid for the driver that created them
+            std::hash<std::string> hasher;
+            std::ostringstream stream;
+            stream << std::hex << hasher(getString(GL_VENDOR) + getString(GL_RENDERER) + getString(GL_VERSION));
+            mDriverId = stream.str();
+        }
+
+        // The binaries are read in the background, the programs are linked during a later frame
+        for (const osg::ref_ptr<osg::Program>& program : programs)
+        {
+            FileOperation operation;
+            operation.mType = FileOperation::Read;
+            operation.mFileName = getBinaryFileName(*program);
+            operation.mProgram = program;
+            addFileOperation(std::move(operation));
+        }
+    }
+
+    void ProgramCache::linkProgram(osg::Program& program, const std::string& fileName, const std::string& data, osg::State& state)
+    {
+        osg::GLExtensions* extensions = state.get<osg::GLExtensions>();
+        osg::Program::PerContextProgram* pcp = program.getPCP(state);
+        if (!pcp->needsLink())
+        {
+            // Already linked during the draw traversal, store the binary if we have none yet
+            if (!data.empty())
+                return;
+        }
+        else if (!data.empty())
+        {
+            std::uint32_t format = 0;
+            std::memcpy(&format, data.data() + sizeof(sBinaryMagic), sizeof(format));
+
+            osg::ref_ptr<osg::ProgramBinary> binary (new osg::ProgramBinary);
+            binary->setFormat(format);
+            binary->assign(data.size() - sBinaryHeaderSize, reinterpret_cast<const unsigned char*>(data.data() + sBinaryHeaderSize));
+            program.setProgramBinary(binary);
+            // Only link, compiling the program would compile its shaders even though the binary does not need them
+            pcp->linkProgram(state);
+            program.setProgramBinary(nullptr);
+            if (pcp->isLinked())
+                return;
+
+            // The driver was updated or the binary is corrupt, link from source and replace the binary
+            Log(Debug::Verbose) << "Discarding cached shader program binary " << fileName;
+            FileOperation operation;
+            operation.mType = FileOperation::Remove;
+            operation.mFileName = fileName;
+            addFileOperation(std::move(operation));
+
+            program.dirtyProgram();
+            extensions->glProgramParameteri(pcp->getHandle(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            program.compileGLObjects(state);
+        }
+        else
+        {
+            extensions->glProgramParameteri(pcp->getHandle(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            program.compileGLObjects(state);
+        }
+
+        if (!pcp->isLinked())
+            return;
+
+        osg::ref_ptr<osg::ProgramBinary> binary = pcp->compileProgramBinary(state);
+        if (!binary || binary->getSize() == 0)
+            return;
+
+        const std::uint32_t format = binary->getFormat();
+        FileOperation operation;
+        operation.mType = FileOperation::Write;
+        operation.mFileName = fileName;
+        operation.mData.assign(sBinaryMagic, sizeof(sBinaryMagic));
+        operation.mData.append(reinterpret_cast<const char*>(&format), sizeof(format));
+        operation.mData.append(reinterpret_cast<const char*>(binary->getData()), binary->getSize());
+        addFileOperation(std::move(operation));
+    }
+
+    std::string ProgramCache::getBinaryFileName(const osg::Program& program) const
+    {
+        std::string sources;
+        for (unsigned int i = 0; i < program.getNumShaders(); ++i)
+        {
+            const osg::Shader* shader = program.getShader(i);
+            sources += std::to_string(shader->getType()) + '\n' + shader->getShaderSource();
+        }
+        for (const auto& binding : program.getAttribBindingList())
+            sources += binding.first + std::to_string(binding.second);
+
+        std::hash<std::string> hasher;
+        std::ostringstream stream;
+        stream << mDriverId << "_" << std::hex << hasher(sources) << "_" << std::dec << sources.size() << ".bin";
+        return (boost::filesystem::path(mPath) / stream.str()).string();
+    }
+
+    void ProgramCache::addFileOperation(FileOperation&& operation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mFileMutex);
+            mFileOperations.push_back(std::move(operation));
+        }
+        mFileCondition.notify_one();
+    }
+
+    void ProgramCache::run()
+    {
+        std::unique_lock<std::mutex> lock(mFileMutex);
+        while (true)
+        {
+            mFileCondition.wait(lock, [this] { return mDone || !mFileOperations.empty(); });
+            if (mFileOperations.empty())
+                return;
+
+            FileOperation operation = std::move(mFileOperations.front());
+            mFileOperations.pop_front();
+            // Nobody links the programs anymore
+            if (mDone && operation.mType == FileOperation::Read)
+                continue;
+            lock.unlock();
+
+            switch (operation.mType)
+            {
+                case FileOperation::Read:
+                    if (!Files::readCacheFile(operation.mFileName, operation.mData) || !isBinary(operation.mData))
+                        operation.mData.clear();
+                    break;
+                case FileOperation::Write:
+                    Files::writeCacheFile(operation.mFileName, operation.mData);
+                    break;
+                case FileOperation::Remove:
+                {
+                    boost::system::error_code error;
+                    boost::filesystem::remove(operation.mFileName, error);
+                    break;
+                }
+                case FileOperation::WriteProgramList:
+                {
+                    std::string data = sProgramListVersion + '\n';
+                    {
+                        std::lock_guard<std::mutex> keysLock(mMutex);
+                        data += std::to_string(mSession) + '\n';
+                        for (const auto& entry : mProgramKeys)
+                            data += std::to_string(entry.second) + '\n' + entry.first;
+                    }
+                    Files::writeCacheFile(boost::filesystem::path(mPath) / "programs.txt", data);
+                    break;
+                }
+            }
+
+            lock.lock();
+            if (operation.mType == FileOperation::Read)
+                mReadBinaries.push_back(std::move(operation));
+        }
+    }
+
+}
@@ -0,0 +1,111 @@
+#ifndef OPENMW_COMPONENTS_SHADER_PROGRAMCACHE_H
+#define OPENMW_COMPONENTS_SHADER_PROGRAMCACHE_H
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <osg/GraphicsContext>
+#include <osg/Program>
+#include <osg/ref_ptr>
+
+namespace Shader
+{
+
+    /// @brief Compiles new shader programs ahead of their first use and stores the linked program binaries on disk.
+    /// @par Runs as a graphics operation at the end of each frame. The binaries of programs that were added since the last frame
+    /// are read by a background thread, a later frame links the program from its binary if the current driver accepts it,
+    /// otherwise from source, in which case the new binary is written back by the background thread. The define permutations
+    /// of the programs are stored as well, so that a later session can create and compile them during the loading screen,
+    /// see ShaderManager::prewarmPrograms. Permutations that were not used in the last few sessions are forgotten.
+    /// @note A cached binary that the driver rejects is removed, and the program is linked from source instead.
+    class ProgramCache : public osg::GraphicsOperation
+    {
+    public:
+        typedef std::map<std::string, std::string> DefineMap;
+
+        struct ProgramKey
+        {
+            std::string mVertexTemplate;
+            DefineMap mVertexDefines;
+            std::string mFragmentTemplate;
+            DefineMap mFragmentDefines;
+        };
+
+        ProgramCache(const std::string& path);
+        ~ProgramCache();
+
+        /// Queue a newly created program for compilation and record its permutation as used in this session.
+        /// @note Thread safe.
+        void addProgram(osg::Program* program, const ProgramKey& key);
+
+        /// Queue a program that was recreated from a previous session for compilation, without recording it as used.
+        /// @note Thread safe.
+        void addPrewarmedProgram(osg::Program* program);
+
+        /// Record the permutation of a prewarmed program as used in this session.
+        /// @note Thread safe.
+        void markUsed(const ProgramKey& key);
+
+        /// Forget a permutation that can no longer be created, e.g. because its shader template changed.
+        /// @note Thread safe.
+        void removeProgramKey(const ProgramKey& key);
+
+        /// @return The permutations of the programs that were used in recent sessions.
+        std::vector<ProgramKey> getProgramKeys();
+
+        void operator()(osg::GraphicsContext* graphicsContext) override;
+
+    private:
+        struct FileOperation
+        {
+            enum Type
+            {
+                Read,
+                Write,
+                Remove,
+                WriteProgramList
+            };
+
+            Type mType;
+            std::string mFileName;
+            std::string mData;
+            osg::ref_ptr<osg::Program> mProgram;
+        };
+
+        void readProgramList();
+
+        void setLastUsed(const std::string& key, unsigned int session);
+
+        void linkProgram(osg::Program& program, const std::string& fileName, const std::string& data, osg::State& state);
+
+        std::string getBinaryFileName(const osg::Program& program) const;
+
+        void addFileOperation(FileOperation&& operation);
+
+        void run();
+
+        std::string mPath;
+        std::string mDriverId;
+
+        unsigned int mSession;
+        std::vector<osg::ref_ptr<osg::Program> > mPendingPrograms;
+        std::map<std::string, unsigned int> mProgramKeys;
+        bool mProgramKeysChanged;
+        std::mutex mMutex;
+
+        std::deque<FileOperation> mFileOperations;
+        std::vector<FileOperation> mReadBinaries;
+        bool mDone;
+        std::mutex mFileMutex;
+        std::condition_variable mFileCondition;
+        std::thread mThread;
+    };
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include <algorithm>
+#include <set>
 #include <sstream>
 
 #include <osg/Program>
@@ -339,14 +340,97 @@ namespace Shader
         ProgramMap::iterator found = mPrograms.find(std::make_pair(vertexShader, fragmentShader));
         if (found == mPrograms.end())
         {
-            osg::ref_ptr<osg::Program> program (new osg::Program);
-            program->addShader(vertexShader);
-            program->addShader(fragmentShader);
-            found = mPrograms.insert(std::make_pair(std::make_pair(vertexShader, fragmentShader), program)).first;
+            found = mPrograms.insert(std::make_pair(std::make_pair(vertexShader, fragmentShader), createProgram(vertexShader, fragmentShader))).first;
+
+            ProgramCache::ProgramKey key;
+            // Programs with shaders that were not created by the ShaderManager can't be recreated in a later session
+            if (mProgramCache && getProgramKey(vertexShader, fragmentShader, key))
+                mProgramCache->addProgram(found->second, key);
+        }
+        else if (!mPrewarmedPrograms.empty())
+        {
+            auto prewarmed = mPrewarmedPrograms.find(found->second);
+            if (prewarmed != mPrewarmedPrograms.end())
+            {
+                mProgramCache->markUsed(prewarmed->second);
+                mPrewarmedPrograms.erase(prewarmed);
+            }
         }
         return found->second;
     }
 
+    osg::ref_ptr<osg::Program> ShaderManager::createProgram(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader)
+    {
+        osg::ref_ptr<osg::Program> program (new osg::Program);
+        program->addShader(vertexShader);
+        program->addShader(fragmentShader);
+        for (const auto& location : mAttribLocations)
+            program->addBindAttribLocation(location.first, location.second);
+        return program;
+    }
+
+    bool ShaderManager::getProgramKey(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader, ProgramCache::ProgramKey& key)
+    {
+        bool foundVertex = false;
+        bool foundFragment = false;
+        for (const auto& shader : mShaders)
+        {
+            if (shader.second == vertexShader)
+            {
+                key.mVertexTemplate = shader.first.first;
+                key.mVertexDefines = shader.first.second;
+                foundVertex = true;
+            }
+            else if (shader.second == fragmentShader)
+            {
+                key.mFragmentTemplate = shader.first.first;
+                key.mFragmentDefines = shader.first.second;
+                foundFragment = true;
+            }
+        }
+        return foundVertex && foundFragment;
+    }
+
+    void ShaderManager::addAttribLocation(const std::string& name, unsigned int location)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAttribLocations[name] = location;
+    }
+
+    void ShaderManager::setProgramCache(ProgramCache* cache)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mProgramCache = cache;
+    }
+
+    void ShaderManager::prewarmPrograms()
+    {
+        if (!mProgramCache)
+            return;
+
+        for (const ProgramCache::ProgramKey& key : mProgramCache->getProgramKeys())
+        {
+            osg::ref_ptr<osg::Shader> vertexShader = getShader(key.mVertexTemplate, key.mVertexDefines, osg::Shader::VERTEX);
+            osg::ref_ptr<osg::Shader> fragmentShader = getShader(key.mFragmentTemplate, key.mFragmentDefines, osg::Shader::FRAGMENT);
+            if (!vertexShader || !fragmentShader)
+            {
+                // The templates changed since the permutation was recorded
+                mProgramCache->removeProgramKey(key);
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto programKey = std::make_pair(vertexShader, fragmentShader);
+            if (mPrograms.count(programKey))
+                continue;
+            // Not recorded as used until something requests the program, so that unused permutations are eventually forgotten
+            osg::ref_ptr<osg::Program> program = createProgram(vertexShader, fragmentShader);
+            mPrograms.insert(std::make_pair(programKey, program));
+            mPrewarmedPrograms.emplace(program, key);
+            mProgramCache->addPrewarmedProgram(program);
+        }
+    }
+
     ShaderManager::DefineMap ShaderManager::getGlobalDefines()
     {
         return DefineMap(mGlobalDefines);
@@ -11,6 +11,8 @@
 
 #include <osgViewer/Viewer>
 
+#include "programcache.hpp"
+
 namespace Shader
 {
 
@@ -33,6 +35,19 @@ namespace Shader
 
         osg::ref_ptr<osg::Program> getProgram(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader);
 
+        /// Bind the generic vertex attribute with the given name to a fixed location in all programs created afterwards.
+        /// @note Thread safe.
+        void addAttribLocation(const std::string& name, unsigned int location);
+
+        /// Set the cache that compiles new programs and stores their binaries, may be nullptr.
+        /// @note The cache must also be added as an operation to the graphics context.
+        void setProgramCache(ProgramCache* cache);
+
+        /// Create the programs that were used in recent sessions, so that the program cache compiles them before they are first drawn.
+        /// Permutations that can no longer be created are removed from the cache.
+        /// @note Should be called after the global defines are set up.
+        void prewarmPrograms();
+
         /// Get (a copy of) the DefineMap used to construct all shaders
         DefineMap getGlobalDefines();
 
@@ -62,6 +77,17 @@ namespace Shader
         typedef std::map<std::pair<osg::ref_ptr<osg::Shader>, osg::ref_ptr<osg::Shader> >, osg::ref_ptr<osg::Program> > ProgramMap;
         ProgramMap mPrograms;
 
+        std::map<std::string, unsigned int> mAttribLocations;
+
+        osg::ref_ptr<ProgramCache> mProgramCache;
+
+        // Programs created by prewarmPrograms that nothing requested yet
+        std::map<osg::ref_ptr<osg::Program>, ProgramCache::ProgramKey> mPrewarmedPrograms;
+
+        osg::ref_ptr<osg::Program> createProgram(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader);
+
+        bool getProgramKey(osg::ref_ptr<osg::Shader> vertexShader, osg::ref_ptr<osg::Shader> fragmentShader, ProgramCache::ProgramKey& key);
+
         std::mutex mMutex;
 
         const osg::ref_ptr<osg::Uniform> mShadowMapAlphaTestEnableUniform = new osg::Uniform();
@@ -43,6 +43,7 @@ namespace Shader
         , mAllowedToModifyStateSets(true)
         , mAutoUseNormalMaps(false)
         , mAutoUseSpecularMaps(false)
+        , mMaxGpuBones(0)
         , mShaderManager(shaderManager)
         , mImageManager(imageManager)
         , mDefaultVsTemplate(defaultVsTemplate)
@@ -319,18 +320,33 @@ namespace Shader
         mRequirements.pop_back();
     }
 
-    void ShaderVisitor::createProgram(const ShaderRequirements &reqs)
+    void ShaderVisitor::createProgram(const ShaderRequirements &reqs, osg::Node& node, bool skinning)
     {
-        if (!reqs.mShaderRequired && !mForceShaders)
+        if (!reqs.mShaderRequired && !mForceShaders && !skinning)
             return;
 
-        osg::Node& node = *reqs.mNode;
         osg::StateSet* writableStateSet = nullptr;
         if (mAllowedToModifyStateSets)
             writableStateSet = node.getOrCreateStateSet();
         else
             writableStateSet = getWritableStateSet(node);
 
+        writableStateSet->addUniform(new osg::Uniform("colorMode", reqs.mColorMode));
+
+        osg::ref_ptr<osg::Program> program = getProgram(reqs, skinning);
+        if (program)
+        {
+            writableStateSet->setAttributeAndModes(program, osg::StateAttribute::ON);
+
+            for (std::map<int, std::string>::const_iterator texIt = reqs.mTextures.begin(); texIt != reqs.mTextures.end(); ++texIt)
+            {
+                writableStateSet->addUniform(new osg::Uniform(texIt->second.c_str(), texIt->first), osg::StateAttribute::ON);
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Program> ShaderVisitor::getProgram(const ShaderRequirements &reqs, bool skinning)
+    {
         ShaderManager::DefineMap defineMap;
         for (unsigned int i=0; i<sizeof(defaultTextures)/sizeof(defaultTextures[0]); ++i)
         {
@@ -345,20 +361,36 @@ namespace Shader
 
         defineMap["parallax"] = reqs.mNormalHeight ? "1" : "0";
 
-        writableStateSet->addUniform(new osg::Uniform("colorMode", reqs.mColorMode));
+        ShaderManager::DefineMap vertexDefineMap = defineMap;
+        vertexDefineMap["skinning"] = skinning ? "1" : "0";
+        vertexDefineMap["maxBones"] = skinning ? std::to_string(mMaxGpuBones) : "0";
 
-        osg::ref_ptr<osg::Shader> vertexShader (mShaderManager.getShader(mDefaultVsTemplate, defineMap, osg::Shader::VERTEX));
+        osg::ref_ptr<osg::Shader> vertexShader (mShaderManager.getShader(mDefaultVsTemplate, vertexDefineMap, osg::Shader::VERTEX));
         osg::ref_ptr<osg::Shader> fragmentShader (mShaderManager.getShader(mDefaultFsTemplate, defineMap, osg::Shader::FRAGMENT));
 
         if (vertexShader && fragmentShader)
-        {
-            writableStateSet->setAttributeAndModes(mShaderManager.getProgram(vertexShader, fragmentShader), osg::StateAttribute::ON);
+            return mShaderManager.getProgram(vertexShader, fragmentShader);
+        return nullptr;
+    }
 
-            for (std::map<int, std::string>::const_iterator texIt = reqs.mTextures.begin(); texIt != reqs.mTextures.end(); ++texIt)
-            {
-                writableStateSet->addUniform(new osg::Uniform(texIt->second.c_str(), texIt->first), osg::StateAttribute::ON);
-            }
-        }
+    osg::ref_ptr<osg::StateSet> ShaderVisitor::getShadowCastingStateSet()
+    {
+        if (mShadowCastingStateSet)
+            return mShadowCastingStateSet;
+
+        ShaderManager::DefineMap vertexDefineMap;
+        vertexDefineMap["skinning"] = "1";
+        vertexDefineMap["maxBones"] = std::to_string(mMaxGpuBones);
+
+        osg::ref_ptr<osg::Shader> vertexShader (mShaderManager.getShader("shadowcasting_vertex.glsl", vertexDefineMap, osg::Shader::VERTEX));
+        osg::ref_ptr<osg::Shader> fragmentShader (mShaderManager.getShader("shadowcasting_fragment.glsl", ShaderManager::DefineMap(), osg::Shader::FRAGMENT));
+        if (!vertexShader || !fragmentShader)
+            return nullptr;
+
+        // protected, so that it takes precedence over the program that the shadow casting cameras override the scene with
+        mShadowCastingStateSet = new osg::StateSet;
+        mShadowCastingStateSet->setAttributeAndModes(mShaderManager.getProgram(vertexShader, fragmentShader), osg::StateAttribute::ON|osg::StateAttribute::PROTECTED);
+        return mShadowCastingStateSet;
     }
 
     bool ShaderVisitor::adjustGeometry(osg::Geometry& sourceGeometry, const ShaderRequirements& reqs)
@@ -406,7 +438,7 @@ namespace Shader
 
             adjustGeometry(geometry, reqs);
 
-            createProgram(reqs);
+            createProgram(reqs, *reqs.mNode, false);
         }
 
         if (needPop)
@@ -427,13 +459,24 @@ namespace Shader
         if (!mRequirements.empty())
         {
             const ShaderRequirements& reqs = mRequirements.back();
-            createProgram(reqs);
+            createProgram(reqs, *reqs.mNode, false);
 
             if (auto rig = dynamic_cast<SceneUtil::RigGeometry*>(&drawable))
             {
                 osg::ref_ptr<osg::Geometry> sourceGeometry = rig->getSourceGeometry();
                 if (sourceGeometry && adjustGeometry(*sourceGeometry, reqs))
                     rig->setSourceGeometry(sourceGeometry);
+
+                if (mMaxGpuBones > 0 && mAllowedToModifyStateSets && (reqs.mShaderRequired || mForceShaders) && rig->supportsGpuSkinning(mMaxGpuBones))
+                {
+                    osg::ref_ptr<osg::StateSet> shadowCastingStateSet = getShadowCastingStateSet();
+                    if (shadowCastingStateSet)
+                        rig->setGpuSkinning(true, shadowCastingStateSet);
+                }
+
+                // The skinning variant of the program goes on the RigGeometry itself, this also recreates it along with the shaders of its parents
+                if (rig->getGpuSkinning())
+                    createProgram(reqs, *rig, true);
             }
             else if (auto morph = dynamic_cast<SceneUtil::MorphGeometry*>(&drawable))
             {
@@ -467,6 +510,11 @@ namespace Shader
         mNormalHeightMapPattern = pattern;
     }
 
+    void ShaderVisitor::setMaxGpuBones(unsigned int maxBones)
+    {
+        mMaxGpuBones = maxBones;
+    }
+
     void ShaderVisitor::setAutoUseSpecularMaps(bool use)
     {
         mAutoUseSpecularMaps = use;
@@ -2,6 +2,8 @@
 #define OPENMW_COMPONENTS_SHADERVISITOR_H
 
 #include <osg/NodeVisitor>
+#include <osg/Program>
+#include <osg/StateSet>
 
 namespace Resource
 {
@@ -38,6 +40,10 @@ namespace Shader
 
         void setSpecularMapPattern(const std::string& pattern);
 
+        /// Skin RigGeometries with less than the given number of bones in the vertex shader when they are rendered with shaders.
+        /// 0 (the default) disables skinning in the vertex shader.
+        void setMaxGpuBones(unsigned int maxBones);
+
         virtual void apply(osg::Node& node);
 
         virtual void apply(osg::Drawable& drawable);
@@ -59,6 +65,9 @@ namespace Shader
         bool mAutoUseSpecularMaps;
         std::string mSpecularMapPattern;
 
+        unsigned int mMaxGpuBones;
+        osg::ref_ptr<osg::StateSet> mShadowCastingStateSet;
+
         ShaderManager& mShaderManager;
         Resource::ImageManager& mImageManager;
 
@@ -90,7 +99,9 @@ namespace Shader
         std::string mDefaultVsTemplate;
         std::string mDefaultFsTemplate;
 
-        void createProgram(const ShaderRequirements& reqs);
+        void createProgram(const ShaderRequirements& reqs, osg::Node& node, bool skinning);
+        osg::ref_ptr<osg::Program> getProgram(const ShaderRequirements& reqs, bool skinning);
+        osg::ref_ptr<osg::StateSet> getShadowCastingStateSet();
         bool adjustGeometry(osg::Geometry& sourceGeometry, const ShaderRequirements& reqs);
     };
 
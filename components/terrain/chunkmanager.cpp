@@ -1,5 +1,6 @@
 #include "chunkmanager.hpp"
 
+#include <mutex>
 #include <sstream>
 
 #include <osg/Texture2D>
@@ -22,12 +23,74 @@
 namespace Terrain
 {
 
+class PassesHolder : public osg::Object
+{
+public:
+    PassesHolder(const std::vector<osg::ref_ptr<osg::StateSet> >& passes)
+        : mPasses(passes)
+    {
+    }
+    PassesHolder(const PassesHolder& copy, const osg::CopyOp& copyop)
+        : mPasses(copy.mPasses)
+    {
+    }
+
+    PassesHolder()
+    {
+    }
+
+    META_Object(Terrain, PassesHolder)
+
+    void releaseGLObjects(osg::State* state) const override
+    {
+        for (const osg::ref_ptr<osg::StateSet>& pass : mPasses)
+            pass->releaseGLObjects(state);
+    }
+
+    std::vector<osg::ref_ptr<osg::StateSet> > mPasses;
+};
+
+class PackedBlendmapsHolder : public osg::Object
+{
+public:
+    PackedBlendmapsHolder()
+    {
+    }
+    PackedBlendmapsHolder(const PackedBlendmapsHolder& copy, const osg::CopyOp& copyop)
+        : mBlendmaps(copy.mBlendmaps)
+    {
+    }
+
+    META_Object(Terrain, PackedBlendmapsHolder)
+
+    void releaseGLObjects(osg::State* state) const override
+    {
+        for (const auto& blendmap : mBlendmaps)
+            blendmap.second->releaseGLObjects(state);
+    }
+
+    bool isUsed() const
+    {
+        for (const auto& blendmap : mBlendmaps)
+        {
+            if (blendmap.second->referenceCount() > 1)
+                return true;
+        }
+        return false;
+    }
+
+    PackedBlendmaps mBlendmaps;
+    std::mutex mMutex;
+};
+
 ChunkManager::ChunkManager(Storage *storage, Resource::SceneManager *sceneMgr, TextureManager* textureManager, CompositeMapRenderer* renderer)
     : GenericResourceManager<ChunkId>(nullptr)
     , mStorage(storage)
     , mSceneManager(sceneMgr)
     , mTextureManager(textureManager)
     , mCompositeMapRenderer(renderer)
+    , mPassesCache(new PassesCache)
+    , mPackedBlendmapsCache(new PassesCache)
     , mNodeMask(0)
     , mCompositeMapSize(512)
     , mCompositeMapLevel(1.f)
@@ -59,9 +122,41 @@ void ChunkManager::reportStats(unsigned int frameNumber, osg::Stats *stats) cons
     stats->setAttribute(frameNumber, "Terrain Chunk", mCache->getCacheSize());
 }
 
+void ChunkManager::updateCache(double referenceTime)
+{
+    GenericResourceManager<ChunkId>::updateCache(referenceTime);
+
+    // The passes are in use as long as a chunk refers to them
+    std::vector<std::pair<float, osg::Vec2f> > usedPasses;
+    auto findUsedPasses = [&] (const std::pair<float, osg::Vec2f>& id, osg::Object* obj)
+    {
+        const std::vector<osg::ref_ptr<osg::StateSet> >& passes = static_cast<PassesHolder*>(obj)->mPasses;
+        if (!passes.empty() && passes.front()->referenceCount() > 1)
+            usedPasses.push_back(id);
+    };
+    mPassesCache->call(findUsedPasses);
+    for (const auto& id : usedPasses)
+        mPassesCache->checkInObjectCache(id, referenceTime);
+
+    mPassesCache->removeExpiredObjectsInCache(referenceTime - mExpiryDelay);
+
+    std::vector<std::pair<float, osg::Vec2f> > usedBlendmaps;
+    auto findUsedBlendmaps = [&] (const std::pair<float, osg::Vec2f>& id, osg::Object* obj)
+    {
+        if (static_cast<PackedBlendmapsHolder*>(obj)->isUsed())
+            usedBlendmaps.push_back(id);
+    };
+    mPackedBlendmapsCache->call(findUsedBlendmaps);
+    for (const auto& id : usedBlendmaps)
+        mPackedBlendmapsCache->checkInObjectCache(id, referenceTime);
+
+    mPackedBlendmapsCache->removeExpiredObjectsInCache(referenceTime - mExpiryDelay);
+}
+
 void ChunkManager::clearCache()
 {
     GenericResourceManager<ChunkId>::clearCache();
+    mPassesCache->clear();
 
     mBufferCache.clearCache();
 }
@@ -69,6 +164,8 @@ void ChunkManager::clearCache()
 void ChunkManager::releaseGLObjects(osg::State *state)
 {
     GenericResourceManager<ChunkId>::releaseGLObjects(state);
+    mPassesCache->releaseGLObjects(state);
+    mPackedBlendmapsCache->releaseGLObjects(state);
     mBufferCache.releaseGLObjects(state);
 }
 
@@ -163,7 +260,33 @@ std::vector<osg::ref_ptr<osg::StateSet> > ChunkManager::createPasses(float chunk
 
     float blendmapScale = mStorage->getBlendmapScale(chunkSize);
 
-    return ::Terrain::createPasses(useShaders, &mSceneManager->getShaderManager(), layers, blendmapTextures, blendmapScale, blendmapScale);
+    // Composite maps are rendered without shaders, so their layers are never packed
+    if (!useShaders)
+        return ::Terrain::createPasses(useShaders, &mSceneManager->getShaderManager(), layers, blendmapTextures, blendmapScale, blendmapScale);
+
+    const std::pair<float, osg::Vec2f> id (chunkSize, chunkCenter);
+    osg::ref_ptr<osg::Object> obj = mPackedBlendmapsCache->getRefFromObjectCache(id);
+    if (!obj)
+    {
+        obj = new PackedBlendmapsHolder;
+        mPackedBlendmapsCache->addEntryToObjectCache(id, obj.get());
+    }
+    PackedBlendmapsHolder* packedBlendmaps = static_cast<PackedBlendmapsHolder*>(obj.get());
+
+    std::lock_guard<std::mutex> lock(packedBlendmaps->mMutex);
+    return ::Terrain::createPasses(useShaders, &mSceneManager->getShaderManager(), layers, blendmapTextures, blendmapScale, blendmapScale, &packedBlendmaps->mBlendmaps);
+}
+
+std::vector<osg::ref_ptr<osg::StateSet> > ChunkManager::getPasses(float chunkSize, const osg::Vec2f &chunkCenter)
+{
+    const std::pair<float, osg::Vec2f> id (chunkSize, chunkCenter);
+    osg::ref_ptr<osg::Object> obj = mPassesCache->getRefFromObjectCache(id);
+    if (obj)
+        return static_cast<PassesHolder*>(obj.get())->mPasses;
+
+    std::vector<osg::ref_ptr<osg::StateSet> > passes = createPasses(chunkSize, chunkCenter, false);
+    mPassesCache->addEntryToObjectCache(id, new PassesHolder(passes));
+    return passes;
 }
 
 osg::ref_ptr<osg::Node> ChunkManager::createChunk(float chunkSize, const osg::Vec2f &chunkCenter, unsigned char lod, unsigned int lodFlags, bool compile)
@@ -224,7 +347,7 @@ osg::ref_ptr<osg::Node> ChunkManager::createChunk(float chunkSize, const osg::Ve
     }
     else
     {
-        geometry->setPasses(createPasses(chunkSize, chunkCenter, false));
+        geometry->setPasses(getPasses(chunkSize, chunkCenter));
     }
 
     geometry->setupWaterBoundingBox(-1, chunkSize * mStorage->getCellWorldSize() / numVerts);
@@ -46,6 +46,8 @@ namespace Terrain
 
         void reportStats(unsigned int frameNumber, osg::Stats* stats) const override;
 
+        void updateCache(double referenceTime) override;
+
         void clearCache() override;
 
         void releaseGLObjects(osg::State* state) override;
@@ -59,12 +61,21 @@ namespace Terrain
 
         std::vector<osg::ref_ptr<osg::StateSet> > createPasses(float chunkSize, const osg::Vec2f& chunkCenter, bool forCompositeMap);
 
+        /// The passes of a chunk don't depend on its LOD, so they are shared by all LODs of a chunk.
+        std::vector<osg::ref_ptr<osg::StateSet> > getPasses(float chunkSize, const osg::Vec2f& chunkCenter);
+
         Terrain::Storage* mStorage;
         Resource::SceneManager* mSceneManager;
         TextureManager* mTextureManager;
         CompositeMapRenderer* mCompositeMapRenderer;
         BufferCache mBufferCache;
 
+        typedef Resource::GenericObjectCache<std::pair<float, osg::Vec2f> > PassesCache;
+        osg::ref_ptr<PassesCache> mPassesCache;
+
+        /// The packed blendmaps of each chunk. They outlive the passes using them, so that rebuilt passes can reuse them.
+        osg::ref_ptr<PassesCache> mPackedBlendmapsCache;
+
         osg::ref_ptr<osg::StateSet> mMultiPassRoot;
 
         unsigned int mNodeMask;
@@ -7,8 +7,11 @@
 #include <osg/TexMat>
 #include <osg/BlendFunc>
 
+#include <components/sceneutil/shadow.hpp>
 #include <components/shader/shadermanager.hpp>
 
+#include <algorithm>
+#include <cstring>
 #include <mutex>
 
 namespace
@@ -166,20 +169,112 @@ namespace
             mValue->setSource0_RGB(osg::TexEnvCombine::PREVIOUS);
         }
     };
+
+    // A pass with packed layers has the diffuse map of the first layer on unit 0 and the packed blendmap on unit 1 like any other
+    // pass, the diffuse maps of the other layers follow. They have to stay below the texture units of the shadow maps.
+    unsigned int getMaxPackedLayers()
+    {
+        const int maxPackedLayers = std::min(3, SceneUtil::ShadowManager::getBaseShadowTextureUnit() - 1);
+        return static_cast<unsigned int>(std::max(0, maxPackedLayers));
+    }
+
+    bool canPackLayer(const Terrain::TextureLayer& layer, const osg::ref_ptr<osg::Texture2D>& blendmap, const osg::Image* firstImage)
+    {
+        // Normal maps and specular maps would need their own samplers, so only plain layers are packed
+        if (layer.mNormalMap || layer.mSpecular)
+            return false;
+        const osg::Image* image = blendmap->getImage();
+        return image && image->getPixelFormat() == GL_ALPHA && image->getDataType() == GL_UNSIGNED_BYTE
+                && (!firstImage || (image->s() == firstImage->s() && image->t() == firstImage->t()));
+    }
+
+    // Combine the blendmaps of up to three layers into the channels of a single texture, reusing a previously packed one with the same contents
+    osg::ref_ptr<osg::Texture2D> packBlendmaps(const std::vector<osg::ref_ptr<osg::Texture2D> >& blendmaps, const std::vector<size_t>& layerIndices,
+                                               Terrain::PackedBlendmaps* packedBlendmaps)
+    {
+        const osg::Image* firstImage = blendmaps[layerIndices.front()]->getImage();
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(firstImage->s(), firstImage->t(), 1, GL_RGB, GL_UNSIGNED_BYTE);
+        unsigned char* packedData = image->data();
+        memset(packedData, 0, image->getTotalDataSize());
+
+        const size_t numPixels = static_cast<size_t>(firstImage->s()) * firstImage->t();
+        for (size_t channel = 0; channel < layerIndices.size(); ++channel)
+        {
+            const unsigned char* data = blendmaps[layerIndices[channel]]->getImage()->data();
+            for (size_t i = 0; i < numPixels; ++i)
+                packedData[i*3 + channel] = data[i];
+        }
+
+        if (packedBlendmaps)
+        {
+            auto found = packedBlendmaps->find(layerIndices);
+            if (found != packedBlendmaps->end())
+            {
+                const osg::Image* previous = found->second->getImage();
+                if (previous && previous->s() == image->s() && previous->t() == image->t()
+                        && std::memcmp(previous->data(), packedData, image->getTotalDataSize()) == 0)
+                    return found->second;
+            }
+        }
+
+        osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
+        texture->setImage(image);
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+        texture->setResizeNonPowerOfTwoHint(false);
+        if (packedBlendmaps)
+            (*packedBlendmaps)[layerIndices] = texture;
+        return texture;
+    }
+
+    // Returns the layer indices to render in each pass
+    std::vector<std::vector<size_t> > groupLayers(bool packLayers, const std::vector<Terrain::TextureLayer>& layers,
+                                                  const std::vector<osg::ref_ptr<osg::Texture2D> >& blendmaps)
+    {
+        std::vector<std::vector<size_t> > groups;
+        std::vector<size_t> packed;
+        const unsigned int maxPackedLayers = getMaxPackedLayers();
+        packLayers = packLayers && maxPackedLayers > 1;
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            const osg::Image* firstImage = packed.empty() ? nullptr : blendmaps[packed.front()]->getImage();
+            if (packLayers && i < blendmaps.size() && canPackLayer(layers[i], blendmaps[i], firstImage))
+            {
+                packed.push_back(i);
+                if (packed.size() == maxPackedLayers)
+                {
+                    groups.push_back(packed);
+                    packed.clear();
+                }
+            }
+            else
+                groups.push_back(std::vector<size_t>(1, i));
+        }
+        if (!packed.empty())
+            groups.push_back(packed);
+        return groups;
+    }
 }
 
 namespace Terrain
 {
     std::vector<osg::ref_ptr<osg::StateSet> > createPasses(bool useShaders, Shader::ShaderManager* shaderManager, const std::vector<TextureLayer> &layers,
-                                                           const std::vector<osg::ref_ptr<osg::Texture2D> > &blendmaps, int blendmapScale, float layerTileSize)
+                                                           const std::vector<osg::ref_ptr<osg::Texture2D> > &blendmaps, int blendmapScale, float layerTileSize,
+                                                           PackedBlendmaps* packedBlendmaps)
     {
         std::vector<osg::ref_ptr<osg::StateSet> > passes;
 
-        unsigned int blendmapIndex = 0;
+        // With shaders, several layers can be blended in a single pass
+        std::vector<std::vector<size_t> > groups = groupLayers(useShaders && blendmaps.size() > 1, layers, blendmaps);
+
         unsigned int passIndex = 0;
-        for (std::vector<TextureLayer>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+        for (std::vector<std::vector<size_t> >::const_iterator group = groups.begin(); group != groups.end(); ++group)
         {
-            bool firstLayer = (it == layers.begin());
+            bool firstLayer = (group == groups.begin());
+            const TextureLayer& layer = layers[group->front()];
+            const unsigned int blendmapIndex = static_cast<unsigned int>(group->front());
+            const bool packed = group->size() > 1;
 
             osg::ref_ptr<osg::StateSet> stateset (new osg::StateSet);
 
@@ -203,7 +298,7 @@ namespace Terrain
 
             if (useShaders)
             {
-                stateset->setTextureAttributeAndModes(texunit, it->mDiffuseMap);
+                stateset->setTextureAttributeAndModes(texunit, layer.mDiffuseMap);
 
                 if (layerTileSize != 1.f)
                     stateset->setTextureAttributeAndModes(texunit, LayerTexMat::value(layerTileSize), osg::StateAttribute::ON);
@@ -213,25 +308,36 @@ namespace Terrain
                 if (!blendmaps.empty())
                 {
                     ++texunit;
-                    osg::ref_ptr<osg::Texture2D> blendmap = blendmaps.at(blendmapIndex++);
+                    osg::ref_ptr<osg::Texture2D> blendmap = packed ? packBlendmaps(blendmaps, *group, packedBlendmaps) : blendmaps.at(blendmapIndex);
 
                     stateset->setTextureAttributeAndModes(texunit, blendmap.get());
                     stateset->setTextureAttributeAndModes(texunit, BlendmapTexMat::value(blendmapScale));
                     stateset->addUniform(new osg::Uniform("blendMap", texunit));
                 }
 
-                if (it->mNormalMap)
+                if (packed)
+                {
+                    for (size_t i = 1; i < group->size(); ++i)
+                    {
+                        ++texunit;
+                        stateset->setTextureAttributeAndModes(texunit, layers[(*group)[i]].mDiffuseMap);
+                        stateset->addUniform(new osg::Uniform(("diffuseMap" + std::to_string(i)).c_str(), texunit));
+                    }
+                }
+
+                if (layer.mNormalMap)
                 {
                     ++texunit;
-                    stateset->setTextureAttributeAndModes(texunit, it->mNormalMap);
+                    stateset->setTextureAttributeAndModes(texunit, layer.mNormalMap);
                     stateset->addUniform(new osg::Uniform("normalMap", texunit));
                 }
 
                 Shader::ShaderManager::DefineMap defineMap;
-                defineMap["normalMap"] = (it->mNormalMap) ? "1" : "0";
+                defineMap["normalMap"] = (layer.mNormalMap) ? "1" : "0";
                 defineMap["blendMap"] = (!blendmaps.empty()) ? "1" : "0";
-                defineMap["specularMap"] = it->mSpecular ? "1" : "0";
-                defineMap["parallax"] = (it->mNormalMap && it->mParallax) ? "1" : "0";
+                defineMap["specularMap"] = layer.mSpecular ? "1" : "0";
+                defineMap["parallax"] = (layer.mNormalMap && layer.mParallax) ? "1" : "0";
+                defineMap["packedLayers"] = packed ? std::to_string(group->size()) : "0";
 
                 osg::ref_ptr<osg::Shader> vertexShader = shaderManager->getShader("terrain_vertex.glsl", defineMap, osg::Shader::VERTEX);
                 osg::ref_ptr<osg::Shader> fragmentShader = shaderManager->getShader("terrain_fragment.glsl", defineMap, osg::Shader::FRAGMENT);
@@ -247,7 +353,7 @@ namespace Terrain
             else
             {
                 // Add the actual layer texture
-                osg::ref_ptr<osg::Texture2D> tex = it->mDiffuseMap;
+                osg::ref_ptr<osg::Texture2D> tex = layer.mDiffuseMap;
                 stateset->setTextureAttributeAndModes(texunit, tex.get());
 
                 if (layerTileSize != 1.f)
@@ -258,7 +364,7 @@ namespace Terrain
                 // Multiply by the alpha map
                 if (!blendmaps.empty())
                 {
-                    osg::ref_ptr<osg::Texture2D> blendmap = blendmaps.at(blendmapIndex++);
+                    osg::ref_ptr<osg::Texture2D> blendmap = blendmaps.at(blendmapIndex);
 
                     stateset->setTextureAttributeAndModes(texunit, blendmap.get());
 
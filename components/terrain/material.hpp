@@ -1,6 +1,9 @@
 #ifndef COMPONENTS_TERRAIN_MATERIAL_H
 #define COMPONENTS_TERRAIN_MATERIAL_H
 
+#include <map>
+#include <vector>
+
 #include <osg/StateSet>
 
 #include "defs.hpp"
@@ -26,9 +29,15 @@ namespace Terrain
         bool mSpecular;
     };
 
+    /// Blendmaps that were packed for a chunk, by the indices of the layers they combine.
+    typedef std::map<std::vector<size_t>, osg::ref_ptr<osg::Texture2D> > PackedBlendmaps;
+
+    /// @param packedBlendmaps Optional blendmaps packed by an earlier call for the same chunk. They are reused if their contents
+    /// are unchanged, so that rebuilding the passes of a chunk does not upload them again. New packed blendmaps are added.
     std::vector<osg::ref_ptr<osg::StateSet> > createPasses(bool useShaders, Shader::ShaderManager* shaderManager,
                                                            const std::vector<TextureLayer>& layers,
-                                                           const std::vector<osg::ref_ptr<osg::Texture2D> >& blendmaps, int blendmapScale, float layerTileSize);
+                                                           const std::vector<osg::ref_ptr<osg::Texture2D> >& blendmaps, int blendmapScale, float layerTileSize,
+                                                           PackedBlendmaps* packedBlendmaps = nullptr);
 
 }
 
@@ -8,6 +8,7 @@
 std::string getFirstLine(const std::string &filename);
 void testEncoder(ToUTF8::FromType encoding, const std::string &legacyEncFile,
                  const std::string &utf8File);
+void testAsciiRuns();
 
 /// Test character encoding conversion to and from UTF-8
 void testEncoder(ToUTF8::FromType encoding, const std::string &legacyEncFile,
@@ -35,6 +36,61 @@ void testEncoder(ToUTF8::FromType encoding, const std::string &legacyEncFile,
     assert(convertedLegacyEncLine == legacyEncLine);
 }
 
+/// Test the conversion of ASCII runs around the boundaries of the 16 character blocks
+/// that are checked at once, and of inputs shorter than a block
+void testAsciiRuns()
+{
+    ToUTF8::Utf8Encoder encoder (ToUTF8::WINDOWS_1252);
+
+    // e acute, in windows-1252 and in UTF-8
+    const std::string legacyChar = "\xE9";
+    const std::string utf8Char = "\xC3\xA9";
+
+    for (size_t length = 0; length <= 64; ++length)
+    {
+        std::string ascii;
+        for (size_t i = 0; i < length; ++i)
+            ascii += static_cast<char>('a' + i % 26);
+
+        // pure ASCII
+        assert(encoder.getUtf8(ascii) == ascii);
+        assert(encoder.getLegacyEnc(ascii) == ascii);
+
+        for (size_t pos = 0; pos < length; ++pos)
+        {
+            // one non-ASCII character
+            std::string legacy = ascii;
+            legacy.replace(pos, 1, legacyChar);
+            std::string utf8 = ascii;
+            utf8.replace(pos, 1, utf8Char);
+            assert(encoder.getUtf8(legacy) == utf8);
+            assert(encoder.getLegacyEnc(utf8) == legacy);
+
+            // two adjacent non-ASCII characters, e.g. on both sides of a block boundary
+            if (pos + 1 < length)
+            {
+                legacy = ascii;
+                legacy.replace(pos, 2, legacyChar + legacyChar);
+                utf8 = ascii;
+                utf8.replace(pos, 2, utf8Char + utf8Char);
+                assert(encoder.getUtf8(legacy) == utf8);
+                assert(encoder.getLegacyEnc(utf8) == legacy);
+            }
+
+            // the output ends at an embedded zero terminator
+            std::string terminated = ascii;
+            terminated[pos] = 0;
+            assert(encoder.getUtf8(terminated.c_str(), terminated.size()) == ascii.substr(0, pos));
+            terminated = ascii;
+            terminated.replace(0, 1, legacyChar);
+            terminated[pos] = 0;
+            assert(encoder.getUtf8(terminated.c_str(), terminated.size()) == (pos == 0 ? std::string() : utf8Char + ascii.substr(1, pos - 1)));
+        }
+    }
+
+    std::cout << "ASCII runs of up to 64 characters converted" << std::endl;
+}
+
 std::string getFirstLine(const std::string &filename)
 {
     std::string line;
@@ -55,5 +111,6 @@ int main()
 {
     testEncoder(ToUTF8::WINDOWS_1251, "test_data/russian-win1251.txt", "test_data/russian-utf8.txt");
     testEncoder(ToUTF8::WINDOWS_1252, "test_data/french-win1252.txt", "test_data/french-utf8.txt");
+    testAsciiRuns();
     return 0;
 }
@@ -2,8 +2,14 @@
 
 #include <vector>
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TO_UTF8_USE_SSE2
+#endif
+
 #include <components/debug/debuglog.hpp>
 
 /* This file contains the code to translate from WINDOWS-1252 (native
@@ -42,6 +48,42 @@
 // Generated tables
 #include "tables_gen.hpp"
 
+namespace
+{
+    // Return the first character in [ptr, end) that is not ASCII or a
+    // zero terminator, or end if there is none. Where SSE2 is available,
+    // 16 characters are checked at a time.
+    const char* skipAscii(const char* ptr, const char* end)
+    {
+#ifdef TO_UTF8_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - ptr >= 16; ptr += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+            // The high bit is set for non-ASCII characters, and for zeros after the comparison
+            if (_mm_movemask_epi8(_mm_or_si128(chunk, _mm_cmpeq_epi8(chunk, zero))) != 0)
+                break;
+        }
+#endif
+        for (; ptr < end; ++ptr)
+        {
+            const unsigned char ch = *ptr;
+            if (ch == 0 || ch >= 128)
+                break;
+        }
+        return ptr;
+    }
+
+    // Copy the ASCII characters at the start of the input at once.
+    void copyAscii(const char* &input, const char* end, char* &out)
+    {
+        const char* ptr = skipAscii(input, end);
+        std::memcpy(out, input, ptr - input);
+        out += ptr - input;
+        input = ptr;
+    }
+}
+
 using namespace ToUTF8;
 
 Utf8Encoder::Utf8Encoder(const FromType sourceEncoding):
@@ -93,7 +135,7 @@ std::string Utf8Encoder::getUtf8(const char* input, size_t size)
     // Compute output length, and check for pure ascii input at the same
     // time.
     bool ascii;
-    size_t outlen = getLength(input, ascii);
+    size_t outlen = getLength(input, size, ascii);
 
     // If we're pure ascii, then don't bother converting anything.
     if(ascii)
@@ -103,9 +145,14 @@ std::string Utf8Encoder::getUtf8(const char* input, size_t size)
     resize(outlen);
     char *out = &mOutput[0];
 
-    // Translate
+    // Translate, copying the ASCII parts in between as they are
+    const char* end = input + size;
+    copyAscii(input, end, out);
     while (*input)
+    {
         copyFromArray(*(input++), out);
+        copyAscii(input, end, out);
+    }
 
     // Make sure that we wrote the correct number of bytes
     assert((out-&mOutput[0]) == (int)outlen);
@@ -134,7 +181,7 @@ std::string Utf8Encoder::getLegacyEnc(const char *input, size_t size)
     // Compute output length, and check for pure ascii input at the same
     // time.
     bool ascii;
-    size_t outlen = getLength2(input, ascii);
+    size_t outlen = getLength2(input, size, ascii);
 
     // If we're pure ascii, then don't bother converting anything.
     if(ascii)
@@ -144,9 +191,14 @@ std::string Utf8Encoder::getLegacyEnc(const char *input, size_t size)
     resize(outlen);
     char *out = &mOutput[0];
 
-    // Translate
+    // Translate, copying the ASCII parts in between as they are
+    const char* end = input + size;
+    copyAscii(input, end, out);
     while(*input)
+    {
         copyFromArray2(input, out);
+        copyAscii(input, end, out);
+    }
 
     // Make sure that we wrote the correct number of bytes
     assert((out-&mOutput[0]) == (int)outlen);
@@ -182,17 +234,16 @@ void Utf8Encoder::resize(size_t size)
   is the case, then the ascii parameter is set to true, and the
   caller can optimize for this case.
  */
-size_t Utf8Encoder::getLength(const char* input, bool &ascii)
+size_t Utf8Encoder::getLength(const char* input, size_t size, bool &ascii)
 {
     ascii = true;
     size_t len = 0;
-    const char* ptr = input;
-    unsigned char inp = *ptr;
+    const char* end = input + size;
 
     // Do away with the ascii part of the string first (this is almost
     // always the entire string.)
-    while (inp && inp < 128)
-        inp = *(++ptr);
+    const char* ptr = skipAscii(input, end);
+    unsigned char inp = *ptr;
     len += (ptr-input);
 
     // If we're not at the null terminator at this point, then there
@@ -206,7 +257,12 @@ size_t Utf8Encoder::getLength(const char* input, bool &ascii)
             // Find the translated length of this character in the
             // lookup table.
             len += translationArray[inp*6];
-            inp = *(++ptr);
+
+            // Count the ascii characters up to the next one at once
+            const char* next = skipAscii(++ptr, end);
+            len += (next-ptr);
+            ptr = next;
+            inp = *ptr;
         }
     }
     return len;
@@ -229,17 +285,16 @@ void Utf8Encoder::copyFromArray(unsigned char ch, char* &out)
         *(out++) = *(in++);
 }
 
-size_t Utf8Encoder::getLength2(const char* input, bool &ascii)
+size_t Utf8Encoder::getLength2(const char* input, size_t size, bool &ascii)
 {
     ascii = true;
     size_t len = 0;
-    const char* ptr = input;
-    unsigned char inp = *ptr;
+    const char* end = input + size;
 
     // Do away with the ascii part of the string first (this is almost
     // always the entire string.)
-    while (inp && inp < 128)
-        inp = *(++ptr);
+    const char* ptr = skipAscii(input, end);
+    unsigned char inp = *ptr;
     len += (ptr-input);
 
     // If we're not at the null terminator at this point, then there
@@ -267,7 +322,11 @@ size_t Utf8Encoder::getLength2(const char* input, bool &ascii)
                 case 0xc5: len -= 1; break;
             }
 
-            inp = *(++ptr);
+            // Count the ascii characters up to the next one at once
+            const char* next = skipAscii(++ptr, end);
+            len += (next-ptr);
+            ptr = next;
+            inp = *ptr;
         }
     }
     return len;
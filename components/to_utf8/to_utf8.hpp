@@ -42,9 +42,9 @@ namespace ToUTF8
 
         private:
             void resize(size_t size);
-            size_t getLength(const char* input, bool &ascii);
+            size_t getLength(const char* input, size_t size, bool &ascii);
             void copyFromArray(unsigned char chp, char* &out);
-            size_t getLength2(const char* input, bool &ascii);
+            size_t getLength2(const char* input, size_t size, bool &ascii);
             void copyFromArray2(const char*& chp, char* &out);
 
             std::vector<char> mOutput;
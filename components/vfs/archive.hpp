@@ -2,6 +2,8 @@
 #define OPENMW_COMPONENTS_RESOURCE_ARCHIVE_H
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include <components/files/constrainedfilestream.hpp>
 
@@ -16,6 +18,27 @@ namespace VFS
         virtual Files::IStreamPtr open() = 0;
     };
 
+    /// Applies a normalize function through a lookup table, which is much cheaper than calling it for each character.
+    class NormalizeTable
+    {
+    public:
+        NormalizeTable(char (*normalize_function) (char))
+        {
+            for (int i = 0; i < 256; ++i)
+                mTable[i] = normalize_function(static_cast<char>(i));
+        }
+
+        void normalize(const char* begin, const char* end, std::string& out) const
+        {
+            out.resize(end - begin);
+            for (std::size_t i = 0; begin != end; ++begin, ++i)
+                out[i] = mTable[static_cast<unsigned char>(*begin)];
+        }
+
+    private:
+        char mTable[256];
+    };
+
     class Archive
     {
     public:
@@ -23,6 +46,10 @@ namespace VFS
 
         /// List all resources contained in this archive, and run the resource names through the given normalize function.
         virtual void listResources(std::map<std::string, File*>& out, char (*normalize_function) (char)) = 0;
+
+        /// Prepare the files of this archive among the given ones for reading, e.g. by decompressing them ahead of time.
+        /// @note Thread safe.
+        virtual void prefetch(const std::vector<File*>& files) {}
     };
 
 }
@@ -1,5 +1,6 @@
 #include "bsaarchive.hpp"
 #include <components/bsa/compressedbsafile.hpp>
+#include <cstring>
 #include <memory>
 
 namespace VFS
@@ -10,10 +11,10 @@ BsaArchive::BsaArchive(const std::string &filename)
     Bsa::BsaVersion bsaVersion = Bsa::CompressedBSAFile::detectVersion(filename);
 
     if (bsaVersion == Bsa::BSAVER_COMPRESSED) {
-        mFile = std::make_unique<Bsa::CompressedBSAFile>(Bsa::CompressedBSAFile());
+        mFile = std::make_unique<Bsa::CompressedBSAFile>();
     }
     else {
-        mFile = std::make_unique<Bsa::BSAFile>(Bsa::BSAFile());
+        mFile = std::make_unique<Bsa::BSAFile>();
     }
 
     mFile->open(filename);
@@ -30,15 +31,30 @@ BsaArchive::~BsaArchive() {
 
 void BsaArchive::listResources(std::map<std::string, File *> &out, char (*normalize_function)(char))
 {
+    const NormalizeTable table(normalize_function);
+    std::string ent;
     for (std::vector<BsaArchiveFile>::iterator it = mResources.begin(); it != mResources.end(); ++it)
     {
-        std::string ent = it->mInfo->name;
-        std::transform(ent.begin(), ent.end(), ent.begin(), normalize_function);
+        const char* name = it->mInfo->name;
+        table.normalize(name, name + std::strlen(name), ent);
 
         out[ent] = &*it;
     }
 }
 
+void BsaArchive::prefetch(const std::vector<File*>& files)
+{
+    std::vector<const Bsa::BSAFile::FileStruct*> ownFiles;
+    for (File* file : files)
+    {
+        BsaArchiveFile* bsaFile = dynamic_cast<BsaArchiveFile*>(file);
+        if (bsaFile && bsaFile->mFile == mFile.get())
+            ownFiles.push_back(bsaFile->mInfo);
+    }
+    if (!ownFiles.empty())
+        mFile->prefetch(ownFiles);
+}
+
 // ------------------------------------------------------------------------------
 
 BsaArchiveFile::BsaArchiveFile(const Bsa::BSAFile::FileStruct *info, Bsa::BSAFile* bsa)
@@ -24,6 +24,7 @@ namespace VFS
         BsaArchive(const std::string& filename);
         virtual ~BsaArchive();
         virtual void listResources(std::map<std::string, File*>& out, char (*normalize_function) (char));
+        virtual void prefetch(const std::vector<File*>& files);
 
     private:
         std::unique_ptr<Bsa::BSAFile> mFile;
@@ -1,15 +1,25 @@
 #include "filesystemarchive.hpp"
 
+#include <functional>
+#include <sstream>
+
 #include <boost/filesystem.hpp>
 
 #include <components/debug/debuglog.hpp>
+#include <components/files/cachefile.hpp>
+
+namespace
+{
+    const std::string sIndexCacheVersion = "1";
+}
 
 namespace VFS
 {
 
-    FileSystemArchive::FileSystemArchive(const std::string &path)
+    FileSystemArchive::FileSystemArchive(const std::string &path, const std::string &indexCachePath)
         : mBuiltIndex(false)
         , mPath(path)
+        , mIndexCachePath(indexCachePath)
     {
 
     }
@@ -18,39 +28,142 @@ namespace VFS
     {
         if (!mBuiltIndex)
         {
-            typedef boost::filesystem::recursive_directory_iterator directory_iterator;
+            std::vector<std::string> files;
+            if (mIndexCachePath.empty() || !readIndexCache(files))
+            {
+                const std::time_t scanTime = std::time(nullptr);
+                DirectoryList directories;
+                scan(files, directories);
+
+                // Modification times only have a resolution of one second, so changes made right after the scan
+                // could go unnoticed if a directory was modified in the same second
+                bool recentlyModified = false;
+                for (const auto& directory : directories)
+                    recentlyModified |= directory.second + 1 >= scanTime;
+
+                if (!mIndexCachePath.empty() && !recentlyModified)
+                    writeIndexCache(files, directories);
+            }
 
-            directory_iterator end;
+            const NormalizeTable table(normalize_function);
+            const boost::filesystem::path root(mPath);
+            std::string searchable;
+            for (const std::string& file : files)
+            {
+                std::string proper = (root / file).string();
 
-            size_t prefix = mPath.size ();
+                table.normalize(file.data(), file.data() + file.size(), searchable);
 
-            if (mPath.size () > 0 && mPath [prefix - 1] != '\\' && mPath [prefix - 1] != '/')
-                ++prefix;
+                if (!mIndex.insert (std::make_pair (searchable, FileSystemArchiveFile(proper))).second)
+                    Log(Debug::Warning) << "Warning: found duplicate file for '" << proper << "', please check your file system for two files with the same name in different cases.";
+            }
 
-            for (directory_iterator i (mPath); i != end; ++i)
-            {
-                if(boost::filesystem::is_directory (*i))
-                    continue;
+            mBuiltIndex = true;
+        }
 
-                std::string proper = i->path ().string ();
+        for (index::iterator it = mIndex.begin(); it != mIndex.end(); ++it)
+        {
+            out[it->first] = &it->second;
+        }
+    }
+
+    void FileSystemArchive::scan(std::vector<std::string> &files, DirectoryList &directories) const
+    {
+        typedef boost::filesystem::recursive_directory_iterator directory_iterator;
 
-                FileSystemArchiveFile file(proper);
+        directory_iterator end;
 
-                std::string searchable;
+        size_t prefix = mPath.size ();
 
-                std::transform(proper.begin() + prefix, proper.end(), std::back_inserter(searchable), normalize_function);
+        if (mPath.size () > 0 && mPath [prefix - 1] != '\\' && mPath [prefix - 1] != '/')
+            ++prefix;
 
-                if (!mIndex.insert (std::make_pair (searchable, file)).second)
-                    Log(Debug::Warning) << "Warning: found duplicate file for '" << proper << "', please check your file system for two files with the same name in different cases.";
+        const bool storeDirectories = !mIndexCachePath.empty();
+        if (storeDirectories)
+            directories.emplace_back(std::string(), boost::filesystem::last_write_time(mPath));
+
+        for (directory_iterator i (mPath); i != end; ++i)
+        {
+            if(boost::filesystem::is_directory (*i))
+            {
+                if (storeDirectories)
+                    directories.emplace_back(i->path().string().substr(prefix), boost::filesystem::last_write_time(i->path()));
+                continue;
             }
 
-            mBuiltIndex = true;
+            files.push_back(i->path().string().substr(prefix));
         }
+    }
 
-        for (index::iterator it = mIndex.begin(); it != mIndex.end(); ++it)
+    std::string FileSystemArchive::getIndexCacheFile() const
+    {
+        std::ostringstream name;
+        name << std::hex << std::hash<std::string>()(mPath) << ".txt";
+        return (boost::filesystem::path(mIndexCachePath) / name.str()).string();
+    }
+
+    bool FileSystemArchive::readIndexCache(std::vector<std::string> &files) const
+    {
+        std::string data;
+        if (!Files::readCacheFile(getIndexCacheFile(), data))
+            return false;
+
+        std::istringstream stream(data);
+        std::string line;
+        if (!std::getline(stream, line) || line != sIndexCacheVersion || !std::getline(stream, line) || line != mPath)
+            return false;
+
+        std::size_t numDirectories = 0;
+        if (!std::getline(stream, line))
+            return false;
+        try
         {
-            out[it->first] = &it->second;
+            numDirectories = std::stoul(line);
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+
+        const boost::filesystem::path root(mPath);
+        for (std::size_t i = 0; i < numDirectories; ++i)
+        {
+            std::string time;
+            if (!std::getline(stream, time) || !std::getline(stream, line))
+                return false;
+
+            boost::system::error_code ec;
+            const std::time_t modified = boost::filesystem::last_write_time(line.empty() ? root : root / line, ec);
+            if (ec || std::to_string(modified) != time)
+                return false;
         }
+
+        while (std::getline(stream, line))
+            files.push_back(line);
+
+        Log(Debug::Verbose) << "Using cached file index for " << mPath;
+        return true;
+    }
+
+    void FileSystemArchive::writeIndexCache(const std::vector<std::string> &files, const DirectoryList &directories) const
+    {
+        try
+        {
+            boost::filesystem::create_directories(mIndexCachePath);
+        }
+        catch (const std::exception& e)
+        {
+            Log(Debug::Warning) << "Warning: Failed to create file index cache directory " << mIndexCachePath << ": " << e.what();
+            return;
+        }
+
+        std::string data = sIndexCacheVersion + '\n' + mPath + '\n' + std::to_string(directories.size()) + '\n';
+        for (const auto& directory : directories)
+            data += std::to_string(directory.second) + '\n' + directory.first + '\n';
+        for (const std::string& file : files)
+            data += file + '\n';
+
+        Files::writeCacheFile(getIndexCacheFile(), data);
     }
 
     // ----------------------------------------------------------------------------------
@@ -1,6 +1,9 @@
 #ifndef OPENMW_COMPONENTS_RESOURCE_FILESYSTEMARCHIVE_H
 #define OPENMW_COMPONENTS_RESOURCE_FILESYSTEMARCHIVE_H
 
+#include <ctime>
+#include <utility>
+
 #include "archive.hpp"
 
 namespace VFS
@@ -21,17 +24,32 @@ namespace VFS
     class FileSystemArchive : public Archive
     {
     public:
-        FileSystemArchive(const std::string& path);
+        /// @param indexCachePath Directory to store the list of files in, so that later sessions don't need to scan
+        /// the directory tree again as long as no directory was modified. Empty to always scan.
+        FileSystemArchive(const std::string& path, const std::string& indexCachePath = std::string());
 
         virtual void listResources(std::map<std::string, File*>& out, char (*normalize_function) (char));
 
 
     private:
+        typedef std::vector<std::pair<std::string, std::time_t> > DirectoryList;
+
+        /// Find all files, as paths relative to mPath, and all directories with their modification times.
+        void scan(std::vector<std::string>& files, DirectoryList& directories) const;
+
+        std::string getIndexCacheFile() const;
+
+        /// @return false if there is no cached index or a directory was modified since it was written.
+        bool readIndexCache(std::vector<std::string>& files) const;
+
+        void writeIndexCache(const std::vector<std::string>& files, const DirectoryList& directories) const;
+
         typedef std::map <std::string, FileSystemArchiveFile> index;
         index mIndex;
 
         bool mBuiltIndex;
         std::string mPath;
+        std::string mIndexCachePath;
 
     };
 
@@ -1,6 +1,10 @@
 #include "manager.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <stdexcept>
+#include <thread>
 
 #include <components/misc/stringops.hpp>
 
@@ -25,6 +29,35 @@ namespace
         std::transform(path.begin(), path.end(), path.begin(), normalize_char);
     }
 
+    char normalize_char(char ch, bool strict)
+    {
+        return strict ? strict_normalize_char(ch) : nonstrict_normalize_char(ch);
+    }
+
+    // 64 bit FNV-1a of the normalized path, so unnormalized names can be hashed without copying them
+    std::uint64_t hash_path(const char* path, std::size_t size, bool strict)
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(normalize_char(path[i], strict));
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool equals_normalized(const std::string& normalized, const char* path, std::size_t size, bool strict)
+    {
+        if (normalized.size() != size)
+            return false;
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (normalized[i] != normalize_char(path[i], strict))
+                return false;
+        }
+        return true;
+    }
+
 }
 
 namespace VFS
@@ -44,6 +77,7 @@ namespace VFS
     void Manager::reset()
     {
         mIndex.clear();
+        mHashIndex.clear();
         for (std::vector<Archive*>::iterator it = mArchives.begin(); it != mArchives.end(); ++it)
             delete *it;
         mArchives.clear();
@@ -58,32 +92,110 @@ namespace VFS
     {
         mIndex.clear();
 
-        for (std::vector<Archive*>::const_iterator it = mArchives.begin(); it != mArchives.end(); ++it)
-            (*it)->listResources(mIndex, mStrict ? &strict_normalize_char : &nonstrict_normalize_char);
+        // Scanning data directories is slow, so list the archives concurrently and merge them in order of priority afterwards
+        char (*normalize_function)(char) = mStrict ? &strict_normalize_char : &nonstrict_normalize_char;
+        std::vector<std::map<std::string, File*> > resources(mArchives.size());
+        std::vector<std::exception_ptr> errors(mArchives.size());
+        std::atomic<std::size_t> next (0);
+        auto work = [&] ()
+        {
+            for (std::size_t i = next++; i < mArchives.size(); i = next++)
+            {
+                try
+                {
+                    mArchives[i]->listResources(resources[i], normalize_function);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+            }
+        };
+
+        const std::size_t numThreads = std::min<std::size_t>(mArchives.size(), std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < numThreads; ++i)
+            threads.emplace_back(work);
+        work();
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (std::size_t i = 0; i < mArchives.size(); ++i)
+        {
+            if (errors[i])
+                std::rethrow_exception(errors[i]);
+            if (mIndex.empty())
+                mIndex.swap(resources[i]);
+            else
+            {
+                for (const auto& resource : resources[i])
+                    mIndex[resource.first] = resource.second;
+            }
+        }
+
+        mHashIndex.clear();
+        mHashIndex.reserve(mIndex.size());
+        for (const auto& entry : mIndex)
+            mHashIndex.push_back({hash_path(entry.first.data(), entry.first.size(), mStrict), &entry.first, entry.second});
+        std::sort(mHashIndex.begin(), mHashIndex.end(), [] (const HashEntry& left, const HashEntry& right) { return left.mHash < right.mHash; });
     }
 
-    Files::IStreamPtr Manager::get(const std::string &name) const
+    File* Manager::lookup(const char *name, std::size_t size) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
+        const std::uint64_t hash = hash_path(name, size, mStrict);
+        auto it = std::lower_bound(mHashIndex.begin(), mHashIndex.end(), hash, [] (const HashEntry& entry, std::uint64_t value) { return entry.mHash < value; });
+        for (; it != mHashIndex.end() && it->mHash == hash; ++it)
+        {
+            if (equals_normalized(*it->mName, name, size, mStrict))
+                return it->mFile;
+        }
+        return nullptr;
+    }
 
-        return getNormalized(normalized);
+    File* Manager::lookup(const std::string &name) const
+    {
+        return lookup(name.data(), name.size());
+    }
+
+    Files::IStreamPtr Manager::get(const std::string &name) const
+    {
+        File* file = lookup(name);
+        if (!file)
+        {
+            std::string normalized = name;
+            normalize_path(normalized, mStrict);
+            throw std::runtime_error("Resource '" + normalized + "' not found");
+        }
+        return file->open();
     }
 
     Files::IStreamPtr Manager::getNormalized(const std::string &normalizedName) const
     {
-        std::map<std::string, File*>::const_iterator found = mIndex.find(normalizedName);
-        if (found == mIndex.end())
+        File* file = lookup(normalizedName);
+        if (!file)
             throw std::runtime_error("Resource '" + normalizedName + "' not found");
-        return found->second->open();
+        return file->open();
     }
 
-    bool Manager::exists(const std::string &name) const
+    void Manager::prefetch(const std::vector<std::string> &names) const
     {
-        std::string normalized = name;
-        normalize_path(normalized, mStrict);
+        std::vector<File*> files;
+        for (const std::string& name : names)
+        {
+            File* file = lookup(name);
+            if (file)
+                files.push_back(file);
+        }
+        if (files.empty())
+            return;
+
+        for (Archive* archive : mArchives)
+            archive->prefetch(files);
+    }
 
-        return mIndex.find(normalized) != mIndex.end();
+    bool Manager::exists(const std::string &name) const
+    {
+        return lookup(name) != nullptr;
     }
 
     const std::map<std::string, File*>& Manager::getIndex() const
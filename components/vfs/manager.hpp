@@ -3,6 +3,7 @@
 
 #include <components/files/constrainedfilestream.hpp>
 
+#include <cstdint>
 #include <vector>
 #include <map>
 
@@ -40,6 +41,13 @@ namespace VFS
         /// @note May be called from any thread once the index has been built.
         bool exists(const std::string& name) const;
 
+        /// Look up a file by name without allocating, the name does not need to be normalized.
+        /// @return The file, or nullptr if it does not exist. The handle stays valid until the index is rebuilt or reset,
+        /// so callers that open the same file repeatedly can keep it and use File::open() directly.
+        /// @note May be called from any thread once the index has been built.
+        File* lookup(const char* name, std::size_t size) const;
+        File* lookup(const std::string& name) const;
+
         /// Get a complete list of files from all archives
         /// @note May be called from any thread once the index has been built.
         const std::map<std::string, File*>& getIndex() const;
@@ -58,12 +66,26 @@ namespace VFS
         /// @note May be called from any thread once the index has been built.
         Files::IStreamPtr getNormalized(const std::string& normalizedName) const;
 
+        /// Prepare the given files for reading, so that a later get() is faster. Unknown files are ignored.
+        /// @note May be called from any thread once the index has been built.
+        void prefetch(const std::vector<std::string>& names) const;
+
     private:
         bool mStrict;
 
         std::vector<Archive*> mArchives;
 
         std::map<std::string, File*> mIndex;
+
+        struct HashEntry
+        {
+            std::uint64_t mHash;
+            const std::string* mName;
+            File* mFile;
+        };
+
+        /// The files of mIndex sorted by the hash of their normalized name, for lookups that don't need to be ordered
+        std::vector<HashEntry> mHashIndex;
     };
 
 }
@@ -12,7 +12,7 @@
 namespace VFS
 {
 
-    void registerArchives(VFS::Manager *vfs, const Files::Collections &collections, const std::vector<std::string> &archives, bool useLooseFiles)
+    void registerArchives(VFS::Manager *vfs, const Files::Collections &collections, const std::vector<std::string> &archives, bool useLooseFiles, const std::string &indexCachePath)
     {
         const Files::PathContainer& dataDirs = collections.getPaths();
 
@@ -43,7 +43,7 @@ namespace VFS
                 {
                     Log(Debug::Info) << "Adding data directory " << iter->string();
                     // Last data dir has the highest priority
-                    vfs->addArchive(new FileSystemArchive(iter->string()));
+                    vfs->addArchive(new FileSystemArchive(iter->string(), indexCachePath));
                 }
                 else
                     Log(Debug::Info) << "Ignoring duplicate data directory " << iter->string();
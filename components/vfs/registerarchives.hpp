@@ -8,8 +8,9 @@ namespace VFS
     class Manager;
 
     /// @brief Register BSA and file system archives based on the given OpenMW configuration.
+    /// @param indexCachePath Directory to cache the file lists of data directories in, see FileSystemArchive. Empty to disable.
     void registerArchives (VFS::Manager* vfs, const Files::Collections& collections,
-        const std::vector<std::string>& archives, bool useLooseFiles);
+        const std::vector<std::string>& archives, bool useLooseFiles, const std::string& indexCachePath = std::string());
 }
 
 #endif
@@ -0,0 +1,31 @@
+#version 120
+
+uniform sampler2D diffuseMap;
+
+varying vec2 diffuseMapUV;
+varying vec3 passViewNormal;
+varying float euclideanDepth;
+varying float linearDepth;
+
+void main()
+{
+    // the views hold the unlit colors, light them with the sun and the ambient light like the objects they replace
+    vec4 albedo = texture2D(diffuseMap, diffuseMapUV);
+    if (albedo.a < 0.5)
+        discard;
+
+    vec3 viewNormal = normalize(passViewNormal);
+    vec3 lightDir = normalize(gl_LightSource[0].position.xyz);
+    vec3 lighting = gl_LightModel.ambient.xyz + gl_LightSource[0].ambient.xyz + gl_LightSource[0].diffuse.xyz * max(dot(viewNormal, lightDir), 0.0);
+#if @clamp
+    lighting = clamp(lighting, vec3(0.0), vec3(1.0));
+#endif
+    gl_FragData[0] = vec4(albedo.xyz * lighting, 1.0);
+
+#if @radialFog
+    float fogValue = clamp((euclideanDepth - gl_Fog.start) * gl_Fog.scale, 0.0, 1.0);
+#else
+    float fogValue = clamp((linearDepth - gl_Fog.start) * gl_Fog.scale, 0.0, 1.0);
+#endif
+    gl_FragData[0].xyz = mix(gl_FragData[0].xyz, gl_Fog.color.xyz, fogValue);
+}
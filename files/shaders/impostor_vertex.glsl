@@ -0,0 +1,40 @@
+#version 120
+
+uniform float numViews;
+uniform float gutter;
+
+varying vec2 diffuseMapUV;
+varying vec3 passViewNormal;
+varying float euclideanDepth;
+varying float linearDepth;
+
+#define PI 3.14159265
+
+void main(void)
+{
+    // gl_Vertex is the center of the impostor, gl_MultiTexCoord0 the corner of the quad,
+    // gl_MultiTexCoord1 the radius and the rotation of the object around the z axis
+    vec2 corner = gl_MultiTexCoord0.xy;
+    float radius = gl_MultiTexCoord1.x;
+    float rotation = gl_MultiTexCoord1.y;
+
+    // pick the view that was baked from the direction closest to the eye, in the object's own frame
+    vec3 toEye = (gl_ModelViewMatrixInverse * vec4(0.0, 0.0, 0.0, 1.0)).xyz - gl_Vertex.xyz;
+    float c = cos(rotation);
+    float s = sin(rotation);
+    vec2 localToEye = vec2(c * toEye.x + s * toEye.y, -s * toEye.x + c * toEye.y);
+    float view = mod(floor(atan(localToEye.x, localToEye.y) / (2.0 * PI) * numViews + 0.5), numViews);
+
+    vec4 viewPos = gl_ModelViewMatrix * gl_Vertex;
+    viewPos.xy += corner * radius;
+    gl_Position = gl_ProjectionMatrix * viewPos;
+    gl_ClipVertex = viewPos;
+
+    // the object was baked inside the transparent gutter of its view
+    vec2 viewUV = mix(vec2(gutter), vec2(1.0 - gutter), corner * 0.5 + 0.5);
+    diffuseMapUV = vec2((view + viewUV.x) / numViews, viewUV.y);
+    // no normals are baked, bulge the billboard towards the camera so that the light still varies across the object
+    passViewNormal = vec3(corner, 1.0);
+    euclideanDepth = length(viewPos.xyz);
+    linearDepth = gl_Position.z;
+}
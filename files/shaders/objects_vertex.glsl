@@ -54,17 +54,30 @@ varying vec3 passNormal;
 
 #include "lighting.glsl"
 
+#if @skinning
+#include "skinning.glsl"
+#endif
+
 void main(void)
 {
-    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+#if @skinning
+    mat4 skinningMatrix = getSkinningMatrix();
+    vec4 vertex = skinPosition(skinningMatrix, gl_Vertex);
+    vec3 normal = skinDirection(skinningMatrix, gl_Normal);
+#else
+    vec4 vertex = gl_Vertex;
+    vec3 normal = gl_Normal;
+#endif
 
-    vec4 viewPos = (gl_ModelViewMatrix * gl_Vertex);
+    gl_Position = gl_ModelViewProjectionMatrix * vertex;
+
+    vec4 viewPos = (gl_ModelViewMatrix * vertex);
     gl_ClipVertex = viewPos;
     euclideanDepth = length(viewPos.xyz);
     linearDepth = gl_Position.z;
 
 #if (@envMap || !PER_PIXEL_LIGHTING || @shadows_enabled)
-    vec3 viewNormal = normalize((gl_NormalMatrix * gl_Normal).xyz);
+    vec3 viewNormal = normalize((gl_NormalMatrix * normal).xyz);
 #endif
 
 #if @envMap
@@ -96,8 +109,12 @@ void main(void)
 
 #if @normalMap
     normalMapUV = (gl_TextureMatrix[@normalMapUV] * gl_MultiTexCoord@normalMapUV).xy;
+#if @skinning
+    passTangent = vec4(skinDirection(skinningMatrix, gl_MultiTexCoord7.xyz), gl_MultiTexCoord7.w);
+#else
     passTangent = gl_MultiTexCoord7.xyzw;
 #endif
+#endif
 
 #if @bumpMap
     bumpMapUV = (gl_TextureMatrix[@bumpMapUV] * gl_MultiTexCoord@bumpMapUV).xy;
@@ -112,7 +129,7 @@ void main(void)
 #endif
     passColor = gl_Color;
     passViewPos = viewPos.xyz;
-    passNormal = gl_Normal.xyz;
+    passNormal = normal;
 
 #if (@shadows_enabled)
     setupShadowCoords(viewPos, viewNormal);
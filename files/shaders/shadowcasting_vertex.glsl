@@ -8,11 +8,21 @@ uniform int colorMode;
 uniform bool useDiffuseMapForShadowAlpha = true;
 uniform bool alphaTestShadows = true;
 
+#if @skinning
+#include "skinning.glsl"
+#endif
+
 void main(void)
 {
-    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+#if @skinning
+    vec4 vertex = skinPosition(getSkinningMatrix(), gl_Vertex);
+#else
+    vec4 vertex = gl_Vertex;
+#endif
+
+    gl_Position = gl_ModelViewProjectionMatrix * vertex;
 
-    vec4 viewPos = (gl_ModelViewMatrix * gl_Vertex);
+    vec4 viewPos = (gl_ModelViewMatrix * vertex);
     gl_ClipVertex = viewPos;
 
     if (useDiffuseMapForShadowAlpha)
@@ -0,0 +1,24 @@
+// Sized from the uniform limit of the graphics driver, see SceneUtil::RigGeometry::getMaxGpuBones
+uniform mat4 boneMatrices[@maxBones];
+
+attribute vec4 boneIndices;
+attribute vec4 boneWeights;
+
+mat4 getSkinningMatrix()
+{
+    return boneMatrices[int(boneIndices.x)] * boneWeights.x
+         + boneMatrices[int(boneIndices.y)] * boneWeights.y
+         + boneMatrices[int(boneIndices.z)] * boneWeights.z
+         + boneMatrices[int(boneIndices.w)] * boneWeights.w;
+}
+
+vec4 skinPosition(mat4 skinningMatrix, vec4 position)
+{
+    // the weights do not necessarily add up to 1
+    return vec4((skinningMatrix * position).xyz, 1.0);
+}
+
+vec3 skinDirection(mat4 skinningMatrix, vec3 direction)
+{
+    return (skinningMatrix * vec4(direction, 0.0)).xyz;
+}
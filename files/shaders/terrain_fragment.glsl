@@ -12,6 +12,13 @@ uniform sampler2D normalMap;
 uniform sampler2D blendMap;
 #endif
 
+#if @packedLayers
+uniform sampler2D diffuseMap1;
+#if @packedLayers > 2
+uniform sampler2D diffuseMap2;
+#endif
+#endif
+
 varying float euclideanDepth;
 varying float linearDepth;
 
@@ -65,7 +72,21 @@ void main()
 
 #if @blendMap
     vec2 blendMapUV = (gl_TextureMatrix[1] * vec4(uv, 0.0, 1.0)).xy;
+#if @packedLayers
+    // The blend weights of all layers in this pass are packed into the channels of the blendmap
+    vec3 blendWeights = texture2D(blendMap, blendMapUV).xyz;
+    vec3 diffuseColor = diffuseTex.xyz * blendWeights.x + texture2D(diffuseMap1, adjustedUV).xyz * blendWeights.y;
+#if @packedLayers > 2
+    diffuseColor += texture2D(diffuseMap2, adjustedUV).xyz * blendWeights.z;
+#endif
+    // Layer passes are added up (SRC_ALPHA, ONE), so the pass has to add the sum of the weighted layers. Scaling the colour by
+    // 1 / alpha keeps lighting and fog (mixed in with the alpha weight, like in separate passes) the same as with one pass per layer.
+    float totalWeight = blendWeights.x + blendWeights.y + blendWeights.z;
+    float passAlpha = clamp(totalWeight, 0.0001, 1.0);
+    gl_FragData[0] = vec4(diffuseColor / passAlpha, passAlpha);
+#else
     gl_FragData[0].a *= texture2D(blendMap, blendMapUV).a;
+#endif
 #endif
 
     float shadowing = unshadowedLightRatio(linearDepth);